@@ -33,7 +33,6 @@ import kotlin.coroutines.resume
 @RequiresApi(Build.VERSION_CODES.Q)
 @Composable
 fun Camera2(
-  coreEngines: List<CoreEngine>,
   lensFacing: Int,
   context: Context = LocalContext.current,
   coroutineScope: CoroutineScope = rememberCoroutineScope()
@@ -112,17 +111,20 @@ fun Camera2(
       )
       val rotationDegrees =
         cameraCharacteristics.get(CameraCharacteristics.SENSOR_ORIENTATION)!!
+      val timestampSource =
+        cameraCharacteristics.get(CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE)
+          ?: CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN
       imageReader.setOnImageAvailableListener(
         {
           val image = it.acquireLatestImage()
           image.hardwareBuffer?.let { buffer ->
-            coreEngines.forEach { engine ->
-              engine.sendCameraFrame(
-                buffer = buffer,
-                rotationDegrees = rotationDegrees,
-                backCamera = lensFacing == CameraSelector.LENS_FACING_BACK
-              )
-            }
+            CoreEngine.sendCameraFrame(
+              buffer = buffer,
+              rotationDegrees = rotationDegrees,
+              backCamera = lensFacing == CameraSelector.LENS_FACING_BACK,
+              timestampNanos = image.timestamp,
+              timestampSource = timestampSource
+            )
             buffer.close()
           }
           image.close()
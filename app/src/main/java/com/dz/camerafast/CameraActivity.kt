@@ -54,6 +54,8 @@ class CameraActivity : ComponentActivity() {
   @SuppressLint("NewApi")
   override fun onCreate(savedInstanceState: Bundle?) {
     super.onCreate(savedInstanceState)
+    // code cache is cleared on app update, together with the driver caches are tied to
+    previewEngineList.forEach { it.setCacheDirectory(codeCacheDir.absolutePath) }
     setContent {
       val cameraMode by remember {
         cameraModeState
@@ -105,16 +107,12 @@ class CameraActivity : ComponentActivity() {
 
       if (cameraMode == CameraMode.CAMERA_X) {
         CameraX(
-          coreEngines = previewEngineList,
           lensFacing = lensFacing
         )
       }
 
       if (cameraMode == CameraMode.CAMERA_2) {
-        // Vulkan is not supported yet
-        displayMode = DisplayMode.OPEN_GL_ES
         Camera2(
-          coreEngines = previewEngineList,
           lensFacing = lensFacing
         )
       }
@@ -208,7 +206,7 @@ class CameraActivity : ComponentActivity() {
                 Text(text = "To ${if (cameraMode == CameraMode.CAMERA_X) "Camera2" else "CameraX"}")
               }
             }
-            if (displayMode != DisplayMode.BOTH && cameraMode != CameraMode.CAMERA_2) {
+            if (displayMode != DisplayMode.BOTH) {
               Button(
                 onClick = {
                   displayMode = DisplayMode.BOTH
@@ -244,6 +242,7 @@ class CameraActivity : ComponentActivity() {
   override fun onDestroy() {
     super.onDestroy()
     previewEngineList.forEach { it.destroy() }
+    CoreEngine.dumpLog()
   }
 
   internal companion object {
@@ -1,8 +1,11 @@
 package com.dz.camerafast
 
 import android.content.Context
+import android.hardware.camera2.CameraCharacteristics
 import android.util.Log
 import androidx.annotation.OptIn
+import androidx.camera.camera2.interop.Camera2CameraInfo
+import androidx.camera.camera2.interop.ExperimentalCamera2Interop
 import androidx.camera.core.CameraSelector
 import androidx.camera.core.ExperimentalGetImage
 import androidx.camera.core.ImageAnalysis
@@ -16,15 +19,17 @@ import androidx.lifecycle.LifecycleOwner
 import androidx.lifecycle.compose.LifecycleStartEffect
 import com.dz.camerafast.CameraActivity.Companion.TAG
 import java.util.concurrent.Executors
+import java.util.concurrent.atomic.AtomicInteger
 
-@OptIn(ExperimentalGetImage::class)
+@OptIn(ExperimentalGetImage::class, ExperimentalCamera2Interop::class)
 @Composable
 fun CameraX(
-  coreEngines: List<CoreEngine>,
   lensFacing: Int,
+  // YUV is what camera produces natively, converting it to RGBA in native code is cheaper than letting CameraX do it
+  outputImageFormat: Int = ImageAnalysis.OUTPUT_IMAGE_FORMAT_YUV_420_888,
   context: Context = LocalContext.current
 ) {
-  LifecycleStartEffect(lensFacing) {
+  LifecycleStartEffect(lensFacing, outputImageFormat) {
     val cameraProviderFuture = ProcessCameraProvider.getInstance(context)
     cameraProviderFuture.addListener({
       // Camera provider is now guaranteed to be available
@@ -37,20 +42,24 @@ fun CameraX(
             .setAspectRatioStrategy(AspectRatioStrategy.RATIO_16_9_FALLBACK_AUTO_STRATEGY)
             .build()
         )
-        .setOutputImageFormat(ImageAnalysis.OUTPUT_IMAGE_FORMAT_RGBA_8888)
+        .setOutputImageFormat(outputImageFormat)
         .setBackpressureStrategy(ImageAnalysis.STRATEGY_KEEP_ONLY_LATEST)
         .build()
 
+      // known once bound, frames analyzed before that are not traced from the sensor
+      val timestampSource =
+        AtomicInteger(CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN)
       imageAnalysis.setAnalyzer(Executors.newSingleThreadExecutor()) { imageProxy ->
         Log.i(TAG, "New image ${imageProxy.hashCode()} arrived!")
         imageProxy.image?.hardwareBuffer?.let { buffer ->
-          coreEngines.forEach {
-            it.sendCameraFrame(
-              buffer = buffer,
-              rotationDegrees = imageProxy.imageInfo.rotationDegrees,
-              backCamera = lensFacing == CameraSelector.LENS_FACING_BACK
-            )
-          }
+          // converted once natively and shared by every engine
+          CoreEngine.sendCameraFrame(
+            buffer = buffer,
+            rotationDegrees = imageProxy.imageInfo.rotationDegrees,
+            backCamera = lensFacing == CameraSelector.LENS_FACING_BACK,
+            timestampNanos = imageProxy.imageInfo.timestamp,
+            timestampSource = timestampSource.get()
+          )
           buffer.close()
         }
         imageProxy.close()
@@ -64,9 +73,14 @@ fun CameraX(
       // Apply declared configs to CameraX using the same lifecycle owner
       cameraProvider.unbindAll()
       // Note: we do not setup ANY preview options as all the drawing will be done by us
-      cameraProvider.bindToLifecycle(
+      val camera = cameraProvider.bindToLifecycle(
         context as LifecycleOwner, cameraSelector, imageAnalysis
       )
+      timestampSource.set(
+        Camera2CameraInfo.from(camera.cameraInfo)
+          .getCameraCharacteristic(CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE)
+          ?: CameraCharacteristics.SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN
+      )
       Log.i(TAG, "Camera set up!")
     }, ContextCompat.getMainExecutor(context))
 
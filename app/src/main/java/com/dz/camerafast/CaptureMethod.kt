@@ -0,0 +1,22 @@
+package com.dz.camerafast
+
+/**
+ * How a still capture gets pixels into CPU memory, order matches native CaptureMethod.
+ * None of them blocks the render thread on the GPU.
+ */
+enum class CaptureMethod {
+  /**
+   * CPU lock of the camera buffer on a capture thread, [CaptureSource.CAMERA_FRAME] only.
+   */
+  HARDWARE_BUFFER_LOCK,
+
+  /**
+   * glReadPixels into a pixel buffer object, OpenGL ES renderer only.
+   */
+  GL_PIXEL_BUFFER,
+
+  /**
+   * Image copy into a mapped staging buffer, Vulkan renderer only.
+   */
+  VULKAN_STAGING_COPY
+}
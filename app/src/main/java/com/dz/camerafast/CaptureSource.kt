@@ -0,0 +1,16 @@
+package com.dz.camerafast
+
+/**
+ * What a still capture copies, order matches native CaptureSource.
+ */
+enum class CaptureSource {
+  /**
+   * Camera buffer the renderer currently draws, as delivered by the camera.
+   */
+  CAMERA_FRAME,
+
+  /**
+   * What the renderer drew into the surface or its offscreen target.
+   */
+  RENDERED_OUTPUT
+}
@@ -0,0 +1,23 @@
+package com.dz.camerafast
+
+/**
+ * Still captures done with one [CaptureMethod], times in nanoseconds. Latency is from the request
+ * until pixels were in CPU memory, render thread time is what the capture cost the renderer.
+ */
+data class CaptureMethodStats(
+  val captures: Long,
+  val failures: Long,
+  val avgLatency: Long,
+  val maxLatency: Long,
+  val avgRenderThread: Long,
+  val maxRenderThread: Long,
+)
+
+/**
+ * See [CoreEngine.captureStats].
+ */
+data class CaptureStats(
+  val hardwareBufferLock: CaptureMethodStats,
+  val glPixelBuffer: CaptureMethodStats,
+  val vulkanStagingCopy: CaptureMethodStats,
+)
@@ -2,10 +2,12 @@ package com.dz.camerafast
 
 import android.graphics.PixelFormat
 import android.hardware.HardwareBuffer
+import android.hardware.camera2.CameraMetadata
 import android.util.Log
 import android.view.Surface
 import android.view.SurfaceHolder
 import androidx.annotation.Keep
+import java.io.File
 
 @Keep
 class CoreEngine(
@@ -26,9 +28,112 @@ class CoreEngine(
     initialize(renderingMode.ordinal)
   }
 
-  fun sendCameraFrame(buffer: HardwareBuffer, rotationDegrees: Int, backCamera: Boolean) {
-    buffer.printSupportedUsageFlags()
-    nativeSendCameraFrame(buffer, rotationDegrees, backCamera)
+  /**
+   * Configures how many native threads (camera one included) copy CameraX CPU frames and into how
+   * many horizontal stripes each frame is split. Values <= 0 restore defaults.
+   * Camera frames are ingested once for all engines so the setting is shared by them.
+   */
+  fun setCopyParallelism(threads: Int, stripes: Int) {
+    nativeSetCopyParallelism(threads, stripes)
+  }
+
+  /**
+   * Configures how YUV CameraX CPU frames are converted to RGBA. Defaults to BT.601 full range
+   * which is what Android camera uses for YUV_420_888. Shared by all engines.
+   */
+  fun setYuvConversion(bt709: Boolean, limitedRange: Boolean) {
+    nativeSetYuvConversion(bt709, limitedRange)
+  }
+
+  /**
+   * Camera frames renderer got so far. Frames arriving faster than the renderer imports them are
+   * dropped, only the newest pending one is kept.
+   */
+  fun frameStats(): FrameStats {
+    val values = nativeGetFrameStats()
+    return FrameStats(received = values[0], dropped = values[1], consumed = values[2])
+  }
+
+  /**
+   * Rolling per stage latency breakdown of frames the renderer presented,
+   * from camera sensor timestamp to swap / present.
+   */
+  fun latencyStats(): LatencyStats {
+    val values = nativeGetLatencyStats()
+    val spans = List(values.size / 4) {
+      LatencyPercentiles(
+        samples = values[it * 4],
+        p50 = values[it * 4 + 1],
+        p95 = values[it * 4 + 2],
+        p99 = values[it * 4 + 3],
+      )
+    }
+    return LatencyStats(
+      sensorToIngest = spans[0],
+      ingestToDeliver = spans[1],
+      deliverToImport = spans[2],
+      importToSubmit = spans[3],
+      submitToPresent = spans[4],
+      sensorToPresent = spans[5],
+    )
+  }
+
+  /**
+   * App private directory the renderer persists its pipeline / shader caches to,
+   * should be set before the surface is created.
+   */
+  fun setCacheDirectory(directory: String) {
+    nativeSetCacheDirectory(directory)
+  }
+
+  /**
+   * Renders camera frames offscreen as fast as they arrive, with no surface and no vsync.
+   * Useful to measure throughput with [frameStats] or to process recorded frames.
+   * Must not be used while the engine is attached to a surface.
+   */
+  fun startHeadless(width: Int, height: Int): Boolean = nativeStartHeadless(width, height)
+
+  fun stopHeadless() {
+    nativeStopHeadless()
+  }
+
+  /**
+   * How frames are paced against vsync, see [RenderPolicy]. [latencyStats] are reset on change
+   * so they describe the new policy only.
+   */
+  fun setRenderPolicy(policy: RenderPolicy) {
+    nativeSetRenderPolicy(policy.ordinal)
+  }
+
+  /**
+   * Copies a still of [source] into [file] as binary PAM without stalling the preview, the file
+   * is written once the copy finished. Returns false if the renderer could not be asked at all,
+   * unsupported combinations (e.g. [CaptureMethod.GL_PIXEL_BUFFER] on Vulkan) fail later and only
+   * show up in [captureStats].
+   */
+  fun capture(source: CaptureSource, method: CaptureMethod, file: File): Boolean =
+    nativeCapture(source.ordinal, method.ordinal, file.absolutePath)
+
+  /**
+   * Per method capture counters and costs since the engine was created.
+   */
+  fun captureStats(): CaptureStats {
+    val values = nativeGetCaptureStats()
+    val methods = List(values.size / 6) {
+      CaptureMethodStats(
+        captures = values[it * 6],
+        failures = values[it * 6 + 1],
+        avgLatency = values[it * 6 + 2],
+        maxLatency = values[it * 6 + 3],
+        avgRenderThread = values[it * 6 + 4],
+        maxRenderThread = values[it * 6 + 5],
+      )
+    }
+    return CaptureStats(
+      hardwareBufferLock = methods[0],
+      glPixelBuffer = methods[1],
+      vulkanStagingCopy = methods[2],
+    )
   }
 
   override fun surfaceCreated(p0: SurfaceHolder) {
@@ -55,11 +160,25 @@ class CoreEngine(
 
   private external fun nativeSetSurface(surface: Surface?, width: Int, height: Int)
 
-  private external fun nativeSendCameraFrame(
-    buffer: HardwareBuffer,
-    rotationDegrees: Int,
-    backCamera: Boolean
-  )
+  private external fun nativeSetCopyParallelism(threads: Int, stripes: Int)
+
+  private external fun nativeSetYuvConversion(bt709: Boolean, limitedRange: Boolean)
+
+  private external fun nativeGetFrameStats(): LongArray
+
+  private external fun nativeGetLatencyStats(): LongArray
+
+  private external fun nativeSetCacheDirectory(directory: String)
+
+  private external fun nativeStartHeadless(width: Int, height: Int): Boolean
+
+  private external fun nativeStopHeadless()
+
+  private external fun nativeSetRenderPolicy(policy: Int)
+
+  private external fun nativeCapture(source: Int, method: Int, path: String): Boolean
+
+  private external fun nativeGetCaptureStats(): LongArray
 
   private external fun nativeDestroy()
 
@@ -67,51 +186,131 @@ class CoreEngine(
 
   private external fun finalize()
 
-  private fun HardwareBuffer.printSupportedUsageFlags() {
-    val usage = usage.toInt()
-    val supportedUsages = mutableListOf<String>()
+  companion object {
+    private const val TAG = "DzCoreKotlin"
 
-    if (usage and HardwareBuffer.USAGE_CPU_READ_RARELY.toInt() != 0) {
-      supportedUsages.add("USAGE_CPU_READ_RARELY")
-    }
-    if (usage and HardwareBuffer.USAGE_CPU_READ_OFTEN.toInt() != 0) {
-      supportedUsages.add("USAGE_CPU_READ_OFTEN")
-    }
-    if (usage and HardwareBuffer.USAGE_CPU_WRITE_RARELY.toInt() != 0) {
-      supportedUsages.add("USAGE_CPU_WRITE_RARELY")
-    }
-    if (usage and HardwareBuffer.USAGE_CPU_WRITE_OFTEN.toInt() != 0) {
-      supportedUsages.add("USAGE_CPU_WRITE_OFTEN")
-    }
-    if (usage and HardwareBuffer.USAGE_GPU_SAMPLED_IMAGE.toInt() != 0) {
-      supportedUsages.add("USAGE_GPU_SAMPLED_IMAGE")
-    }
-    if (usage and HardwareBuffer.USAGE_GPU_COLOR_OUTPUT.toInt() != 0) {
-      supportedUsages.add("USAGE_GPU_COLOR_OUTPUT")
-    }
-    if (usage and HardwareBuffer.USAGE_GPU_CUBE_MAP.toInt() != 0) {
-      supportedUsages.add("USAGE_GPU_CUBE_MAP")
-    }
-    if (usage and HardwareBuffer.USAGE_GPU_MIPMAP_COMPLETE.toInt() != 0) {
-      supportedUsages.add("USAGE_GPU_MIPMAP_COMPLETE")
-    }
-    if (usage and HardwareBuffer.USAGE_PROTECTED_CONTENT.toInt() != 0) {
-      supportedUsages.add("USAGE_PROTECTED_CONTENT")
+    init {
+      System.loadLibrary("native-engine")
     }
-    if (usage and HardwareBuffer.USAGE_SENSOR_DIRECT_DATA.toInt() != 0) {
-      supportedUsages.add("USAGE_SENSOR_DIRECT_DATA")
+
+    /**
+     * Feeds camera buffer to every engine alive. Buffer is copied / converted natively at most
+     * once and then shared by all renderers, so it should be sent once and not per engine.
+     * Sensor timestamp is only used for latency tracing, 0 if unknown. It is ignored unless
+     * [timestampSource] is SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME, an unknown source is
+     * CLOCK_MONOTONIC and can not be compared with native CLOCK_BOOTTIME stamps.
+     */
+    fun sendCameraFrame(
+      buffer: HardwareBuffer,
+      rotationDegrees: Int,
+      backCamera: Boolean,
+      timestampNanos: Long = 0,
+      timestampSource: Int = CameraMetadata.SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN
+    ) {
+      buffer.printSupportedUsageFlags()
+      nativeSendCameraFrame(
+        buffer, rotationDegrees, backCamera, timestampNanos,
+        timestampSource == CameraMetadata.SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME
+      )
     }
-    if (usage and HardwareBuffer.USAGE_VIDEO_ENCODE.toInt() != 0) {
-      supportedUsages.add("USAGE_VIDEO_ENCODE")
+
+    /**
+     * Feeds every engine alive with generated frames instead of the camera, so load and latency
+     * measurements are reproducible: same parameters and seed give the same frames and timestamps.
+     * Frames are delivered up to [jitterMicros] late, out of every [burstPeriod] frames the first
+     * [burstLength] are held back and delivered at once. Camera should be closed meanwhile.
+     */
+    fun startFrameSource(
+      width: Int,
+      height: Int,
+      framesPerSecond: Float,
+      pattern: FramePattern = FramePattern.MOVING_GRADIENT,
+      gpuSampled: Boolean = false,
+      jitterMicros: Int = 0,
+      burstLength: Int = 0,
+      burstPeriod: Int = 0,
+      seed: Long = 1
+    ): Boolean = nativeStartFrameSource(
+      width, height, framesPerSecond, pattern.ordinal, gpuSampled,
+      jitterMicros, burstLength, burstPeriod, seed
+    )
+
+    fun stopFrameSource() {
+      nativeStopFrameSource()
     }
-    Log.i(CameraActivity.TAG, "Supports ${supportedUsages.joinToString(", ")}")
-  }
 
-  private companion object {
-    private const val TAG = "DzCoreKotlin"
+    /**
+     * Prints per frame native log (buffers acquired / released, swaps etc.) collected since
+     * the previous call into logcat. Returns amount of printed entries.
+     */
+    fun dumpLog(): Int = nativeDumpLog()
 
-    init {
-      System.loadLibrary("native-engine")
+    @JvmStatic
+    private external fun nativeSendCameraFrame(
+      buffer: HardwareBuffer,
+      rotationDegrees: Int,
+      backCamera: Boolean,
+      timestampNanos: Long,
+      realtimeTimestamp: Boolean
+    )
+
+    @JvmStatic
+    private external fun nativeDumpLog(): Int
+
+    @JvmStatic
+    private external fun nativeStartFrameSource(
+      width: Int,
+      height: Int,
+      framesPerSecond: Float,
+      pattern: Int,
+      gpuSampled: Boolean,
+      jitterMicros: Int,
+      burstLength: Int,
+      burstPeriod: Int,
+      seed: Long
+    ): Boolean
+
+    @JvmStatic
+    private external fun nativeStopFrameSource()
+
+    private fun HardwareBuffer.printSupportedUsageFlags() {
+      val usage = usage.toInt()
+      val supportedUsages = mutableListOf<String>()
+
+      if (usage and HardwareBuffer.USAGE_CPU_READ_RARELY.toInt() != 0) {
+        supportedUsages.add("USAGE_CPU_READ_RARELY")
+      }
+      if (usage and HardwareBuffer.USAGE_CPU_READ_OFTEN.toInt() != 0) {
+        supportedUsages.add("USAGE_CPU_READ_OFTEN")
+      }
+      if (usage and HardwareBuffer.USAGE_CPU_WRITE_RARELY.toInt() != 0) {
+        supportedUsages.add("USAGE_CPU_WRITE_RARELY")
+      }
+      if (usage and HardwareBuffer.USAGE_CPU_WRITE_OFTEN.toInt() != 0) {
+        supportedUsages.add("USAGE_CPU_WRITE_OFTEN")
+      }
+      if (usage and HardwareBuffer.USAGE_GPU_SAMPLED_IMAGE.toInt() != 0) {
+        supportedUsages.add("USAGE_GPU_SAMPLED_IMAGE")
+      }
+      if (usage and HardwareBuffer.USAGE_GPU_COLOR_OUTPUT.toInt() != 0) {
+        supportedUsages.add("USAGE_GPU_COLOR_OUTPUT")
+      }
+      if (usage and HardwareBuffer.USAGE_GPU_CUBE_MAP.toInt() != 0) {
+        supportedUsages.add("USAGE_GPU_CUBE_MAP")
+      }
+      if (usage and HardwareBuffer.USAGE_GPU_MIPMAP_COMPLETE.toInt() != 0) {
+        supportedUsages.add("USAGE_GPU_MIPMAP_COMPLETE")
+      }
+      if (usage and HardwareBuffer.USAGE_PROTECTED_CONTENT.toInt() != 0) {
+        supportedUsages.add("USAGE_PROTECTED_CONTENT")
+      }
+      if (usage and HardwareBuffer.USAGE_SENSOR_DIRECT_DATA.toInt() != 0) {
+        supportedUsages.add("USAGE_SENSOR_DIRECT_DATA")
+      }
+      if (usage and HardwareBuffer.USAGE_VIDEO_ENCODE.toInt() != 0) {
+        supportedUsages.add("USAGE_VIDEO_ENCODE")
+      }
+      Log.i(CameraActivity.TAG, "Supports ${supportedUsages.joinToString(", ")}")
     }
   }
-}
\ No newline at end of file
+}
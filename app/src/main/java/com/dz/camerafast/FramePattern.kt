@@ -0,0 +1,10 @@
+package com.dz.camerafast
+
+/**
+ * Test patterns of the synthetic frame source, order matches native FrameSource::Pattern.
+ */
+enum class FramePattern {
+  MOVING_GRADIENT,
+  CHECKERBOARD,
+  NOISE
+}
@@ -0,0 +1,10 @@
+package com.dz.camerafast
+
+/**
+ * Camera frame counters of the native renderer, see [CoreEngine.frameStats].
+ */
+data class FrameStats(
+  val received: Long,
+  val dropped: Long,
+  val consumed: Long,
+)
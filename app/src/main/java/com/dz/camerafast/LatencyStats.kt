@@ -0,0 +1,24 @@
+package com.dz.camerafast
+
+/**
+ * Latency percentiles of one pipeline span over the last presented frames, in nanoseconds.
+ */
+data class LatencyPercentiles(
+  val samples: Long,
+  val p50: Long,
+  val p95: Long,
+  val p99: Long,
+)
+
+/**
+ * Where the time goes between camera sensor and screen, see [CoreEngine.latencyStats].
+ * Sensor spans stay empty when camera timestamps are not in the elapsed realtime clock base.
+ */
+data class LatencyStats(
+  val sensorToIngest: LatencyPercentiles,
+  val ingestToDeliver: LatencyPercentiles,
+  val deliverToImport: LatencyPercentiles,
+  val importToSubmit: LatencyPercentiles,
+  val submitToPresent: LatencyPercentiles,
+  val sensorToPresent: LatencyPercentiles,
+)
@@ -0,0 +1,21 @@
+package com.dz.camerafast
+
+/**
+ * When the renderer draws a camera frame, order matches native RenderPolicy.
+ */
+enum class RenderPolicy {
+  /**
+   * At most one draw per vsync, in the choreographer callback.
+   */
+  VSYNC_ALIGNED,
+
+  /**
+   * Drawn as soon as the frame arrives, lowest latency while the GPU keeps up.
+   */
+  IMMEDIATE,
+
+  /**
+   * Newest frame is picked as late before the next vsync as the measured render cost allows.
+   */
+  LATE_LATCH
+}
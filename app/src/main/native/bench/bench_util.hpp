@@ -0,0 +1,31 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+// STL
+#include <cstdint>
+
+namespace engine {
+namespace android {
+
+/**
+ * Camera resolutions every per-frame benchmark runs at, width and height as the first two args.
+ */
+inline void frameSizes(benchmark::internal::Benchmark *benchmark) {
+  benchmark->ArgNames({"width", "height"});
+  benchmark->Args({1280, 720});
+  benchmark->Args({1920, 1080});
+  benchmark->Args({3840, 2160});
+  benchmark->Args({7680, 4320});
+}
+
+/**
+ * One iteration is one frame: reported time is per frame, bytes/s and frames/s come on top.
+ */
+inline void setFrameCounters(benchmark::State &state, int64_t bytesPerFrame) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytesPerFrame);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include <android/log.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "binary_log.hpp"
+
+// STL
+#include <cstdio>
+
+using namespace engine::android;
+
+namespace {
+
+const char *const kRenderer = "Vulkan";
+
+/**
+ * Formatting alone, what every logcat line costs before the IPC to logd.
+ */
+void BM_LogSnprintf(benchmark::State &state) {
+  char message[256];
+  auto *buffer = reinterpret_cast<void *>(0x7b0000c0ffee);
+  for (auto _: state) {
+    benchmark::DoNotOptimize(
+            snprintf(message, sizeof(message), "Buffer %p acquired by %s renderer", buffer, kRenderer));
+    benchmark::ClobberMemory();
+  }
+}
+
+/**
+ * Shim prints to stderr, the closest host stand-in for logcat.
+ */
+void BM_LogAndroidPrint(benchmark::State &state) {
+  auto *buffer = reinterpret_cast<void *>(0x7b0000c0ffee);
+  const auto previous = __android_log_set_minimum_priority(ANDROID_LOG_VERBOSE);
+  fflush(stderr);
+  const int savedStderr = dup(STDERR_FILENO);
+  const int devNull = open("/dev/null", O_WRONLY);
+  dup2(devNull, STDERR_FILENO);
+  for (auto _: state) {
+    __android_log_print(ANDROID_LOG_INFO, "DzCoreNative", "Buffer %p acquired by %s renderer",
+                        buffer, kRenderer);
+  }
+  fflush(stderr);
+  dup2(savedStderr, STDERR_FILENO);
+  close(devNull);
+  close(savedStderr);
+  __android_log_set_minimum_priority(previous);
+}
+
+void BM_LogBinary(benchmark::State &state) {
+  auto *buffer = reinterpret_cast<void *>(0x7b0000c0ffee);
+  for (auto _: state) {
+    BLOG("Buffer %p acquired by %s renderer", buffer, kRenderer);
+  }
+  if (state.thread_index() == 0) {
+    // drop what was logged without printing it
+    const auto previous = __android_log_set_minimum_priority(ANDROID_LOG_SILENT);
+    BinaryLog::dump();
+    __android_log_set_minimum_priority(previous);
+  }
+}
+
+void BM_LogBinaryFormat(benchmark::State &state) {
+  BinaryLog::Entry entry;
+  entry.format = "Buffer %p acquired by %s renderer";
+  entry.argCount = 2;
+  entry.args[0].type = BinaryLog::ArgType::Pointer;
+  entry.args[0].p = reinterpret_cast<void *>(0x7b0000c0ffee);
+  entry.args[1].type = BinaryLog::ArgType::String;
+  entry.args[1].s = kRenderer;
+  char message[256];
+  for (auto _: state) {
+    benchmark::DoNotOptimize(BinaryLog::format(entry, message, sizeof(message)));
+    benchmark::ClobberMemory();
+  }
+}
+
+} // namespace
+
+BENCHMARK(BM_LogSnprintf);
+BENCHMARK(BM_LogAndroidPrint);
+BENCHMARK(BM_LogBinary)->Threads(1)->Threads(4);
+BENCHMARK(BM_LogBinaryFormat);
@@ -0,0 +1,103 @@
+#include <benchmark/benchmark.h>
+
+#include <android/hardware_buffer.h>
+#include <android/log.h>
+
+#include "bench_util.hpp"
+#include "frame_capture.hpp"
+#include "latency_tracker.hpp"
+
+// STL
+#include <future>
+
+using namespace engine::android;
+
+namespace {
+
+AHardwareBuffer *allocateRgbaBuffer(benchmark::State &state) {
+  const AHardwareBuffer_Desc desc{
+          .width = static_cast<uint32_t>(state.range(0)),
+          .height = static_cast<uint32_t>(state.range(1)),
+          .layers = 1,
+          .format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM,
+          .usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+          .stride = 0,
+          .rfu0 = 0,
+          .rfu1 = 0,
+  };
+  AHardwareBuffer *buffer = nullptr;
+  if (AHardwareBuffer_allocate(&desc, &buffer) != 0) {
+    state.SkipWithError("could not allocate hardware buffer");
+    return nullptr;
+  }
+  return buffer;
+}
+
+/**
+ * CPU side of a HardwareBufferLock capture, what the capture thread spends per still.
+ */
+void BM_CaptureCopyBuffer(benchmark::State &state) {
+  auto *buffer = allocateRgbaBuffer(state);
+  if (!buffer) {
+    return;
+  }
+  CapturedImage image;
+  for (auto _ : state) {
+    if (!FrameCapture::copyBuffer(buffer, image)) {
+      state.SkipWithError("buffer could not be copied");
+      break;
+    }
+    benchmark::DoNotOptimize(image.pixels.data());
+  }
+  setFrameCounters(state, state.range(0) * state.range(1) * 4);
+  AHardwareBuffer_release(buffer);
+}
+
+/**
+ * Request to callback of a HardwareBufferLock capture, thread hand-offs included.
+ */
+void BM_CaptureLockAndCopy(benchmark::State &state) {
+  auto *buffer = allocateRgbaBuffer(state);
+  if (!buffer) {
+    return;
+  }
+  // every capture is logged
+  __android_log_set_minimum_priority(ANDROID_LOG_ERROR);
+  FrameCapture capture;
+  for (auto _ : state) {
+    std::promise<bool> done;
+    AHardwareBuffer_acquire(buffer);
+    capture.lockAndCopy(CaptureRequest{
+            .source = CaptureSource::CameraFrame,
+            .method = CaptureMethod::HardwareBufferLock,
+            .callback = [&done](const CaptureResult &result) { done.set_value(result.ok); },
+            .requestedNanos = latencyClockNanos(),
+    }, buffer, nullptr);
+    if (!done.get_future().get()) {
+      state.SkipWithError("capture failed");
+      break;
+    }
+  }
+  setFrameCounters(state, state.range(0) * state.range(1) * 4);
+  AHardwareBuffer_release(buffer);
+}
+
+void BM_CaptureEncodePam(benchmark::State &state) {
+  CapturedImage image{
+          .width = static_cast<uint32_t>(state.range(0)),
+          .height = static_cast<uint32_t>(state.range(1)),
+          .pixels = {},
+  };
+  image.pixels.resize(size_t(image.width) * image.height * 4);
+  for (auto _ : state) {
+    auto data = FrameCapture::encodePam(image);
+    benchmark::DoNotOptimize(data.data());
+  }
+  setFrameCounters(state, state.range(0) * state.range(1) * 4);
+}
+
+BENCHMARK(BM_CaptureCopyBuffer)->Apply(frameSizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_CaptureLockAndCopy)->Apply(frameSizes)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_CaptureEncodePam)->Apply(frameSizes)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+
+#include <android/hardware_buffer.h>
+#include <android/log.h>
+
+#include "android_shim.h"
+#include "camera_ingest.hpp"
+#include "frame_source.hpp"
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace engine::android;
+
+namespace {
+
+/**
+ * Consumes every frame right away, measures what the source and the ingest alone sustain.
+ */
+class CountingConsumer : public FrameConsumer {
+public:
+  void processCameraFrame(CameraFrame frame) override {
+    if (!frame.onConsume || frame.onConsume()) {
+      ++consumed;
+    }
+    if (frame.onRelease) {
+      frame.onRelease();
+    }
+  }
+
+  std::atomic<int64_t> consumed{0};
+};
+
+void BM_GeneratePattern(benchmark::State &state) {
+  const auto pattern = static_cast<FrameSource::Pattern>(state.range(0));
+  const auto width = static_cast<uint32_t>(state.range(1));
+  const auto height = static_cast<uint32_t>(state.range(2));
+  std::vector<uint8_t> pixels(size_t(width) * height * 4);
+  uint64_t frame = 0;
+  for (auto _ : state) {
+    FrameSource::generate(pattern, 1, frame++, pixels.data(), width * 4, width, height);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * pixels.size()));
+}
+
+/**
+ * Real time run at the rate given, reports frames that could not be delivered on schedule.
+ */
+void BM_FrameSourceRealtime(benchmark::State &state) {
+  __android_log_set_minimum_priority(ANDROID_LOG_ERROR);
+  FrameSource::Config config;
+  config.width = static_cast<uint32_t>(state.range(0));
+  config.height = static_cast<uint32_t>(state.range(1));
+  config.framesPerSecond = static_cast<double>(state.range(2));
+  config.frameLimit = static_cast<uint64_t>(config.framesPerSecond / 4);
+  config.jitterNanos = 2'000'000;
+  config.burstLength = 3;
+  config.burstPeriod = 30;
+  FrameSource::Stats stats;
+  int64_t consumed = 0;
+  for (auto _ : state) {
+    CameraIngest ingest;
+    CountingConsumer consumer;
+    {
+      FrameSource source(ingest, consumer);
+      if (!source.start(config)) {
+        state.SkipWithError("could not start frame source");
+        return;
+      }
+      while (source.running()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      stats = source.stats();
+    }
+    consumed += consumer.consumed;
+  }
+  state.counters["frames"] = static_cast<double>(stats.frames);
+  state.counters["late"] = static_cast<double>(stats.late);
+  state.counters["generate_us"] = stats.frames == 0 ? 0.0 :
+          static_cast<double>(stats.generateNanos) / 1000.0 / static_cast<double>(stats.frames);
+  state.counters["consumed"] = static_cast<double>(consumed);
+  if (AShim_liveHardwareBuffers() != 0) {
+    state.SkipWithError("hardware buffers leaked");
+  }
+}
+
+} // namespace
+
+BENCHMARK(BM_GeneratePattern)
+        ->ArgsProduct({{0, 1, 2}, {1280}, {720}})
+        ->ArgsProduct({{0, 1, 2}, {3840}, {2160}})
+        ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrameSourceRealtime)
+        ->Args({1280, 720, 240})
+        ->Args({3840, 2160, 60})
+        ->Iterations(1)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <android/hardware_buffer.h>
+
+#include "android_shim.h"
+#include "bench_util.hpp"
+
+using namespace engine::android;
+
+namespace {
+
+/**
+ * Fixed cost CameraIngest pays per camera frame on top of the copy, through the host shim.
+ * Device numbers come from gralloc and differ, these only catch regressions in how often we call.
+ */
+AHardwareBuffer *allocateBuffer(benchmark::State &state, uint32_t format) {
+  const AHardwareBuffer_Desc desc{
+          .width = static_cast<uint32_t>(state.range(0)),
+          .height = static_cast<uint32_t>(state.range(1)),
+          .layers = 1,
+          .format = format,
+          .usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+          .stride = 0,
+          .rfu0 = 0,
+          .rfu1 = 0,
+  };
+  AHardwareBuffer *buffer = nullptr;
+  if (AHardwareBuffer_allocate(&desc, &buffer) != 0) {
+    state.SkipWithError("could not allocate hardware buffer");
+    return nullptr;
+  }
+  return buffer;
+}
+
+void BM_HardwareBufferDescribe(benchmark::State &state) {
+  auto *buffer = allocateBuffer(state, AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+  if (!buffer) {
+    return;
+  }
+  for (auto _ : state) {
+    AHardwareBuffer_Desc description;
+    AHardwareBuffer_describe(buffer, &description);
+    benchmark::DoNotOptimize(description);
+  }
+  AHardwareBuffer_release(buffer);
+}
+
+void BM_HardwareBufferLock(benchmark::State &state) {
+  auto *buffer = allocateBuffer(state, AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+  if (!buffer) {
+    return;
+  }
+  for (auto _ : state) {
+    void *pixels = nullptr;
+    AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &pixels);
+    benchmark::DoNotOptimize(pixels);
+    AHardwareBuffer_unlock(buffer, nullptr);
+  }
+  AHardwareBuffer_release(buffer);
+}
+
+void BM_HardwareBufferLockPlanes(benchmark::State &state) {
+  auto *buffer = allocateBuffer(state, AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420);
+  if (!buffer) {
+    return;
+  }
+  for (auto _ : state) {
+    AHardwareBuffer_Planes planes;
+    AHardwareBuffer_lockPlanes(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &planes);
+    benchmark::DoNotOptimize(planes);
+    AHardwareBuffer_unlock(buffer, nullptr);
+  }
+  AHardwareBuffer_release(buffer);
+}
+
+void BM_HardwareBufferAllocate(benchmark::State &state) {
+  for (auto _ : state) {
+    auto *buffer = allocateBuffer(state, AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+    AHardwareBuffer_release(buffer);
+  }
+  if (AShim_liveHardwareBuffers() != 0) {
+    state.SkipWithError("hardware buffers leaked");
+  }
+}
+
+BENCHMARK(BM_HardwareBufferDescribe)->Apply(frameSizes);
+BENCHMARK(BM_HardwareBufferLock)->Apply(frameSizes);
+BENCHMARK(BM_HardwareBufferLockPlanes)->Apply(frameSizes);
+BENCHMARK(BM_HardwareBufferAllocate)->Apply(frameSizes)->Unit(benchmark::kMicrosecond);
+
+} // namespace
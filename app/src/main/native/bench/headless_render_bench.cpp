@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+
+#include <android/hardware_buffer.h>
+#include <android/log.h>
+
+#include "bench_util.hpp"
+#include "camera_ingest.hpp"
+#include "opengl_renderer.hpp"
+
+// STL
+#include <cstdlib>
+#include <cstring>
+#include <future>
+
+using namespace engine::android;
+
+namespace {
+
+AHardwareBuffer *allocateCameraBuffer(benchmark::State &state) {
+  // what CameraX hands out: CPU only, not GPU sampled
+  const AHardwareBuffer_Desc desc{
+          .width = static_cast<uint32_t>(state.range(0)),
+          .height = static_cast<uint32_t>(state.range(1)),
+          .layers = 1,
+          .format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM,
+          .usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+          .stride = 0,
+          .rfu0 = 0,
+          .rfu1 = 0,
+  };
+  AHardwareBuffer *buffer = nullptr;
+  if (AHardwareBuffer_allocate(&desc, &buffer) != 0) {
+    state.SkipWithError("could not allocate hardware buffer");
+    return nullptr;
+  }
+  return buffer;
+}
+
+bool fillBuffer(AHardwareBuffer *buffer, const uint8_t (&rgba)[4]) {
+  AHardwareBuffer_Desc desc;
+  AHardwareBuffer_describe(buffer, &desc);
+  void *data = nullptr;
+  if (AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &data) != 0) {
+    return false;
+  }
+  for (uint32_t row = 0; row < desc.height; ++row) {
+    auto *pixel = static_cast<uint8_t *>(data) + size_t(row) * desc.stride * 4;
+    for (uint32_t column = 0; column < desc.width; ++column, pixel += 4) {
+      memcpy(pixel, rgba, 4);
+    }
+  }
+  AHardwareBuffer_unlock(buffer, nullptr);
+  return true;
+}
+
+/**
+ * Camera frame to rendered pixels in CPU memory on the headless OpenGL ES renderer: ingest copy,
+ * upload, draw and GlPixelBuffer readback. Runs on Mesa llvmpipe when there is no GPU, fails
+ * unless the middle of every readback has the colour of the frame sent right before it.
+ */
+void BM_HeadlessDrawAndReadback(benchmark::State &state) {
+  // there is no display server, makes Mesa hand out a surfaceless display for EGL_DEFAULT_DISPLAY
+  setenv("EGL_PLATFORM", "surfaceless", 0);
+  // every capture is logged
+  __android_log_set_minimum_priority(ANDROID_LOG_ERROR);
+  auto *buffer = allocateCameraBuffer(state);
+  if (!buffer) {
+    return;
+  }
+  const int width = static_cast<int>(state.range(0));
+  const int height = static_cast<int>(state.range(1));
+  // staging slots are handed back by the renderer, ingest has to outlive it
+  CameraIngest ingest;
+  OpenGLRenderer renderer;
+  if (!renderer.startHeadless(width, height)) {
+    state.SkipWithError("headless rendering could not be started");
+    AHardwareBuffer_release(buffer);
+    return;
+  }
+  uint32_t frame = 0;
+  for (auto _ : state) {
+    ++frame;
+    const uint8_t rgba[4] = {
+            static_cast<uint8_t>(frame * 7),
+            static_cast<uint8_t>(255 - frame * 3),
+            static_cast<uint8_t>(frame * 11),
+            255,
+    };
+    if (!fillBuffer(buffer, rgba)) {
+      state.SkipWithError("camera buffer could not be written");
+      break;
+    }
+    ingest.sendCameraFrame(renderer, buffer, 0, true);
+    // queued behind the frame, read back from its draw
+    std::promise<CaptureResult> done;
+    renderer.capture(CaptureSource::RenderedOutput, CaptureMethod::GlPixelBuffer,
+                     [&done](const CaptureResult &result) { done.set_value(result); });
+    const auto result = done.get_future().get();
+    if (!result.ok || result.image.width != static_cast<uint32_t>(width)
+        || result.image.height != static_cast<uint32_t>(height)) {
+      state.SkipWithError("readback failed");
+      break;
+    }
+    const auto *center = result.image.pixels.data()
+            + (size_t(height / 2) * width + width / 2) * 4;
+    if (memcmp(center, rgba, 4) != 0) {
+      state.SkipWithError("readback does not match the camera frame");
+      break;
+    }
+  }
+  setFrameCounters(state, state.range(0) * state.range(1) * 4);
+  renderer.stopHeadless();
+  AHardwareBuffer_release(buffer);
+}
+
+BENCHMARK(BM_HeadlessDrawAndReadback)
+        ->ArgNames({"width", "height"})
+        ->Args({640, 480})
+        ->Args({1280, 720})
+        ->Unit(benchmark::kMicrosecond)
+        ->UseRealTime();
+
+} // namespace
@@ -0,0 +1,182 @@
+#include <benchmark/benchmark.h>
+
+#include <android/hardware_buffer.h>
+#include <android/log.h>
+
+#include "android_shim.h"
+#include "bench_util.hpp"
+#include "camera_ingest.hpp"
+#include "frame_hub.hpp"
+#include "looper_thread.hpp"
+
+// STL
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+using namespace engine::android;
+
+namespace {
+
+/**
+ * Stands in for a renderer: frames hop to a looper thread where they are consumed
+ * and the previous one is released, same as BaseRenderer does around hwBufferToTexture.
+ */
+class LooperConsumer : public FrameConsumer {
+public:
+  ~LooperConsumer() override {
+    renderThread.reset();
+    if (currentFrameRelease) {
+      currentFrameRelease();
+    }
+  }
+
+  void processCameraFrame(CameraFrame frame) override {
+    AHardwareBuffer_acquire(frame.buffer);
+    renderThread->scheduleTask([this, frame = std::move(frame)] {
+      if (frame.onConsume && !frame.onConsume()) {
+        ++stale;
+        if (frame.onRelease) {
+          frame.onRelease();
+        }
+      } else {
+        ++consumed;
+        if (currentFrameRelease) {
+          currentFrameRelease();
+        }
+        currentFrameRelease = frame.onRelease;
+      }
+      AHardwareBuffer_release(frame.buffer);
+    });
+  }
+
+  std::atomic<int64_t> consumed{0};
+  std::atomic<int64_t> stale{0};
+
+private:
+  std::function<void()> currentFrameRelease;
+  std::unique_ptr<LooperThread> renderThread = std::make_unique<LooperThread>();
+};
+
+AHardwareBuffer *allocateCameraBuffer(uint32_t width, uint32_t height, uint32_t format) {
+  // what CameraX hands out: CPU only, not GPU sampled
+  const AHardwareBuffer_Desc desc{
+          .width = width,
+          .height = height,
+          .layers = 1,
+          .format = format,
+          .usage = AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+          .stride = 0,
+          .rfu0 = 0,
+          .rfu1 = 0,
+  };
+  AHardwareBuffer *buffer = nullptr;
+  if (AHardwareBuffer_allocate(&desc, &buffer) != 0) {
+    return nullptr;
+  }
+  AHardwareBuffer_Planes planes;
+  AHardwareBuffer_lockPlanes(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &planes);
+  for (uint32_t plane = 0; plane < planes.planeCount; ++plane) {
+    const uint32_t rows = plane == 0 ? height : (height + 1) / 2;
+    memset(planes.planes[plane].data, static_cast<int>(0x40 + plane * 0x20),
+           size_t(planes.planes[plane].rowStride) * rows);
+  }
+  AHardwareBuffer_unlock(buffer, nullptr);
+  return buffer;
+}
+
+void ingestFrames(benchmark::State &state, uint32_t format) {
+  __android_log_set_minimum_priority(ANDROID_LOG_ERROR);
+  const auto width = static_cast<uint32_t>(state.range(0));
+  const auto height = static_cast<uint32_t>(state.range(1));
+  AHardwareBuffer *cameraBuffer = allocateCameraBuffer(width, height, format);
+  if (!cameraBuffer) {
+    state.SkipWithError("could not allocate camera buffer");
+    return;
+  }
+  int64_t consumed;
+  int64_t stale;
+  StagingRing::Stats stats;
+  {
+    CameraIngest ingest;
+    // destroyed before the ingest as its looper thread still references the staging ring
+    LooperConsumer consumer;
+    for (auto _ : state) {
+      ingest.sendCameraFrame(consumer, cameraBuffer, 90, true);
+    }
+    stats = ingest.stagingStats();
+    consumed = consumer.consumed;
+    stale = consumer.stale;
+  }
+  AHardwareBuffer_release(cameraBuffer);
+  state.counters["consumed"] = static_cast<double>(consumed);
+  state.counters["stale"] = static_cast<double>(stale);
+  state.counters["steals"] = static_cast<double>(stats.steals);
+  state.counters["exhausted"] = static_cast<double>(stats.exhausted);
+  // RGBA written into the staging ring per camera frame
+  setFrameCounters(state, static_cast<int64_t>(width) * height * 4);
+  if (AShim_liveHardwareBuffers() != 0) {
+    state.SkipWithError("hardware buffers leaked");
+  }
+}
+
+/**
+ * Two renderers displaying the same camera, either each one ingesting the buffer on its own
+ * or the buffer ingested once and fanned out through FrameHub.
+ */
+void BM_IngestFramesTwice(benchmark::State &state, bool fanOut) {
+  __android_log_set_minimum_priority(ANDROID_LOG_ERROR);
+  const auto width = static_cast<uint32_t>(state.range(0));
+  const auto height = static_cast<uint32_t>(state.range(1));
+  AHardwareBuffer *cameraBuffer = allocateCameraBuffer(width, height, AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420);
+  if (!cameraBuffer) {
+    state.SkipWithError("could not allocate camera buffer");
+    return;
+  }
+  int64_t consumed;
+  int64_t stale;
+  {
+    CameraIngest firstIngest;
+    CameraIngest secondIngest;
+    FrameHub hub;
+    LooperConsumer first;
+    LooperConsumer second;
+    hub.attach(first);
+    hub.attach(second);
+    for (auto _ : state) {
+      if (fanOut) {
+        firstIngest.sendCameraFrame(hub, cameraBuffer, 90, true);
+      } else {
+        firstIngest.sendCameraFrame(first, cameraBuffer, 90, true);
+        secondIngest.sendCameraFrame(second, cameraBuffer, 90, true);
+      }
+    }
+    consumed = first.consumed + second.consumed;
+    stale = first.stale + second.stale;
+  }
+  AHardwareBuffer_release(cameraBuffer);
+  state.counters["consumed"] = static_cast<double>(consumed);
+  state.counters["stale"] = static_cast<double>(stale);
+  // RGBA written into the staging ring per camera frame
+  setFrameCounters(state, static_cast<int64_t>(width) * height * 4);
+  if (AShim_liveHardwareBuffers() != 0) {
+    state.SkipWithError("hardware buffers leaked");
+  }
+}
+
+void BM_IngestRgba(benchmark::State &state) {
+  ingestFrames(state, AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+}
+
+void BM_IngestYuv(benchmark::State &state) {
+  ingestFrames(state, AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420);
+}
+
+#define FRAME_SIZES ->Apply(frameSizes)->UseRealTime()->Unit(benchmark::kMicrosecond)
+
+BENCHMARK(BM_IngestRgba) FRAME_SIZES;
+BENCHMARK(BM_IngestYuv) FRAME_SIZES;
+BENCHMARK_CAPTURE(BM_IngestFramesTwice, PerRenderer, false) FRAME_SIZES;
+BENCHMARK_CAPTURE(BM_IngestFramesTwice, FanOut, true) FRAME_SIZES;
+
+}  // namespace
@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+
+#include "mvp.hpp"
+
+using namespace engine::android;
+
+namespace {
+
+/**
+ * BaseRenderer::updateMvp runs on every rotation, aspect or camera change, not per frame,
+ * still it sits on the render thread right before the import.
+ */
+void BM_CameraMvp(benchmark::State &state) {
+  MvpParams params{
+          .viewportRatio = 1080.f / 2400.f,
+          .bufferImageRatio = 1920.f / 1080.f,
+          .rotationDegrees = 90,
+          .backCamera = true,
+          .flipClipY = state.range(0) != 0,
+  };
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(params);
+    auto mvp = cameraMvp(params);
+    benchmark::DoNotOptimize(mvp);
+  }
+}
+
+BENCHMARK(BM_CameraMvp)->ArgName("vulkan")->Arg(0)->Arg(1);
+
+} // namespace
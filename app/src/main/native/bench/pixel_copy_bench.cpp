@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_util.hpp"
+#include "pixel_copy.hpp"
+
+// STL
+#include <cstring>
+#include <vector>
+
+using namespace engine::android;
+
+namespace {
+
+constexpr size_t kBytesPerPixel = 4;
+
+/**
+ * RGBA frame with the kind of row padding camera HALs and gralloc produce.
+ */
+struct Frame {
+  Frame(size_t width, size_t height, size_t stridePixels)
+          : width(width), height(height), stride(stridePixels * kBytesPerPixel),
+            data(stride * height) {}
+
+  size_t rowBytes() const { return width * kBytesPerPixel; }
+
+  size_t width;
+  size_t height;
+  size_t stride;
+  std::vector<uint8_t> data;
+};
+
+bool sameVisiblePixels(const Frame &a, const Frame &b) {
+  for (size_t row = 0; row < a.height; ++row) {
+    if (memcmp(a.data.data() + row * a.stride, b.data.data() + row * b.stride, a.rowBytes())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void copyFrame(benchmark::State &state, CopyKernel kernel, bool nonTemporal) {
+  const auto width = static_cast<size_t>(state.range(0));
+  const auto height = static_cast<size_t>(state.range(1));
+  // source padded to 64 pixels like most camera HALs, destination has a different padding
+  Frame src(width, height, (width + 63) & ~size_t(63));
+  Frame dst(width, height, (width + 31) & ~size_t(31));
+  Frame reference(width, height, dst.stride / kBytesPerPixel);
+  for (size_t i = 0; i < src.data.size(); ++i) {
+    src.data[i] = static_cast<uint8_t>(i * 31u);
+  }
+
+  copyPlaneScalar(src.data.data(), src.stride, reference.data.data(), reference.stride,
+                  src.rowBytes(), height);
+  copyPlane(kernel, nonTemporal, src.data.data(), src.stride, dst.data.data(), dst.stride,
+            src.rowBytes(), height);
+  if (!sameVisiblePixels(reference, dst)) {
+    state.SkipWithError("kernel output differs from scalar reference");
+    return;
+  }
+
+  for (auto _ : state) {
+    copyPlane(kernel, nonTemporal, src.data.data(), src.stride, dst.data.data(), dst.stride,
+              src.rowBytes(), height);
+    benchmark::ClobberMemory();
+  }
+  setFrameCounters(state, static_cast<int64_t>(src.rowBytes() * height));
+  state.SetLabel(copyKernelName(kernel));
+}
+
+void BM_CopyScalarReference(benchmark::State &state) {
+  const auto width = static_cast<size_t>(state.range(0));
+  const auto height = static_cast<size_t>(state.range(1));
+  Frame src(width, height, (width + 63) & ~size_t(63));
+  Frame dst(width, height, (width + 31) & ~size_t(31));
+  for (auto _ : state) {
+    copyPlaneScalar(src.data.data(), src.stride, dst.data.data(), dst.stride,
+                    src.rowBytes(), height);
+    benchmark::ClobberMemory();
+  }
+  setFrameCounters(state, static_cast<int64_t>(src.rowBytes() * height));
+}
+
+void BM_CopyMemcpy(benchmark::State &state) {
+  copyFrame(state, CopyKernel::Memcpy, false);
+}
+
+void BM_CopyBest(benchmark::State &state) {
+  copyFrame(state, bestCopyKernel(), false);
+}
+
+void BM_CopyBestNonTemporal(benchmark::State &state) {
+  copyFrame(state, bestCopyKernel(), true);
+}
+
+#if defined(__SSE2__)
+void BM_CopySse2(benchmark::State &state) {
+  copyFrame(state, CopyKernel::Sse2, false);
+}
+
+void BM_CopySse2NonTemporal(benchmark::State &state) {
+  copyFrame(state, CopyKernel::Sse2, true);
+}
+#endif
+
+#define FRAME_SIZES ->Apply(frameSizes)->Unit(benchmark::kMicrosecond)
+
+BENCHMARK(BM_CopyScalarReference) FRAME_SIZES;
+BENCHMARK(BM_CopyMemcpy) FRAME_SIZES;
+BENCHMARK(BM_CopyBest) FRAME_SIZES;
+BENCHMARK(BM_CopyBestNonTemporal) FRAME_SIZES;
+#if defined(__SSE2__)
+BENCHMARK(BM_CopySse2) FRAME_SIZES;
+BENCHMARK(BM_CopySse2NonTemporal) FRAME_SIZES;
+#endif
+
+}  // namespace
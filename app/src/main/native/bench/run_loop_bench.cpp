@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <android/looper.h>
+
+#include "run_loop.hpp"
+
+// STL
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+using namespace engine::android;
+
+namespace {
+
+constexpr size_t kTasksPerBurst = 1000;
+
+/**
+ * Same as LooperThread but keeps the RunLoop reachable to read its stats and pick the wake fd.
+ */
+class StatsLooperThread {
+public:
+  explicit StatsLooperThread(internal::WakeFd::Kind kind) {
+    std::promise<void> created;
+    auto createdFuture = created.get_future();
+    thread = std::thread([&] {
+      runLoop = std::make_unique<RunLoop>(ALooper_prepare(0), kind);
+      created.set_value();
+      runLoop->run();
+    });
+    createdFuture.wait();
+  }
+
+  ~StatsLooperThread() {
+    runLoop->stop();
+    thread.join();
+  }
+
+  std::unique_ptr<RunLoop> runLoop;
+
+private:
+  std::thread thread;
+};
+
+/**
+ * Schedules bursts of 1000 tasks and waits for the looper to run them, arg 0 is the wake fd kind
+ * (0 eventfd, 1 pipe) and arg 1 is how many tasks are scheduled back to back before yielding,
+ * 1 being the worst case for wake coalescing. Syscalls are counted by RunLoop itself.
+ */
+void BM_RunLoopSchedule(benchmark::State &state) {
+  const auto kind = state.range(0) == 0 ? internal::WakeFd::Kind::EventFd
+                                        : internal::WakeFd::Kind::Pipe;
+  const auto spacing = static_cast<size_t>(state.range(1));
+  StatsLooperThread looperThread(kind);
+  RunLoop &runLoop = *looperThread.runLoop;
+  std::atomic<size_t> executed{0};
+  size_t scheduled = 0;
+  const auto before = runLoop.stats();
+
+  for (auto _ : state) {
+    for (size_t task = 0; task < kTasksPerBurst; ++task) {
+      runLoop.schedule([&executed] { executed.fetch_add(1, std::memory_order_relaxed); });
+      if ((task + 1) % spacing == 0) {
+        std::this_thread::yield();
+      }
+    }
+    scheduled += kTasksPerBurst;
+    while (executed.load(std::memory_order_relaxed) < scheduled) {
+      std::this_thread::yield();
+    }
+  }
+
+  const auto after = runLoop.stats();
+  const double perThousand = 1000.0 / static_cast<double>(after.scheduled - before.scheduled);
+  state.SetItemsProcessed(static_cast<int64_t>(scheduled));
+  state.counters["eventfd"] = runLoop.wakeKind() == internal::WakeFd::Kind::EventFd ? 1 : 0;
+  state.counters["syscalls_per_1k"] = static_cast<double>(after.syscalls - before.syscalls) * perThousand;
+  state.counters["wakes_per_1k"] = static_cast<double>(after.wakes - before.wakes) * perThousand;
+  state.counters["batches_per_1k"] = static_cast<double>(after.batches - before.batches) * perThousand;
+}
+
+BENCHMARK(BM_RunLoopSchedule)
+        ->ArgsProduct({{0, 1}, {1, 1000}})
+        ->UseRealTime()
+        ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
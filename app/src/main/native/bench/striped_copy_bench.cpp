@@ -0,0 +1,40 @@
+#include <benchmark/benchmark.h>
+
+#include "pixel_copy.hpp"
+#include "worker_pool.hpp"
+
+// STL
+#include <memory>
+#include <vector>
+
+using namespace engine::android;
+
+namespace {
+
+/**
+ * Scaling curve of the striped CameraX frame copy, args are width, height and thread count.
+ */
+void BM_StripedCopy(benchmark::State &state) {
+  const auto width = static_cast<size_t>(state.range(0));
+  const auto height = static_cast<size_t>(state.range(1));
+  const auto threads = static_cast<size_t>(state.range(2));
+  const size_t rowBytes = width * 4;
+  const size_t srcStride = ((width + 63) & ~size_t(63)) * 4;
+  const size_t dstStride = ((width + 31) & ~size_t(31)) * 4;
+  std::vector<uint8_t> src(srcStride * height, 0x5a);
+  std::vector<uint8_t> dst(dstStride * height);
+  WorkerPool pool(threads);
+  for (auto _ : state) {
+    copyPlaneStriped(pool, threads, src.data(), srcStride, dst.data(), dstStride, rowBytes, height);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * rowBytes * height));
+  state.counters["threads"] = static_cast<double>(threads);
+}
+
+BENCHMARK(BM_StripedCopy)
+        ->ArgsProduct({{3840}, {2160}, {1, 2, 3, 4, 5, 6, 7, 8}})
+        ->UseRealTime()
+        ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+
+#include "task_queue.hpp"
+
+// STL
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace engine::android;
+
+namespace {
+
+constexpr size_t kTasksPerProducer = 20000;
+
+/**
+ * What RunLoop used before TaskQueue: every schedule locks, consumer swaps the deque out under the lock.
+ */
+class MutexTaskQueue {
+public:
+  using Task = std::function<void()>;
+
+  void push(Task &&task) {
+    auto ptr = std::make_unique<Task>(std::move(task));
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.emplace_back(std::move(ptr));
+  }
+
+  template<typename Fn>
+  void drain(Fn &&fn) {
+    std::deque<std::unique_ptr<Task>> ready{};
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      while (!tasks.empty()) {
+        ready.emplace_back(std::move(tasks.front()));
+        tasks.pop_front();
+      }
+    }
+    while (!ready.empty()) {
+      fn(*ready.front());
+      ready.pop_front();
+    }
+  }
+
+private:
+  std::mutex mutex;
+  std::deque<std::unique_ptr<Task>> tasks;
+};
+
+class LockFreeTaskQueue {
+public:
+  void push(TaskQueue::Task &&task) { queue.push(std::move(task)); }
+
+  template<typename Fn>
+  void drain(Fn &&fn) {
+    while (auto node = queue.pop()) {
+      fn(node->task);
+    }
+  }
+
+private:
+  TaskQueue queue;
+};
+
+/**
+ * N producer threads schedule small tasks while the benchmark thread plays the render thread
+ * and runs them, arg is the producer count.
+ */
+template<typename Queue>
+void BM_TaskQueue(benchmark::State &state) {
+  const auto producers = static_cast<size_t>(state.range(0));
+  const size_t total = producers * kTasksPerProducer;
+  for (auto _ : state) {
+    Queue queue;
+    size_t executed = 0;
+    std::atomic<bool> start{false};
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    for (size_t i = 0; i < producers; ++i) {
+      threads.emplace_back([&] {
+        while (!start.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        for (size_t task = 0; task < kTasksPerProducer; ++task) {
+          queue.push([&executed] { ++executed; });
+        }
+      });
+    }
+    start.store(true, std::memory_order_release);
+    while (executed < total) {
+      queue.drain([](auto &task) { task(); });
+    }
+    for (auto &thread: threads) {
+      thread.join();
+    }
+    benchmark::DoNotOptimize(executed);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * total));
+  state.counters["producers"] = static_cast<double>(producers);
+}
+
+BENCHMARK_TEMPLATE(BM_TaskQueue, MutexTaskQueue)
+        ->Arg(1)->Arg(2)->Arg(4)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_TaskQueue, LockFreeTaskQueue)
+        ->Arg(1)->Arg(2)->Arg(4)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+
+#include "trace.hpp"
+
+// STL
+#include <cstdlib>
+
+using namespace engine::android;
+
+namespace {
+
+/**
+ * What every pipeline stage pays while nobody is tracing.
+ */
+void BM_TraceScopeDisabled(benchmark::State &state) {
+  Trace::setRecording(false);
+  for (auto _: state) {
+    TRACE_SCOPE("stage");
+    benchmark::ClobberMemory();
+  }
+}
+
+void BM_TraceScopeRecording(benchmark::State &state) {
+  if (state.thread_index() == 0) {
+    Trace::clear();
+    Trace::setRecording(true);
+  }
+  for (auto _: state) {
+    TRACE_SCOPE("stage");
+    benchmark::ClobberMemory();
+  }
+  if (state.thread_index() == 0) {
+    Trace::setRecording(false);
+  }
+}
+
+void BM_TraceChromeJson(benchmark::State &state) {
+  Trace::clear();
+  Trace::setRecording(true);
+  for (size_t i = 0; i < Trace::kRingSize; ++i) {
+    TRACE_SCOPE("stage");
+  }
+  Trace::setRecording(false);
+  for (auto _: state) {
+    benchmark::DoNotOptimize(Trace::chromeTraceJson());
+  }
+  // ENGINE_TRACE_JSON=/tmp/trace.json to have a look at the output in a viewer
+  if (const char *path = std::getenv("ENGINE_TRACE_JSON")) {
+    Trace::exportChromeTrace(path);
+  }
+  Trace::clear();
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * Trace::kRingSize));
+}
+
+} // namespace
+
+BENCHMARK(BM_TraceScopeDisabled);
+BENCHMARK(BM_TraceScopeRecording)->Threads(1)->Threads(4);
+BENCHMARK(BM_TraceChromeJson)->Unit(benchmark::kMillisecond);
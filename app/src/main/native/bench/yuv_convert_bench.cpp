@@ -0,0 +1,129 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_util.hpp"
+#include "yuv_convert.hpp"
+#include "worker_pool.hpp"
+
+// STL
+#include <cstring>
+#include <vector>
+
+using namespace engine::android;
+
+namespace {
+
+constexpr size_t kBytesPerPixel = 4;
+
+/**
+ * 4:2:0 frame laid out the way camera HALs hand it out through AHardwareBuffer_lockPlanes,
+ * rows padded to 64 bytes.
+ */
+struct YuvFrame {
+  YuvFrame(size_t width, size_t height, bool semiPlanar)
+          : yStride((width + 63) & ~size_t(63)),
+            uvStride(semiPlanar ? yStride : ((width / 2 + 63) & ~size_t(63))),
+            luma(yStride * height),
+            chroma(uvStride * (height / 2) * (semiPlanar ? 1 : 2)) {
+    for (size_t i = 0; i < luma.size(); ++i) {
+      luma[i] = static_cast<uint8_t>(i * 7u);
+    }
+    for (size_t i = 0; i < chroma.size(); ++i) {
+      chroma[i] = static_cast<uint8_t>(i * 13u + 5u);
+    }
+    planes.y = luma.data();
+    planes.yRowStride = yStride;
+    planes.uvRowStride = uvStride;
+    if (semiPlanar) {
+      // NV12
+      planes.u = chroma.data();
+      planes.v = chroma.data() + 1;
+      planes.uvPixelStride = 2;
+    } else {
+      // I420
+      planes.u = chroma.data();
+      planes.v = chroma.data() + uvStride * (height / 2);
+      planes.uvPixelStride = 1;
+    }
+  }
+
+  size_t yStride;
+  size_t uvStride;
+  std::vector<uint8_t> luma;
+  std::vector<uint8_t> chroma;
+  YuvPlanes planes;
+};
+
+void convertFrame(benchmark::State &state, bool semiPlanar, bool scalar) {
+  const auto width = static_cast<size_t>(state.range(0));
+  const auto height = static_cast<size_t>(state.range(1));
+  YuvFrame frame(width, height, semiPlanar);
+  const size_t dstStride = width * kBytesPerPixel;
+  std::vector<uint8_t> dst(dstStride * height);
+  std::vector<uint8_t> reference(dstStride * height);
+
+  for (const auto matrix: {YuvMatrix::Bt601, YuvMatrix::Bt709}) {
+    for (const auto range: {YuvRange::Full, YuvRange::Limited}) {
+      yuvToRgbaScalar(frame.planes, reference.data(), dstStride, width, 0, height, matrix, range);
+      yuvToRgba(frame.planes, dst.data(), dstStride, width, 0, height, matrix, range);
+      if (memcmp(reference.data(), dst.data(), dst.size())) {
+        state.SkipWithError("kernel output differs from scalar reference");
+        return;
+      }
+    }
+  }
+
+  for (auto _ : state) {
+    if (scalar) {
+      yuvToRgbaScalar(frame.planes, dst.data(), dstStride, width, 0, height,
+                      YuvMatrix::Bt601, YuvRange::Full);
+    } else {
+      yuvToRgba(frame.planes, dst.data(), dstStride, width, 0, height,
+                YuvMatrix::Bt601, YuvRange::Full);
+    }
+    benchmark::ClobberMemory();
+  }
+  // RGBA written per frame
+  setFrameCounters(state, static_cast<int64_t>(dstStride * height));
+  state.SetLabel(scalar ? "scalar" : yuvKernelName());
+}
+
+void BM_YuvNv12Scalar(benchmark::State &state) {
+  convertFrame(state, true, true);
+}
+
+void BM_YuvNv12(benchmark::State &state) {
+  convertFrame(state, true, false);
+}
+
+void BM_YuvI420Scalar(benchmark::State &state) {
+  convertFrame(state, false, true);
+}
+
+void BM_YuvI420(benchmark::State &state) {
+  convertFrame(state, false, false);
+}
+
+void BM_YuvNv12Striped(benchmark::State &state) {
+  const size_t width = 3840;
+  const size_t height = 2160;
+  const auto threads = static_cast<size_t>(state.range(0));
+  YuvFrame frame(width, height, true);
+  std::vector<uint8_t> dst(width * kBytesPerPixel * height);
+  WorkerPool pool(threads);
+  for (auto _ : state) {
+    yuvToRgbaStriped(pool, threads, frame.planes, dst.data(), width * kBytesPerPixel,
+                     width, height, YuvMatrix::Bt601, YuvRange::Full);
+    benchmark::ClobberMemory();
+  }
+  setFrameCounters(state, static_cast<int64_t>(width * kBytesPerPixel * height));
+}
+
+#define FRAME_SIZES ->Apply(frameSizes)->Unit(benchmark::kMicrosecond)
+
+BENCHMARK(BM_YuvNv12Scalar) FRAME_SIZES;
+BENCHMARK(BM_YuvNv12) FRAME_SIZES;
+BENCHMARK(BM_YuvI420Scalar) FRAME_SIZES;
+BENCHMARK(BM_YuvI420) FRAME_SIZES;
+BENCHMARK(BM_YuvNv12Striped)->Arg(1)->Arg(2)->Arg(4)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+}  // namespace
@@ -0,0 +1,47 @@
+# Writes a header embedding a shader as a constexpr array, run in script mode:
+#   cmake -DNAME=kCameraVert -DINPUT=<file> -DKIND=spirv|glsl -DOUTPUT=<header> -P embed_shader.cmake
+# spirv embeds compiled SPIR-V words as ${NAME}Spv, glsl embeds the source as ${NAME}Glsl for runtime compilation.
+
+foreach (var NAME INPUT KIND OUTPUT)
+    if (NOT DEFINED ${var})
+        message(FATAL_ERROR "embed_shader.cmake: ${var} is not set")
+    endif ()
+endforeach ()
+
+get_filename_component(INPUT_NAME ${INPUT} NAME)
+
+if (KIND STREQUAL "spirv")
+    file(READ ${INPUT} HEX HEX)
+    string(LENGTH "${HEX}" HEX_LENGTH)
+    math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+    if (HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+        message(FATAL_ERROR "${INPUT} is not a SPIR-V binary")
+    endif ()
+    # SPIR-V is a stream of little-endian 32 bit words
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " WORDS "${HEX}")
+    # eight words per line, CMake regex has no {n} quantifier
+    set(WORD "0x[0-9a-f]+u, ")
+    string(REGEX REPLACE "(${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}0x[0-9a-f]+u,) "
+           "\\1\n        " WORDS "${WORDS}")
+    string(STRIP "${WORDS}" WORDS)
+    set(BODY "constexpr uint32_t ${NAME}Spv[] = {\n        ${WORDS}\n};")
+elseif (KIND STREQUAL "glsl")
+    file(READ ${INPUT} SOURCE)
+    set(BODY "constexpr const char ${NAME}Glsl[] = R\"glsl(${SOURCE})glsl\";")
+else ()
+    message(FATAL_ERROR "embed_shader.cmake: unknown KIND ${KIND}")
+endif ()
+
+file(WRITE ${OUTPUT} "// Generated from ${INPUT_NAME} by embed_shader.cmake, do not edit.
+#pragma once
+
+#include <cstdint>
+
+namespace engine {
+namespace shaders {
+
+${BODY}
+
+} // namespace shaders
+} // namespace engine
+")
@@ -0,0 +1,64 @@
+# Vulkan shaders are compiled to SPIR-V at build time with glslc shipped in the NDK and embedded
+# as constexpr uint32_t arrays. With ENGINE_RUNTIME_SHADERC GLSL sources are embedded instead and
+# compiled on device by libs/shaderc, handy when experimenting with shader code.
+
+option(ENGINE_RUNTIME_SHADERC "Compile Vulkan shaders at runtime with libshaderc instead of at build time" OFF)
+
+set(ENGINE_EMBED_SHADER_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/embed_shader.cmake)
+
+if (NOT ENGINE_RUNTIME_SHADERC)
+    find_program(
+        GLSLC glslc
+        HINTS ${ANDROID_NDK}/shader-tools/${ANDROID_NDK_HOST_SYSTEM_NAME}
+    )
+    if (NOT GLSLC)
+        message(FATAL_ERROR "glslc not found, install NDK shader tools or configure with -DENGINE_RUNTIME_SHADERC=ON")
+    endif ()
+endif ()
+
+# engine_embed_shaders(<target> <shader>...)
+# camera.vert becomes shaders/camera_vert.h defining engine::shaders::kCameraVertSpv (or kCameraVertGlsl)
+function(engine_embed_shaders TARGET)
+    set(GENERATED_DIR ${CMAKE_CURRENT_BINARY_DIR}/generated)
+    file(MAKE_DIRECTORY ${GENERATED_DIR}/shaders)
+    foreach (SHADER ${ARGN})
+        get_filename_component(SHADER ${SHADER} ABSOLUTE)
+        get_filename_component(SHADER_FILE ${SHADER} NAME)
+        string(REPLACE "." "_" HEADER_NAME ${SHADER_FILE})
+        set(HEADER ${GENERATED_DIR}/shaders/${HEADER_NAME}.h)
+
+        string(REPLACE "_" ";" NAME_PARTS ${HEADER_NAME})
+        set(NAME "k")
+        foreach (PART ${NAME_PARTS})
+            string(SUBSTRING ${PART} 0 1 FIRST)
+            string(TOUPPER ${FIRST} FIRST)
+            string(SUBSTRING ${PART} 1 -1 REST)
+            string(APPEND NAME ${FIRST}${REST})
+        endforeach ()
+
+        if (ENGINE_RUNTIME_SHADERC)
+            add_custom_command(
+                OUTPUT ${HEADER}
+                COMMAND ${CMAKE_COMMAND} -DNAME=${NAME} -DINPUT=${SHADER} -DKIND=glsl -DOUTPUT=${HEADER}
+                        -P ${ENGINE_EMBED_SHADER_SCRIPT}
+                DEPENDS ${SHADER} ${ENGINE_EMBED_SHADER_SCRIPT}
+                COMMENT "Embedding GLSL ${SHADER_FILE}"
+            )
+        else ()
+            set(SPIRV ${GENERATED_DIR}/shaders/${SHADER_FILE}.spv)
+            add_custom_command(
+                OUTPUT ${HEADER}
+                COMMAND ${GLSLC} --target-env=vulkan1.1 -O -o ${SPIRV} ${SHADER}
+                COMMAND ${CMAKE_COMMAND} -DNAME=${NAME} -DINPUT=${SPIRV} -DKIND=spirv -DOUTPUT=${HEADER}
+                        -P ${ENGINE_EMBED_SHADER_SCRIPT}
+                DEPENDS ${SHADER} ${ENGINE_EMBED_SHADER_SCRIPT}
+                COMMENT "Compiling ${SHADER_FILE} to SPIR-V"
+            )
+        endif ()
+        target_sources(${TARGET} PRIVATE ${HEADER})
+    endforeach ()
+    target_include_directories(${TARGET} PRIVATE ${GENERATED_DIR})
+    if (ENGINE_RUNTIME_SHADERC)
+        target_compile_definitions(${TARGET} PRIVATE ENGINE_RUNTIME_SHADERC)
+    endif ()
+endfunction()
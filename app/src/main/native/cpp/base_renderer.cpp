@@ -1,13 +1,46 @@
 #include "base_renderer.hpp"
 
+#include <android/looper.h>
+
 namespace engine {
 namespace android {
 
+namespace {
+
+/**
+ * Runs the release of a camera frame once both renderer and capture are done with it.
+ */
+struct ReleaseGuard {
+  ~ReleaseGuard() {
+    if (release) {
+      release();
+    }
+  }
+
+  std::function<void()> release;
+};
+
+} // namespace
+
 BaseRenderer::BaseRenderer() : renderThread(std::make_unique<LooperThread>()) {
 }
 
 BaseRenderer::~BaseRenderer() {
   renderThread.reset();
+  // render thread is gone, frame still sitting in the mailbox will never be imported
+  if (auto pending = mailbox.take()) {
+    AHardwareBuffer_release(pending->buffer);
+    if (pending->onRelease) {
+      pending->onRelease();
+    }
+  }
+  releaseAllFrames();
+  failPendingReadbacks();
+  const auto stats = frameStats();
+  LOGI("Renderer destroyed: received=%llu, dropped=%llu, consumed=%llu",
+       static_cast<unsigned long long>(stats.received),
+       static_cast<unsigned long long>(stats.dropped),
+       static_cast<unsigned long long>(stats.consumed));
 }
 
 void BaseRenderer::setWindow(ANativeWindow *window) {
@@ -16,9 +49,11 @@ void BaseRenderer::setWindow(ANativeWindow *window) {
   // schedule an event to the render thread
   renderThread->scheduleTask([this] {
     const auto resultOk = onWindowCreated();
+    backendCreated = resultOk;
     if (resultOk) {
       aChoreographer = AChoreographer_getInstance();
-      postChoreographerCallback();
+      vsyncRequested = false;
+      requestVsync();
     }
     initCondition.notify_one();
   });
@@ -42,6 +77,7 @@ void BaseRenderer::updateWindowSize(int width, int height) {
     }
     // update MVP in any case to cover the use-case of brining app to background and back
     updateMvp();
+    renderOnNextVsync();
   });
 }
 
@@ -49,6 +85,10 @@ void BaseRenderer::resetWindow() {
   std::unique_lock <std::mutex> lock(mutex);
   renderThread->scheduleTask([this] {
     onWindowDestroyed();
+    backendCreated = false;
+    // textures are gone together with the window
+    releaseAllFrames();
+    failPendingReadbacks();
     aNativeWindow = nullptr;
     destroyCondition.notify_one();
   });
@@ -60,68 +100,426 @@ void BaseRenderer::resetWindow() {
   LOGI("Android surface destroyed, resuming main thread!");
 }
 
+bool BaseRenderer::startHeadless(int width, int height) {
+  std::unique_lock <std::mutex> lock(mutex);
+  bool resultOk = false;
+  bool done = false;
+  renderThread->scheduleTask([this, width, height, &resultOk, &done] {
+    headless = true;
+    viewportWidth = width;
+    viewportHeight = height;
+    resultOk = onWindowCreated();
+    backendCreated = resultOk;
+    if (resultOk) {
+      updateMvp();
+    } else {
+      headless = false;
+    }
+    {
+      std::lock_guard <std::mutex> doneLock(mutex);
+      done = true;
+    }
+    initCondition.notify_one();
+  });
+  initCondition.wait(lock, [&done] { return done; });
+  LOGI("%s headless rendering %s, %dx%d", renderingModeName(), resultOk ? "started" : "failed",
+       width, height);
+  return resultOk;
+}
+
+void BaseRenderer::stopHeadless() {
+  std::unique_lock <std::mutex> lock(mutex);
+  bool done = false;
+  renderThread->scheduleTask([this, &done] {
+    if (headless) {
+      onWindowDestroyed();
+      backendCreated = false;
+      releaseAllFrames();
+      failPendingReadbacks();
+      headless = false;
+    }
+    {
+      std::lock_guard <std::mutex> doneLock(mutex);
+      done = true;
+    }
+    destroyCondition.notify_one();
+  });
+  destroyCondition.wait(lock, [&done] { return done; });
+  LOGI("%s headless rendering stopped", renderingModeName());
+}
+
+void BaseRenderer::stopRendering() {
+  if (!renderThread) {
+    return;
+  }
+  {
+    std::unique_lock <std::mutex> lock(mutex);
+    bool done = false;
+    renderThread->scheduleTask([this, &done] {
+      if (backendCreated) {
+        onWindowDestroyed();
+        backendCreated = false;
+      }
+      releaseAllFrames();
+      failPendingReadbacks();
+      headless = false;
+      {
+        std::lock_guard <std::mutex> doneLock(mutex);
+        done = true;
+      }
+      destroyCondition.notify_one();
+    });
+    destroyCondition.wait(lock, [&done] { return done; });
+  }
+  // no choreographer callback, timer or task may reach the backend once it is being destroyed
+  renderThread.reset();
+}
+
+void BaseRenderer::setCacheDirectory(std::string directory) {
+  renderThread->scheduleTask([this, directory = std::move(directory)] {
+    cacheDirectory = directory;
+  });
+}
+
+void BaseRenderer::setRenderPolicy(RenderPolicy policy) {
+  renderThread->scheduleTask([this, policy] {
+    if (policy == renderPolicy) {
+      return;
+    }
+    const auto latency = latencyTracker.snapshot()[LatencyTracker::SensorToPresent];
+    LOGI("%s renderer, %s policy: sensor->present p50=%lld us, p95=%lld us over %u frames, "
+         "switching to %s", renderingModeName(), renderPolicyName(renderPolicy),
+         static_cast<long long>(latency.p50 / 1000), static_cast<long long>(latency.p95 / 1000),
+         latency.samples, renderPolicyName(policy));
+    renderPolicy = policy;
+    frameScheduler.reset();
+    latencyTracker.clear();
+    if (latchTimer) {
+      latchTimer->cancel();
+    }
+    if (mailbox.pending()) {
+      // late latch left it for the next vsync, camera thread will not wake us up for it again
+      onFrameArrived();
+    }
+  });
+}
+
+void BaseRenderer::capture(CaptureSource source, CaptureMethod method, CaptureCallback callback) {
+  CaptureRequest request{
+          .source = source,
+          .method = method,
+          .callback = std::move(callback),
+          .requestedNanos = latencyClockNanos(),
+  };
+  renderThread->scheduleTask([this, request = std::move(request)]() mutable {
+    const auto start = latencyClockNanos();
+    if (request.source == CaptureSource::CameraFrame) {
+      if (request.method != CaptureMethod::HardwareBufferLock || !currentBuffer) {
+        LOGW("%s renderer could not capture camera frame via %s", renderingModeName(),
+             captureMethodName(request.method));
+        frameCapture.complete(std::move(request), false, {});
+        return;
+      }
+      // staging slot must not be reused for a newer frame until the copy is done
+      auto guard = std::make_shared<ReleaseGuard>();
+      guard->release = std::move(currentFrameRelease);
+      currentFrameRelease = [guard] {};
+      AHardwareBuffer_acquire(currentBuffer);
+      request.renderThreadNanos += latencyClockNanos() - start;
+      frameCapture.lockAndCopy(std::move(request), currentBuffer, std::move(guard));
+      return;
+    }
+    if (!supportsReadback(request.method) || !couldRender()) {
+      LOGW("%s renderer could not capture rendered output via %s", renderingModeName(),
+           captureMethodName(request.method));
+      frameCapture.complete(std::move(request), false, {});
+      return;
+    }
+    request.renderThreadNanos += latencyClockNanos() - start;
+    pendingReadbacks.push_back(std::move(request));
+    // drawn again even if camera does not deliver a new frame
+    if (headless) {
+      drawCurrentFrame();
+    } else {
+      renderOnNextVsync();
+    }
+  });
+}
+
+FrameCapture::MethodStats BaseRenderer::captureStats(CaptureMethod method) const {
+  return frameCapture.stats(method);
+}
+
+void BaseRenderer::onFrameDrawn() {
+  while (!pendingReadbacks.empty() && startReadback(pendingReadbacks.front())) {
+    pendingReadbacks.pop_front();
+    readbacksInFlight = true;
+  }
+}
+
+void BaseRenderer::finishReadback(CaptureRequest request, bool ok, CapturedImage image) {
+  frameCapture.complete(std::move(request), ok, std::move(image));
+}
+
+void BaseRenderer::scheduleReadbacks() {
+  if (pendingReadbacks.empty() && !readbacksInFlight) {
+    return;
+  }
+  if (!headless) {
+    if (!pendingReadbacks.empty()) {
+      renderOnNextVsync();
+    } else {
+      requestVsync();
+    }
+    return;
+  }
+  // no vsync to poll on, looked at again shortly without holding up the render thread meanwhile
+  if (!readbackTimer) {
+    readbackTimer = std::make_unique<LooperTimer>(ALooper_forThread(), [this] {
+      if (!pendingReadbacks.empty()) {
+        drawCurrentFrame();
+      } else {
+        readbacksInFlight = pollReadbacks();
+        scheduleReadbacks();
+      }
+    });
+  }
+  if (!readbackTimer->armed()) {
+    readbackTimer->armAt(FrameScheduler::nowNanos() + kReadbackPollNanos);
+  }
+}
+
+void BaseRenderer::failPendingReadbacks() {
+  for (auto &request: pendingReadbacks) {
+    frameCapture.complete(std::move(request), false, {});
+  }
+  pendingReadbacks.clear();
+  readbacksInFlight = false;
+}
+
 void BaseRenderer::updateMvp() {
-  float viewportRatio =
-          static_cast<float>(viewportWidth) / static_cast<float>(viewportHeight);
-  float ratio = viewportRatio * bufferImageRatio;
-  float fov = 45.f;
-  auto proj = glm::perspective(glm::radians(fov), ratio, 0.1f, 100.0f);
-  if (strcmp(this->renderingModeName(), "Vulkan") == 0) {
-    // GLM was originally designed for OpenGL, where the Y coordinate of the clip coordinates is inverted.
-    // The easiest way to compensate for that is to flip the sign on the scaling factor of the Y axis in the projection matrix.
-    // If you don't do this, then the image will be rendered upside down.
-    proj[1][1] *= -1.f;
-  }
-  if (backCamera) {
-    proj[0][0] *= -1.f;
-  }
-  auto view = glm::lookAt(
-          // TODO make z = f(pov) and not hardcoded 3.f
-          glm::vec3(0.f, 0.f, 3.f),
-          glm::vec3(0.f, 0.f, 0.f),
-          // in majority of examples Y is expected to be 1.f but the actual image from camera is then flipped
-          // so using Y = -1.f
-          glm::vec3(0.f, -1.f, 0.f)
-  );
-  auto model = glm::rotate(
-          glm::mat4(1.0f),
-          glm::radians(static_cast<float>(rotationDegrees)),
-          glm::vec3(0.0f, 0.0f, 1.0f)
-          );
-  mvp = proj * view * model;
+  mvp = cameraMvp({
+          .viewportRatio = static_cast<float>(viewportWidth) / static_cast<float>(viewportHeight),
+          .bufferImageRatio = bufferImageRatio,
+          .rotationDegrees = rotationDegrees,
+          .backCamera = backCamera,
+          .flipClipY = strcmp(this->renderingModeName(), "Vulkan") == 0,
+  });
   onMvpUpdated();
 }
 
-void BaseRenderer::processCameraFrame(AHardwareBuffer *aHardwareBuffer, int rotationDegrees_,
-                                      bool backCamera_) {
-  AHardwareBuffer_acquire(aHardwareBuffer);
-  LOGI("Buffer %p acquired by %s renderer" , aHardwareBuffer, this->renderingModeName());
-  renderThread->scheduleTask([aHardwareBuffer, rotationDegrees_, backCamera_, this] {
-    AHardwareBuffer_Desc description;
-    AHardwareBuffer_describe(aHardwareBuffer, &description);
-    const auto bufferImageRatio_ =
-            static_cast<float>(description.width) / static_cast<float>(description.height);
-    if (bufferImageRatio_ != bufferImageRatio) {
-      bufferImageRatio = bufferImageRatio_;
-      updateMvp();
-    }
-    if (rotationDegrees_ != rotationDegrees) {
-      rotationDegrees = rotationDegrees_;
-      updateMvp();
+void BaseRenderer::processCameraFrame(CameraFrame frame) {
+  AHardwareBuffer_acquire(frame.buffer);
+  BLOG("Buffer %p acquired by %s renderer", frame.buffer, this->renderingModeName());
+  if (auto replaced = mailbox.post(std::move(frame))) {
+    // render thread did not get to the previous frame yet, its task will pick up this one instead
+    AHardwareBuffer_release(replaced->buffer);
+    if (replaced->onRelease) {
+      replaced->onRelease();
     }
-    if (backCamera_ != backCamera) {
-      backCamera = backCamera_;
-      updateMvp();
+    BLOG("Buffer %p replaced before %s renderer got to it", replaced->buffer, this->renderingModeName());
+    return;
+  }
+  renderThread->scheduleTask([this] {
+    onFrameArrived();
+  });
+}
+
+void BaseRenderer::onFrameArrived() {
+  if (renderPolicy != RenderPolicy::LateLatch || headless || !frameScheduler.hasVsync()) {
+    consumePendingFrame();
+    return;
+  }
+  if (!latchTimer) {
+    latchTimer = std::make_unique<LooperTimer>(ALooper_forThread(), [this] {
+      latchPendingFrame();
+    });
+  }
+  // newer frames arriving meanwhile replace this one in the mailbox, render thread keeps running
+  // tasks and vsync callbacks until the deadline
+  if (!latchTimer->armed()) {
+    latchTimer->armAt(frameScheduler.latchDeadline(FrameScheduler::nowNanos()));
+  }
+}
+
+void BaseRenderer::latchPendingFrame() {
+  const auto latchedNanos = FrameScheduler::nowNanos();
+  consumePendingFrame();
+  if (drawPending) {
+    drawCurrentFrame();
+    frameScheduler.recordRenderCost(FrameScheduler::nowNanos() - latchedNanos);
+  }
+}
+
+void BaseRenderer::requestVsync() {
+  if (vsyncRequested || !aChoreographer || headless) {
+    return;
+  }
+  vsyncRequested = true;
+  postChoreographerCallback();
+}
+
+void BaseRenderer::renderOnNextVsync() {
+  drawPending = true;
+  requestVsync();
+}
+
+void BaseRenderer::onVsync(int64_t frameTimeNanos) {
+  vsyncRequested = false;
+  frameScheduler.onVsync(frameTimeNanos);
+  if (drawPending) {
+    drawCurrentFrame();
+    return;
+  }
+  readbacksInFlight = pollReadbacks();
+  scheduleReadbacks();
+}
+
+void BaseRenderer::drawCurrentFrame() {
+  drawPending = false;
+  readbacksInFlight = pollReadbacks();
+  if (couldRender()) {
+    render();
+  }
+  scheduleReadbacks();
+}
+
+void BaseRenderer::consumePendingFrame() {
+  const auto frame = mailbox.take();
+  if (!frame) {
+    return;
+  }
+  auto aHardwareBuffer = frame->buffer;
+  if (frame->onConsume && !frame->onConsume()) {
+    // staging slot got reused for a newer frame, that one is already on its way
+    AHardwareBuffer_release(aHardwareBuffer);
+    if (frame->onRelease) {
+      frame->onRelease();
     }
-    bufferMutex.lock();
+    ++staleFrames;
+    BLOG("Buffer %p is stale, skipped by %s renderer", aHardwareBuffer, this->renderingModeName());
+    return;
+  }
+  AHardwareBuffer_Desc description;
+  AHardwareBuffer_describe(aHardwareBuffer, &description);
+  const auto bufferImageRatio_ =
+          static_cast<float>(description.width) / static_cast<float>(description.height);
+  if (bufferImageRatio_ != bufferImageRatio) {
+    bufferImageRatio = bufferImageRatio_;
+    updateMvp();
+  }
+  if (frame->rotationDegrees != rotationDegrees) {
+    rotationDegrees = frame->rotationDegrees;
+    updateMvp();
+  }
+  if (frame->backCamera != backCamera) {
+    backCamera = frame->backCamera;
+    updateMvp();
+  }
+  bufferMutex.lock();
+  {
+    TRACE_SCOPE("import");
     // transform HW buffer to Vulkan / OpenGL image / external texture.
     hwBufferToTexture(aHardwareBuffer);
-    AHardwareBuffer_release(aHardwareBuffer);
-    LOGI("Buffer %p released by %s renderer" , aHardwareBuffer, this->renderingModeName());
-    bufferMutex.unlock();
-    // post choreographer callback as we will need to render this texture
-    postChoreographerCallback();
+  }
+  currentTimestamps = frame->timestamps;
+  currentTimestamps.imported = latencyClockNanos();
+  latencyPending = true;
+  bufferMutex.unlock();
+  ++consumedFrames;
+  // previous frame is not bound anymore
+  releaseCurrentFrame();
+  // reference taken in processCameraFrame is kept while the frame is bound
+  currentBuffer = aHardwareBuffer;
+  currentFrameRelease = frame->onRelease;
+  drawPending = true;
+  if (headless || renderPolicy == RenderPolicy::Immediate) {
+    // nothing to pace against, frame is drawn as soon as it is imported
+    drawCurrentFrame();
+  } else {
+    // vsync aligned draws in the choreographer callback, late latch right after the import and
+    // only keeps the vsync phase up to date through it
+    requestVsync();
+  }
+}
+
+BaseRenderer::FrameStats BaseRenderer::frameStats() const {
+  const auto mailboxStats = mailbox.stats();
+  return FrameStats{
+          .received = mailboxStats.posted,
+          .dropped = mailboxStats.replaced + staleFrames.load(),
+          .consumed = consumedFrames.load(),
+  };
+}
+
+LatencyTracker::Snapshot BaseRenderer::latencyStats() const {
+  return latencyTracker.snapshot();
+}
+
+void BaseRenderer::onFrameSubmitted() {
+  if (latencyPending && currentTimestamps.submitted == 0) {
+    currentTimestamps.submitted = latencyClockNanos();
+  }
+}
+
+void BaseRenderer::onFramePresented() {
+  if (!latencyPending || currentTimestamps.submitted == 0) {
+    return;
+  }
+  currentTimestamps.presented = latencyClockNanos();
+  latencyTracker.record(currentTimestamps);
+  latencyPending = false;
+}
+
+void BaseRenderer::releaseCurrentFrame() {
+  if (!currentBuffer && !currentFrameRelease) {
+    return;
+  }
+  // draws still queued on the GPU may sample the buffer, its staging slot must not be written yet
+  retiredFrames.push_back(RetiredFrame{
+          .drawSerial = submittedDrawSerial(),
+          .release = [this, buffer = currentBuffer, release = std::move(currentFrameRelease)] {
+            if (buffer) {
+              AHardwareBuffer_release(buffer);
+              BLOG("Buffer %p released", buffer);
+            }
+            if (release) {
+              release();
+            }
+          },
   });
+  currentBuffer = nullptr;
+  currentFrameRelease = nullptr;
+  releaseRetiredFrames();
+}
+
+void BaseRenderer::releaseRetiredFrames() {
+  if (retiredFrames.empty()) {
+    return;
+  }
+  const auto completed = completedDrawSerial();
+  while (!retiredFrames.empty() && retiredFrames.front().drawSerial <= completed) {
+    auto release = std::move(retiredFrames.front().release);
+    retiredFrames.pop_front();
+    release();
+  }
+}
+
+void BaseRenderer::releaseAllFrames() {
+  while (!retiredFrames.empty()) {
+    auto release = std::move(retiredFrames.front().release);
+    retiredFrames.pop_front();
+    release();
+  }
+  if (currentBuffer) {
+    AHardwareBuffer_release(currentBuffer);
+    BLOG("Buffer %p released", currentBuffer);
+    currentBuffer = nullptr;
+  }
+  if (currentFrameRelease) {
+    currentFrameRelease();
+    currentFrameRelease = nullptr;
+  }
 }
 
 } // namespace android
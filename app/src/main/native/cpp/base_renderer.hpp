@@ -3,25 +3,41 @@
 #include <android/choreographer.h>
 #include <android/hardware_buffer.h>
 #include <android/native_window.h>
-#include <android/native_window_jni.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "glm/gtx/string_cast.hpp"
 
+#include "binary_log.hpp"
+#include "camera_frame.hpp"
+#include "frame_capture.hpp"
+#include "frame_consumer.hpp"
+#include "frame_mailbox.hpp"
+#include "frame_scheduler.hpp"
 #include "looper_thread.hpp"
+#include "looper_timer.hpp"
+#include "mvp.hpp"
+#include "trace.hpp"
 #include "util.hpp"
 
+// STL
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+
 namespace engine {
 namespace android {
 
-class BaseRenderer {
+class BaseRenderer : public FrameConsumer {
 
 public:
     BaseRenderer();
 
-    ~BaseRenderer();
+    ~BaseRenderer() override;
 
     void setWindow(ANativeWindow *window);
 
@@ -29,11 +45,66 @@ public:
 
     void resetWindow();
 
+    /**
+     * Renders offscreen into a width x height target instead of a window, e.g. for throughput
+     * measurements or processing of recorded frames. Every consumed camera frame is drawn right away
+     * without waiting for vsync. Blocks until the backend is ready, returns false if it could not be
+     * initialized. Must not be combined with a window, target size is fixed until stopHeadless().
+     * The Linux host build only has the OpenGL ES renderer, it runs there on Mesa llvmpipe.
+     */
+    bool startHeadless(int width, int height);
+
+    void stopHeadless();
+
+    /**
+     * Directory renderer persists its shader / pipeline caches to, applied on next window.
+     * Caches are kept in memory only until it is set.
+     */
+    void setCacheDirectory(std::string directory);
+
+    /**
+     * Could be called from any thread. Latency stats are reset on change so they only cover
+     * frames paced by the new policy, the old policy's numbers are logged. Headless rendering
+     * always draws right away.
+     */
+    void setRenderPolicy(RenderPolicy policy);
+
+    /**
+     * Could be called from any thread, neither render nor camera thread ever waits for the GPU or
+     * a CPU copy because of it. Camera frames are captured with CaptureMethod::HardwareBufferLock,
+     * rendered output with the readback method of the backend, other combinations fail.
+     * Callback is called on the capture thread, also on failure.
+     */
+    void capture(CaptureSource source, CaptureMethod method, CaptureCallback callback);
+
+    /**
+     * Could be called from any thread.
+     */
+    FrameCapture::MethodStats captureStats(CaptureMethod method) const;
+
     /**
      * Always called from camera worker thread - feed new camera buffer.
-     * @param aHardwareBuffer
+     * Frame replaces the one still waiting for render thread, if any.
+     * @param frame
+     */
+    void processCameraFrame(CameraFrame frame) override;
+
+    struct FrameStats {
+        uint64_t received = 0;
+        // replaced by a newer frame or stale by the time render thread got to them
+        uint64_t dropped = 0;
+        uint64_t consumed = 0;
+    };
+
+    /**
+     * Could be called from any thread.
      */
-    void processCameraFrame(AHardwareBuffer *aHardwareBuffer, int rotationDegrees_, bool backCamera_);
+    FrameStats frameStats() const;
+
+    /**
+     * Could be called from any thread, percentiles over the last presented frames.
+     */
+    LatencyTracker::Snapshot latencyStats() const;
 
 protected:
     virtual const char *renderingModeName() = 0;
@@ -56,13 +127,98 @@ protected:
     //  perhaps could be done better
     virtual void postChoreographerCallback() = 0;
 
+    /**
+     * Called by backends from their choreographer callback with its vsync timestamp,
+     * draws / latches according to the render policy.
+     */
+    void onVsync(int64_t frameTimeNanos);
+
+    /**
+     * Current frame could not be drawn right now, e.g. no swapchain image was available.
+     */
+    void renderOnNextVsync();
+
+    /**
+     * Must be called first thing by the destructor of every backend: destroys its GPU objects
+     * on render thread via onWindowDestroyed() while it is still alive, hands back camera frames,
+     * fails pending readbacks and stops the render thread.
+     */
+    void stopRendering();
+
+    /**
+     * Readback of the rendered output the backend implements.
+     */
+    virtual bool supportsReadback(CaptureMethod) const { return false; }
+
+    /**
+     * Called from render thread right after a draw was submitted and before it is presented.
+     * Backend records the readback and takes the request over, false if it could not right now,
+     * e.g. every readback slot is in flight, request is then retried with the next draw.
+     */
+    virtual bool startReadback(CaptureRequest &) { return false; }
+
+    /**
+     * Called from render thread, hands readbacks the GPU is done with to finishReadback() without
+     * waiting for the others. Returns true while any is still in flight. Backends complete all of
+     * them once the GPU is idle when their surface goes away.
+     */
+    virtual bool pollReadbacks() { return false; }
+
+    /**
+     * Called by backends from render thread after submitting a draw, pending readbacks start here.
+     */
+    void onFrameDrawn();
+
+    void finishReadback(CaptureRequest request, bool ok, CapturedImage image);
+
+    /**
+     * Called by backends from render thread once the draw sampling the current camera frame was
+     * submitted / presented, only the first draw of every frame is traced.
+     */
+    void onFrameSubmitted();
+
+    void onFramePresented();
+
+    /**
+     * Serials of the last draw submitted to the GPU and of the last one it finished, both only grow.
+     * A replaced camera frame is handed back (its staging slot reused) once every draw submitted
+     * while it was bound finished. Backends without GPU tracking hand frames back right away.
+     * Called from render thread only, completedDrawSerial() polls without waiting.
+     */
+    virtual uint64_t submittedDrawSerial() const { return 0; }
+
+    virtual uint64_t completedDrawSerial() { return 0; }
+
+    /**
+     * Called from render thread, hands back replaced camera frames whose draws finished.
+     * Backends call it after a draw, once they know about more finished ones.
+     */
+    void releaseRetiredFrames();
+
     ANativeWindow *aNativeWindow = nullptr;
     AChoreographer *aChoreographer = nullptr;
 
+    /**
+     * Accessed from render thread only. Backends create an offscreen target of viewport size
+     * in onWindowCreated() when set, there is no window, swapchain or choreographer.
+     */
+    bool headless = false;
+
+    /**
+     * Accessed from render thread only, onWindowCreated() succeeded and onWindowDestroyed()
+     * was not called since.
+     */
+    bool backendCreated = false;
+
     int viewportWidth = -1;
     int viewportHeight = -1;
     glm::mat4 mvp;
 
+    /**
+     * Accessed from render thread only, empty if caches should not be persisted.
+     */
+    std::string cacheDirectory;
+
     /**
      * The mutex needed as worker camera thread produces buffers while render thread consumes them.
      */
@@ -75,6 +231,101 @@ private:
      */
     void updateMvp();
 
+    /**
+     * Must be called from render thread only, imports the newest frame from the mailbox.
+     */
+    void consumePendingFrame();
+
+    /**
+     * Must be called from render thread only, mailbox got a frame while it was empty.
+     */
+    void onFrameArrived();
+
+    /**
+     * Must be called from render thread only, late latch deadline passed.
+     */
+    void latchPendingFrame();
+
+    /**
+     * Must be called from render thread only, posts a choreographer callback unless one is pending.
+     */
+    void requestVsync();
+
+    void drawCurrentFrame();
+
+    /**
+     * Pending readbacks need another draw, in flight ones another poll.
+     */
+    void scheduleReadbacks();
+
+    /**
+     * Render thread only, readbacks which did not start before the surface went away.
+     */
+    void failPendingReadbacks();
+
+    /**
+     * Render thread only. At most one choreographer callback is pending and a frame is drawn once,
+     * whatever number of imports, window changes and retries asked for it in between.
+     */
+    RenderPolicy renderPolicy = RenderPolicy::VsyncAligned;
+    FrameScheduler frameScheduler;
+    bool vsyncRequested = false;
+    // imported frame not drawn yet
+    bool drawPending = false;
+    // armed while late latch waits for its deadline, created on first use
+    std::unique_ptr<LooperTimer> latchTimer;
+
+    /**
+     * Render thread only. Reference of the buffer currently bound as a texture, kept for captures.
+     */
+    AHardwareBuffer *currentBuffer = nullptr;
+    std::deque<CaptureRequest> pendingReadbacks;
+    bool readbacksInFlight = false;
+    // headless readbacks are polled with it, there is no vsync to do that on
+    std::unique_ptr<LooperTimer> readbackTimer;
+    static constexpr int64_t kReadbackPollNanos = 1'000'000;
+    FrameCapture frameCapture;
+
+    /**
+     * Must be called from render thread only, frame currently bound as a texture is not needed anymore.
+     * It is handed back once draws that sampled it finished.
+     */
+    void releaseCurrentFrame();
+
+    /**
+     * Render thread only or once it is gone. GPU is idle or its objects were destroyed, so the
+     * current and every retired frame is handed back right away.
+     */
+    void releaseAllFrames();
+
+    struct RetiredFrame {
+        // last draw which could have sampled the frame
+        uint64_t drawSerial = 0;
+        std::function<void()> release;
+    };
+    std::deque<RetiredFrame> retiredFrames;
+
+    /**
+     * Frames travel from camera thread to render thread through the mailbox, render thread task is
+     * scheduled only when the mailbox was empty so RunLoop does not pile up tasks under GPU stalls.
+     */
+    FrameMailbox mailbox;
+    std::atomic<uint64_t> staleFrames{0};
+    std::atomic<uint64_t> consumedFrames{0};
+
+    /**
+     * Release callback of the frame currently bound as a texture, accessed from render thread only.
+     */
+    std::function<void()> currentFrameRelease;
+
+    /**
+     * Timestamps of the frame currently bound as a texture until it is presented,
+     * accessed from render thread only.
+     */
+    FrameTimestamps currentTimestamps;
+    bool latencyPending = false;
+    LatencyTracker latencyTracker;
+
     float bufferImageRatio = 1.0f;
     int rotationDegrees = 0;
     bool backCamera = false;
@@ -0,0 +1,241 @@
+#include "binary_log.hpp"
+
+#include "latency_tracker.hpp"
+#include "util.hpp"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// STL
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+namespace {
+
+struct Slot {
+  // 0 while being written, position + 1 once the entry is complete
+  std::atomic<uint64_t> sequence{0};
+  BinaryLog::Entry entry;
+};
+
+/**
+ * Written only by the owning thread, read by dump().
+ */
+struct Ring {
+  std::array<Slot, BinaryLog::kRingSize> slots;
+  std::atomic<uint64_t> head{0};
+  std::atomic<bool> retired{false};
+  uint32_t threadId = 0;
+  // guarded by the registry mutex
+  uint64_t dumpedUpTo = 0;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<Ring>> rings;
+};
+
+Registry &registry() {
+  // never destroyed so threads exiting after static destruction could still log
+  static auto *instance = new Registry();
+  return *instance;
+}
+
+/**
+ * Registers the ring on first use, marks it retired on thread exit so the next dump drops it
+ * after its entries are printed.
+ */
+struct ThreadRing {
+  std::shared_ptr<Ring> ring;
+
+  ThreadRing() : ring(std::make_shared<Ring>()) {
+    ring->threadId = static_cast<uint32_t>(syscall(SYS_gettid));
+    auto &instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    instance.rings.push_back(ring);
+  }
+
+  ~ThreadRing() {
+    ring->retired.store(true, std::memory_order_release);
+  }
+};
+
+Ring &threadRing() {
+  thread_local ThreadRing threadRing;
+  return *threadRing.ring;
+}
+
+bool isLengthModifier(char c) {
+  return c == 'h' || c == 'l' || c == 'q' || c == 'j' || c == 'z' || c == 't' || c == 'L';
+}
+
+bool isConversion(char c) {
+  return strchr("diouxXeEfFgGaAcsp", c) != nullptr;
+}
+
+/**
+ * Formats a single conversion, spec holds flags, width and precision without the length
+ * modifier. Argument type recorded at the call site wins over the conversion in the format.
+ */
+int formatArg(char *buffer, size_t size, const char *spec, char conversion,
+              const BinaryLog::Arg &arg) {
+  char fmt[32];
+  switch (arg.type) {
+    case BinaryLog::ArgType::Signed:
+      if (conversion == 'c') {
+        snprintf(fmt, sizeof(fmt), "%%%sc", spec);
+        return snprintf(buffer, size, fmt, static_cast<int>(arg.i));
+      }
+      if (conversion != 'd' && conversion != 'i') {
+        conversion = strchr("ouxX", conversion) ? conversion : 'd';
+      }
+      snprintf(fmt, sizeof(fmt), "%%%sll%c", spec, conversion);
+      return snprintf(buffer, size, fmt, static_cast<long long>(arg.i));
+    case BinaryLog::ArgType::Unsigned:
+      conversion = strchr("diouxX", conversion) ? conversion : 'u';
+      snprintf(fmt, sizeof(fmt), "%%%sll%c", spec, conversion);
+      return snprintf(buffer, size, fmt, static_cast<unsigned long long>(arg.u));
+    case BinaryLog::ArgType::Double:
+      conversion = strchr("eEfFgGaA", conversion) ? conversion : 'f';
+      snprintf(fmt, sizeof(fmt), "%%%s%c", spec, conversion);
+      return snprintf(buffer, size, fmt, arg.d);
+    case BinaryLog::ArgType::Pointer:
+      snprintf(fmt, sizeof(fmt), "%%%sp", spec);
+      return snprintf(buffer, size, fmt, arg.p);
+    case BinaryLog::ArgType::String:
+      snprintf(fmt, sizeof(fmt), "%%%ss", spec);
+      return snprintf(buffer, size, fmt, arg.s ? arg.s : "(null)");
+  }
+  return 0;
+}
+
+} // namespace
+
+void BinaryLog::writeEntry(const char *format, const Arg *args, size_t argCount) {
+  auto &ring = threadRing();
+  const auto position = ring.head.load(std::memory_order_relaxed);
+  auto &slot = ring.slots[position % kRingSize];
+  // readers seeing 0 or a changed sequence afterwards drop the entry
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.entry.format = format;
+  slot.entry.timestampNanos = latencyClockNanos();
+  slot.entry.threadId = ring.threadId;
+  slot.entry.argCount = static_cast<uint32_t>(argCount);
+  std::copy(args, args + argCount, slot.entry.args);
+  slot.sequence.store(position + 1, std::memory_order_release);
+  ring.head.store(position + 1, std::memory_order_release);
+}
+
+size_t BinaryLog::dump() {
+  std::vector<Entry> entries;
+  uint64_t overwritten = 0;
+  {
+    auto &instance = registry();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    for (auto &ring : instance.rings) {
+      // read before head, entries written after that are left for the next dump
+      const auto retired = ring->retired.load(std::memory_order_acquire);
+      const auto end = ring->head.load(std::memory_order_acquire);
+      auto begin = std::max(ring->dumpedUpTo, end > kRingSize ? end - kRingSize : 0);
+      overwritten += begin - ring->dumpedUpTo;
+      for (; begin < end; ++begin) {
+        const auto &slot = ring->slots[begin % kRingSize];
+        if (slot.sequence.load(std::memory_order_acquire) != begin + 1) {
+          ++overwritten;
+          continue;
+        }
+        Entry entry = slot.entry;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != begin + 1) {
+          // owner wrapped around while we were copying
+          ++overwritten;
+          continue;
+        }
+        entries.push_back(entry);
+      }
+      ring->dumpedUpTo = end;
+      if (retired) {
+        ring.reset();
+      }
+    }
+    instance.rings.erase(
+            std::remove(instance.rings.begin(), instance.rings.end(), nullptr),
+            instance.rings.end());
+  }
+  std::stable_sort(entries.begin(), entries.end(), [](const Entry &lhs, const Entry &rhs) {
+    return lhs.timestampNanos < rhs.timestampNanos;
+  });
+  char message[512];
+  for (const auto &entry : entries) {
+    format(entry, message, sizeof(message));
+    // explicitly requested, so not subject to the compile-time level
+    __android_log_print(ANDROID_LOG_INFO, "DzCoreNative", "[%lld.%06lld %u] %s",
+                        static_cast<long long>(entry.timestampNanos / 1000000000),
+                        static_cast<long long>(entry.timestampNanos % 1000000000 / 1000),
+                        entry.threadId,
+                        message);
+  }
+  if (overwritten > 0) {
+    LOGW("Binary log: %llu entries were overwritten before dump",
+         static_cast<unsigned long long>(overwritten));
+  }
+  return entries.size();
+}
+
+int BinaryLog::format(const Entry &entry, char *buffer, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  size_t length = 0;
+  const auto append = [&](int written) {
+    if (written > 0) {
+      length = std::min(length + static_cast<size_t>(written), size - 1);
+    }
+  };
+  uint32_t argIndex = 0;
+  for (const char *p = entry.format; *p != '\0' && length < size - 1;) {
+    if (*p != '%') {
+      buffer[length++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      buffer[length++] = '%';
+      p += 2;
+      continue;
+    }
+    // %[flags][width][.precision][length]conversion, '*' is not supported
+    char spec[16];
+    size_t specLength = 0;
+    const char *q = p + 1;
+    for (; *q != '\0' && !isConversion(*q); ++q) {
+      if (!isLengthModifier(*q) && specLength < sizeof(spec) - 1) {
+        spec[specLength++] = *q;
+      }
+    }
+    spec[specLength] = '\0';
+    if (*q == '\0') {
+      break;
+    }
+    if (argIndex < entry.argCount) {
+      append(formatArg(buffer + length, size - length, spec, *q, entry.args[argIndex++]));
+    } else {
+      append(snprintf(buffer + length, size - length, "<missing>"));
+    }
+    p = q + 1;
+  }
+  buffer[length] = '\0';
+  return static_cast<int>(length);
+}
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,106 @@
+#pragma once
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace engine {
+namespace android {
+
+/**
+ * Binary logger for hot paths. Every thread writes into its own ring of fixed size records
+ * holding only the format pointer, a timestamp and raw argument values, so logging is wait-free
+ * and costs nanoseconds. Formatting happens lazily in dump(), oldest records are overwritten
+ * once a ring is full.
+ *
+ * Format must be a string literal and %s arguments must have static lifetime (literals,
+ * renderingModeName() etc.) as both are only dereferenced when dumped.
+ */
+class BinaryLog {
+public:
+  static constexpr size_t kMaxArgs = 6;
+  static constexpr size_t kRingSize = 1024;
+
+  enum class ArgType : uint8_t {
+    Signed,
+    Unsigned,
+    Double,
+    Pointer,
+    String,
+  };
+
+  struct Arg {
+    ArgType type = ArgType::Unsigned;
+    union {
+      int64_t i;
+      uint64_t u = 0;
+      double d;
+      const void *p;
+      const char *s;
+    };
+  };
+
+  struct Entry {
+    const char *format = nullptr;
+    int64_t timestampNanos = 0;
+    uint32_t threadId = 0;
+    uint32_t argCount = 0;
+    Arg args[kMaxArgs];
+  };
+
+  template<typename... Args>
+  static void write(const char *format, Args... args) {
+    static_assert(sizeof...(Args) <= kMaxArgs, "too many binary log arguments");
+    // extra element keeps the array valid when there are no arguments
+    const Arg packed[sizeof...(Args) + 1] = {makeArg(args)...};
+    writeEntry(format, packed, sizeof...(Args));
+  }
+
+  /**
+   * Formats entries of all threads logged since the previous dump into logcat, in time order.
+   * Could be called from any thread, other threads keep logging meanwhile.
+   * Returns amount of dumped entries.
+   */
+  static size_t dump();
+
+  /**
+   * Formats a single entry into buffer, returns the length as snprintf does.
+   */
+  static int format(const Entry &entry, char *buffer, size_t size);
+
+private:
+  template<typename T>
+  static Arg makeArg(T value) {
+    Arg arg;
+    if constexpr (std::is_same_v<T, const char *> || std::is_same_v<T, char *>) {
+      arg.type = ArgType::String;
+      arg.s = value;
+    } else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>) {
+      arg.type = ArgType::Pointer;
+      arg.p = value;
+    } else if constexpr (std::is_floating_point_v<T>) {
+      arg.type = ArgType::Double;
+      arg.d = value;
+    } else if constexpr (std::is_enum_v<T>) {
+      arg.type = ArgType::Signed;
+      arg.i = static_cast<int64_t>(value);
+    } else if constexpr (std::is_signed_v<T>) {
+      arg.type = ArgType::Signed;
+      arg.i = value;
+    } else {
+      static_assert(std::is_integral_v<T>, "unsupported binary log argument type");
+      arg.type = ArgType::Unsigned;
+      arg.u = value;
+    }
+    return arg;
+  }
+
+  static void writeEntry(const char *format, const Arg *args, size_t argCount);
+};
+
+} // namespace android
+} // namespace engine
+
+// Hot path replacement for LOGI, see BinaryLog for the argument requirements.
+#define BLOG(...) ::engine::android::BinaryLog::write(__VA_ARGS__)
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <android/hardware_buffer.h>
+#include <dlfcn.h>
+
+// STL
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace engine {
+namespace android {
+
+/**
+ * Stable identity of a hardware buffer: AHardwareBuffer_getId when the platform has it (API 31+),
+ * buffer address otherwise. Address is only unique while the buffer is alive, BufferImportCache
+ * keeps a reference to every cached buffer so it could not be recycled under the same key.
+ */
+inline uint64_t hardwareBufferKey(const AHardwareBuffer *buffer) {
+  using GetIdFunc = int (*)(const AHardwareBuffer *, uint64_t *);
+  // resolved at runtime as minimum SDK is lower than the one introducing it
+  static const auto getId = reinterpret_cast<GetIdFunc>(dlsym(RTLD_DEFAULT, "AHardwareBuffer_getId"));
+  uint64_t id;
+  if (getId && getId(buffer, &id) == 0) {
+    return id;
+  }
+  return reinterpret_cast<uintptr_t>(buffer);
+}
+
+/**
+ * LRU cache of per buffer GPU objects (imported images, EGLImages...) for camera producers
+ * cycling through a small fixed set of hardware buffers, so every buffer is imported once.
+ *
+ * Objects evicted or retired could still be referenced by work in flight: they are destroyed by
+ * collect() once the GPU has finished the submission they were last used in. Serials are
+ * supplied by the owner, e.g. incremented per queue submit.
+ *
+ * Must be used from render thread only.
+ */
+template<typename Value>
+class BufferImportCache {
+public:
+  static constexpr size_t kDefaultCapacity = 8;
+
+  struct Entry {
+    AHardwareBuffer *buffer = nullptr;
+    uint64_t key = 0;
+    // unique per inserted entry, unlike keys and addresses never reused
+    uint64_t generation = 0;
+    uint64_t lastUsedSerial = 0;
+    Value value{};
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  explicit BufferImportCache(size_t capacity = kDefaultCapacity) : capacity(capacity) {
+    assert(capacity > 0);
+  }
+
+  BufferImportCache(BufferImportCache const &) = delete;
+
+  ~BufferImportCache() {
+    // owner must destroy GPU objects, see clear()
+    assert(entries.empty() && retired.empty());
+  }
+
+  /**
+   * Returns the entry imported for this buffer before and marks it most recently used,
+   * nullptr on a miss.
+   */
+  Entry *find(const AHardwareBuffer *buffer) {
+    const auto found = index.find(hardwareBufferKey(buffer));
+    if (found == index.end()) {
+      ++counters.misses;
+      return nullptr;
+    }
+    ++counters.hits;
+    entries.splice(entries.begin(), entries, found->second);
+    return &entries.front();
+  }
+
+  /**
+   * Caches objects just imported for the buffer, the least recently used entry is retired when full.
+   * Cache keeps a reference to the buffer until the entry is destroyed.
+   */
+  Entry &insert(AHardwareBuffer *buffer, Value value) {
+    const auto key = hardwareBufferKey(buffer);
+    assert(index.find(key) == index.end());
+    if (entries.size() >= capacity) {
+      ++counters.evictions;
+      retire(std::prev(entries.end()));
+    }
+    AHardwareBuffer_acquire(buffer);
+    entries.push_front(Entry{
+            .buffer = buffer,
+            .key = key,
+            .generation = ++generationCounter,
+            .lastUsedSerial = 0,
+            .value = std::move(value),
+    });
+    index[key] = entries.begin();
+    return entries.front();
+  }
+
+  /**
+   * Retires every entry, e.g. when objects depend on state that changed (sampler conversion).
+   */
+  void retireAll() {
+    while (!entries.empty()) {
+      retire(entries.begin());
+    }
+  }
+
+  /**
+   * Destroys retired entries whose last submission has completed.
+   */
+  template<typename Destroy>
+  void collect(uint64_t completedSerial, Destroy &&destroy) {
+    for (auto it = retired.begin(); it != retired.end();) {
+      if (it->lastUsedSerial <= completedSerial) {
+        destroy(it->value);
+        AHardwareBuffer_release(it->buffer);
+        it = retired.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  /**
+   * Destroys everything right away, caller guarantees the GPU is idle.
+   */
+  template<typename Destroy>
+  void clear(Destroy &&destroy) {
+    retireAll();
+    collect(UINT64_MAX, std::forward<Destroy>(destroy));
+  }
+
+  size_t size() const { return entries.size(); }
+
+  size_t retiredSize() const { return retired.size(); }
+
+  Stats stats() const { return counters; }
+
+private:
+  using EntryList = std::list<Entry>;
+
+  void retire(typename EntryList::iterator entry) {
+    index.erase(entry->key);
+    retired.splice(retired.end(), entries, entry);
+  }
+
+  const size_t capacity;
+  // most recently used first
+  EntryList entries;
+  EntryList retired;
+  std::unordered_map<uint64_t, typename EntryList::iterator> index;
+  uint64_t generationCounter = 0;
+  Stats counters;
+};
+
+} // namespace android
+} // namespace engine
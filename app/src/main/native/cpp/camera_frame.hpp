@@ -0,0 +1,36 @@
+#pragma once
+
+#include <android/hardware_buffer.h>
+
+#include "latency_tracker.hpp"
+
+// STL
+#include <functional>
+
+namespace engine {
+namespace android {
+
+/**
+ * Camera frame travelling from camera worker thread to render thread.
+ */
+struct CameraFrame {
+  AHardwareBuffer *buffer = nullptr;
+  int rotationDegrees = 0;
+  bool backCamera = false;
+  FrameTimestamps timestamps;
+
+  /**
+   * Called on render thread right before the buffer is imported.
+   * Returning false means the frame became stale (e.g. its staging slot was reused) and is skipped.
+   */
+  std::function<bool()> onConsume;
+
+  /**
+   * Called once renderer does not reference the buffer anymore, whether the frame was displayed,
+   * replaced by a newer one or skipped as stale. Render thread unless the frame never reached it.
+   */
+  std::function<void()> onRelease;
+};
+
+} // namespace android
+} // namespace engine
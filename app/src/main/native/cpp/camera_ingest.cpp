@@ -0,0 +1,177 @@
+#include "camera_ingest.hpp"
+
+#include "pixel_copy.hpp"
+#include "trace.hpp"
+#include "util.hpp"
+
+#include <dlfcn.h>
+
+namespace engine {
+namespace android {
+
+namespace {
+
+using LockPlanesFunction = int (*)(AHardwareBuffer *, uint64_t, int32_t, const ARect *,
+                                   AHardwareBuffer_Planes *);
+
+/**
+ * AHardwareBuffer_lockPlanes is API 29 while we still support 28, resolve it at runtime.
+ */
+LockPlanesFunction lockPlanesFunction() {
+#if defined(__ANDROID__) && __ANDROID_API__ < 29
+  static const auto function = reinterpret_cast<LockPlanesFunction>(
+          dlsym(RTLD_DEFAULT, "AHardwareBuffer_lockPlanes"));
+  return function;
+#else
+  return &AHardwareBuffer_lockPlanes;
+#endif
+}
+
+} // namespace
+
+void CameraIngest::sendCameraFrame(FrameConsumer &consumer, AHardwareBuffer *cameraBuffer,
+                                   int rotationDegrees, bool backCamera, int64_t timestampNanos,
+                                   bool realtimeTimestamp) {
+  TRACE_SCOPE("ingest");
+  FrameTimestamps timestamps{
+          // unknown time base is CLOCK_MONOTONIC, always behind CLOCK_BOOTTIME, so it passes ordering
+          // checks and sensor spans would grow by the whole time spent in suspend
+          .sensor = realtimeTimestamp ? timestampNanos : 0,
+          .ingested = latencyClockNanos(),
+  };
+  AHardwareBuffer_Desc cameraBufferDescription;
+  AHardwareBuffer_describe(cameraBuffer, &cameraBufferDescription);
+  if (cameraBufferDescription.usage & AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE) {
+    timestamps.delivered = latencyClockNanos();
+    consumer.processCameraFrame(CameraFrame{
+            .buffer = cameraBuffer,
+            .rotationDegrees = rotationDegrees,
+            .backCamera = backCamera,
+            .timestamps = timestamps,
+            .onConsume = nullptr,
+            .onRelease = nullptr,
+    });
+  } else {
+    const auto lease = stagingRing.acquire(cameraBufferDescription.width,
+                                           cameraBufferDescription.height,
+                                           AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+    if (!lease) {
+      LOGW("No free staging slot, camera frame dropped");
+      return;
+    }
+    void* gpuData = nullptr;
+    if (AHardwareBuffer_lock(lease.buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &gpuData) != 0) {
+      LOGE("Could not lock staging buffer %p", lease.buffer);
+      stagingRing.cancel(lease);
+      return;
+    }
+    ensureCopyPool();
+    // staging buffer is always RGBA 8888, stride is in pixels
+    const bool written = cameraBufferDescription.format == AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM
+            ? copyRgbaFrame(cameraBuffer, cameraBufferDescription,
+                            static_cast<uint8_t *>(gpuData), lease.stride * 4)
+            : convertYuvFrame(cameraBuffer, cameraBufferDescription,
+                              static_cast<uint8_t *>(gpuData), lease.stride * 4);
+    AHardwareBuffer_unlock(lease.buffer, nullptr);
+    if (!written) {
+      stagingRing.cancel(lease);
+      return;
+    }
+    stagingRing.publish(lease);
+    timestamps.delivered = latencyClockNanos();
+    consumer.processCameraFrame(CameraFrame{
+            .buffer = lease.buffer,
+            .rotationDegrees = rotationDegrees,
+            .backCamera = backCamera,
+            .timestamps = timestamps,
+            .onConsume = [this, lease] { return stagingRing.consume(lease); },
+            .onRelease = [this, lease] { stagingRing.release(lease); },
+    });
+  }
+}
+
+bool CameraIngest::copyRgbaFrame(AHardwareBuffer *cameraBuffer, const AHardwareBuffer_Desc &description,
+                               uint8_t *dst, size_t dstStride) {
+  TRACE_SCOPE("copyRgba");
+  void* cpuData = nullptr;
+  if (AHardwareBuffer_lock(cameraBuffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &cpuData) != 0) {
+    LOGE("Could not lock camera buffer %p", cameraBuffer);
+    return false;
+  }
+  copyPlaneStriped(*copyPool, copyStripes,
+                   static_cast<const uint8_t *>(cpuData), description.stride * 4,
+                   dst, dstStride,
+                   description.width * 4, description.height);
+  AHardwareBuffer_unlock(cameraBuffer, nullptr);
+  return true;
+}
+
+bool CameraIngest::convertYuvFrame(AHardwareBuffer *cameraBuffer, const AHardwareBuffer_Desc &description,
+                                 uint8_t *dst, size_t dstStride) {
+  TRACE_SCOPE("convertYuv");
+  const auto lockPlanes = lockPlanesFunction();
+  if (!lockPlanes) {
+    LOGE("AHardwareBuffer_lockPlanes is not available, YUV camera frames are not supported");
+    return false;
+  }
+  AHardwareBuffer_Planes planes;
+  if (lockPlanes(cameraBuffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &planes) != 0) {
+    LOGE("Could not lock planes of camera buffer %p", cameraBuffer);
+    return false;
+  }
+  if (planes.planeCount != 3) {
+    LOGE("Unsupported camera buffer format %u with %u planes", description.format, planes.planeCount);
+    AHardwareBuffer_unlock(cameraBuffer, nullptr);
+    return false;
+  }
+  // converter takes one chroma layout for both planes and a packed luma plane
+  const auto &uPlane = planes.planes[1];
+  const auto &vPlane = planes.planes[2];
+  if (planes.planes[0].pixelStride != 1 || uPlane.rowStride != vPlane.rowStride ||
+      uPlane.pixelStride != vPlane.pixelStride) {
+    LOGE("Unsupported YUV layout: Y pixel stride %u, U %u/%u, V %u/%u (row/pixel stride)",
+         planes.planes[0].pixelStride, uPlane.rowStride, uPlane.pixelStride,
+         vPlane.rowStride, vPlane.pixelStride);
+    AHardwareBuffer_unlock(cameraBuffer, nullptr);
+    return false;
+  }
+  const YuvPlanes yuvPlanes{
+          .y = static_cast<const uint8_t *>(planes.planes[0].data),
+          .u = static_cast<const uint8_t *>(uPlane.data),
+          .v = static_cast<const uint8_t *>(vPlane.data),
+          .yRowStride = planes.planes[0].rowStride,
+          .uvRowStride = uPlane.rowStride,
+          .uvPixelStride = uPlane.pixelStride,
+  };
+  yuvToRgbaStriped(*copyPool, copyStripes, yuvPlanes, dst, dstStride,
+                   description.width, description.height,
+                   static_cast<YuvMatrix>(yuvMatrix.load()), static_cast<YuvRange>(yuvRange.load()));
+  AHardwareBuffer_unlock(cameraBuffer, nullptr);
+  return true;
+}
+
+void CameraIngest::setCopyParallelism(int threads, int stripes) {
+  requestedCopyThreads = threads;
+  requestedCopyStripes = stripes;
+}
+
+void CameraIngest::setYuvConversion(YuvMatrix matrix, YuvRange range) {
+  yuvMatrix = static_cast<int>(matrix);
+  yuvRange = static_cast<int>(range);
+}
+
+void CameraIngest::ensureCopyPool() {
+  const int threads = requestedCopyThreads;
+  const int stripes = requestedCopyStripes;
+  const size_t threadCount = threads > 0 ? threads : WorkerPool::defaultThreadCount();
+  // one stripe per thread is enough for plain copy and conversion, more stripes only help to balance big / little cores
+  const size_t stripeCount = stripes > 0 ? stripes : threadCount;
+  if (!copyPool || copyPool->threadCount() != threadCount) {
+    copyPool = std::make_unique<WorkerPool>(threadCount);
+    LOGI("Copy pool created with %zu threads", threadCount);
+  }
+  copyStripes = stripeCount;
+}
+
+} // namespace android
+} // namespace engine
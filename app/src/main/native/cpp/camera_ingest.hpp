@@ -0,0 +1,86 @@
+#pragma once
+
+#include <android/hardware_buffer.h>
+
+#include "frame_consumer.hpp"
+#include "staging_ring.hpp"
+#include "worker_pool.hpp"
+#include "yuv_convert.hpp"
+
+// STL
+#include <atomic>
+#include <memory>
+
+namespace engine {
+namespace android {
+
+/**
+ * Turns camera hardware buffers into frames renderers could sample. GPU sampled buffers are passed
+ * through as is, CPU ones (CameraX) are copied or converted from YUV into the staging ring.
+ * Does not depend on JNI so it is built and benchmarked on host as well.
+ */
+class CameraIngest {
+public:
+  CameraIngest() = default;
+
+  CameraIngest(CameraIngest const &) = delete;
+
+  /**
+   * Called from camera worker thread. Consumer must outlive frames it received as release
+   * callbacks point back into the staging ring.
+   * @param timestampNanos sensor timestamp of the frame, 0 if unknown
+   * @param realtimeTimestamp whether the timestamp is in CLOCK_BOOTTIME
+   *        (SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME), otherwise it is not comparable and dropped
+   */
+  void sendCameraFrame(FrameConsumer &consumer, AHardwareBuffer *buffer,
+                       int rotationDegrees, bool backCamera, int64_t timestampNanos = 0,
+                       bool realtimeTimestamp = false);
+
+  /**
+   * Number of threads (camera one included) and horizontal stripes used to copy CPU camera frames,
+   * values <= 0 restore defaults. Applied on the next camera frame.
+   */
+  void setCopyParallelism(int threads, int stripes);
+
+  /**
+   * Color matrix and range used to convert YUV camera frames, BT.601 full range (JFIF) by default
+   * which is what Android camera produces for YUV_420_888.
+   */
+  void setYuvConversion(YuvMatrix matrix, YuvRange range);
+
+  StagingRing::Stats stagingStats() { return stagingRing.stats(); }
+
+private:
+  /**
+   * Called from camera worker thread, (re)creates copy pool if parallelism was changed.
+   */
+  void ensureCopyPool();
+
+  /**
+   * Copy RGBA 8888 camera buffer into locked staging buffer, false if camera buffer could not be locked.
+   */
+  bool copyRgbaFrame(AHardwareBuffer *cameraBuffer, const AHardwareBuffer_Desc &description,
+                     uint8_t *dst, size_t dstStride);
+
+  /**
+   * Convert planar or semi-planar YUV 4:2:0 camera buffer into locked RGBA 8888 staging buffer,
+   * false if camera buffer could not be locked or has unexpected layout.
+   */
+  bool convertYuvFrame(AHardwareBuffer *cameraBuffer, const AHardwareBuffer_Desc &description,
+                       uint8_t *dst, size_t dstStride);
+
+  std::atomic<int> requestedCopyThreads{0};
+  std::atomic<int> requestedCopyStripes{0};
+  std::unique_ptr<WorkerPool> copyPool;
+  size_t copyStripes = 0;
+  std::atomic<int> yuvMatrix{static_cast<int>(YuvMatrix::Bt601)};
+  std::atomic<int> yuvRange{static_cast<int>(YuvRange::Full)};
+
+  /**
+   * GPU sampled copies of CameraX CPU buffers.
+   */
+  StagingRing stagingRing;
+};
+
+} // namespace android
+} // namespace engine
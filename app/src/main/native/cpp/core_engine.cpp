@@ -1,5 +1,10 @@
 #include "core_engine.hpp"
 
+#include "file_util.hpp"
+
+// STL
+#include <algorithm>
+
 namespace engine {
 namespace android {
 
@@ -19,9 +24,30 @@ CoreEngine::CoreEngine(JNIEnv &env, jni::jint renderingMode) : aNativeWindow(nul
       throw std::exception();
     }
   }
+  frameHub().attach(*renderer);
+}
+
+CoreEngine::~CoreEngine() {
+  if (renderer) {
+    frameHub().detach(*renderer);
+  }
+}
+
+CameraIngest &CoreEngine::cameraIngest() {
+  static CameraIngest ingest;
+  return ingest;
+}
+
+FrameHub &CoreEngine::frameHub() {
+  static FrameHub hub;
+  return hub;
 }
 
-CoreEngine::~CoreEngine() = default;
+FrameSource &CoreEngine::frameSource() {
+  // stopped and destroyed before the ingest and hub it feeds
+  static FrameSource source(cameraIngest(), frameHub());
+  return source;
+}
 
 /** called from Android main thread **/
 void CoreEngine::nativeSetSurface(JNIEnv &env, const jni::Object<Surface> &surface,
@@ -44,39 +70,157 @@ void CoreEngine::nativeSetSurface(JNIEnv &env, const jni::Object<Surface> &surfa
 }
 
 /** called from worker thread **/
-void CoreEngine::nativeSendCameraFrame(JNIEnv &env, const jni::Object<HardwareBuffer> &buffer,
-                                       jni::jint rotationDegrees, jni::jboolean backCamera) {
+void CoreEngine::nativeSendCameraFrame(JNIEnv &env, const jni::Class<CoreEngine> &,
+                                       const jni::Object<HardwareBuffer> &buffer,
+                                       jni::jint rotationDegrees, jni::jboolean backCamera,
+                                       jni::jlong timestampNanos, jni::jboolean realtimeTimestamp) {
   auto cameraBuffer = AHardwareBuffer_fromHardwareBuffer(&env, jni::Unwrap(*buffer.get()));
-  AHardwareBuffer_Desc cameraBufferDescription;
-  AHardwareBuffer_describe(cameraBuffer, &cameraBufferDescription);
-  if (cameraBufferDescription.usage & AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE) {
-    renderer->processCameraFrame(cameraBuffer, rotationDegrees, backCamera);
-  } else {
-    AHardwareBuffer_Desc gpuBufferDescription {
-            .width = cameraBufferDescription.width,
-            .height = cameraBufferDescription.height,
-            .layers = cameraBufferDescription.layers,
-            .format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM,
-            .usage = AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_GPU_FRAMEBUFFER,
-    };
-    if (!gpuBuffer) {
-      int res = AHardwareBuffer_allocate(&gpuBufferDescription, &gpuBuffer);
-      LOGI("HW buffer from camera does not support AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE.");
-      LOGI("Allocating GPU HW buffer manually. Result: %d", res);
+  cameraIngest().sendCameraFrame(frameHub(), cameraBuffer, rotationDegrees,
+                                 static_cast<bool>(backCamera), timestampNanos,
+                                 static_cast<bool>(realtimeTimestamp));
+}
+
+jni::jint CoreEngine::nativeDumpLog(JNIEnv &env, const jni::Class<CoreEngine> &) {
+  return static_cast<jni::jint>(BinaryLog::dump());
+}
+
+jni::jboolean CoreEngine::nativeStartFrameSource(JNIEnv &env, const jni::Class<CoreEngine> &,
+                                                 jni::jint width, jni::jint height,
+                                                 jni::jfloat framesPerSecond, jni::jint pattern,
+                                                 jni::jboolean gpuSampled, jni::jint jitterMicros,
+                                                 jni::jint burstLength, jni::jint burstPeriod,
+                                                 jni::jlong seed) {
+  if (width <= 0 || height <= 0 || pattern < 0 ||
+      pattern > static_cast<int>(FrameSource::Pattern::Noise)) {
+    LOGE("Invalid frame source parameters");
+    return static_cast<jni::jboolean>(false);
+  }
+  const FrameSource::Config config{
+          .width = static_cast<uint32_t>(width),
+          .height = static_cast<uint32_t>(height),
+          .framesPerSecond = framesPerSecond,
+          .pattern = static_cast<FrameSource::Pattern>(pattern),
+          .gpuSampled = static_cast<bool>(gpuSampled),
+          .jitterNanos = static_cast<int64_t>(std::max(jitterMicros, 0)) * 1000,
+          .burstLength = static_cast<uint32_t>(std::max(burstLength, 0)),
+          .burstPeriod = static_cast<uint32_t>(std::max(burstPeriod, 0)),
+          .seed = static_cast<uint64_t>(seed),
+  };
+  return static_cast<jni::jboolean>(frameSource().start(config));
+}
+
+void CoreEngine::nativeStopFrameSource(JNIEnv &env, const jni::Class<CoreEngine> &) {
+  frameSource().stop();
+}
+
+void CoreEngine::nativeSetCopyParallelism(JNIEnv &env, jni::jint threads, jni::jint stripes) {
+  cameraIngest().setCopyParallelism(threads, stripes);
+}
+
+void CoreEngine::nativeSetYuvConversion(JNIEnv &env, jni::jboolean bt709, jni::jboolean limitedRange) {
+  cameraIngest().setYuvConversion(bt709 ? YuvMatrix::Bt709 : YuvMatrix::Bt601,
+                                  limitedRange ? YuvRange::Limited : YuvRange::Full);
+}
+
+jni::Local<jni::Array<jni::jlong>> CoreEngine::nativeGetFrameStats(JNIEnv &env) {
+  const auto stats = renderer ? renderer->frameStats() : BaseRenderer::FrameStats{};
+  const std::vector<jni::jlong> values{
+          static_cast<jni::jlong>(stats.received),
+          static_cast<jni::jlong>(stats.dropped),
+          static_cast<jni::jlong>(stats.consumed),
+  };
+  return jni::Make<jni::Array<jni::jlong>>(env, values);
+}
+
+jni::Local<jni::Array<jni::jlong>> CoreEngine::nativeGetLatencyStats(JNIEnv &env) {
+  const auto snapshot = renderer ? renderer->latencyStats() : LatencyTracker::Snapshot{};
+  std::vector<jni::jlong> values;
+  values.reserve(snapshot.size() * 4);
+  for (const auto &span: snapshot) {
+    values.push_back(static_cast<jni::jlong>(span.samples));
+    values.push_back(static_cast<jni::jlong>(span.p50));
+    values.push_back(static_cast<jni::jlong>(span.p95));
+    values.push_back(static_cast<jni::jlong>(span.p99));
+  }
+  return jni::Make<jni::Array<jni::jlong>>(env, values);
+}
+
+void CoreEngine::nativeSetCacheDirectory(JNIEnv &env, jni::String const &directory) {
+  if (renderer) {
+    renderer->setCacheDirectory(jni::Make<std::string>(env, directory));
+  }
+}
+
+jni::jboolean CoreEngine::nativeStartHeadless(JNIEnv &env, jni::jint width, jni::jint height) {
+  if (!renderer || aNativeWindow) {
+    LOGW("Headless rendering could not be started, engine is destroyed or has a surface");
+    return static_cast<jni::jboolean>(false);
+  }
+  return static_cast<jni::jboolean>(renderer->startHeadless(width, height));
+}
+
+void CoreEngine::nativeStopHeadless(JNIEnv &env) {
+  if (renderer) {
+    renderer->stopHeadless();
+  }
+}
+
+void CoreEngine::nativeSetRenderPolicy(JNIEnv &env, jni::jint policy) {
+  if (policy < static_cast<int>(RenderPolicy::VsyncAligned) ||
+      policy > static_cast<int>(RenderPolicy::LateLatch)) {
+    LOGW("Unknown render policy %d", policy);
+    return;
+  }
+  if (renderer) {
+    renderer->setRenderPolicy(static_cast<RenderPolicy>(policy));
+  }
+}
+
+jni::jboolean CoreEngine::nativeCapture(JNIEnv &env, jni::jint source, jni::jint method,
+                                        jni::String const &path) {
+  if (source < static_cast<int>(CaptureSource::CameraFrame) ||
+      source > static_cast<int>(CaptureSource::RenderedOutput) ||
+      method < static_cast<int>(CaptureMethod::HardwareBufferLock) ||
+      method >= static_cast<int>(CaptureMethod::Count)) {
+    LOGW("Unknown capture source %d or method %d", source, method);
+    return static_cast<jni::jboolean>(false);
+  }
+  if (!renderer) {
+    return static_cast<jni::jboolean>(false);
+  }
+  auto callback = [path = jni::Make<std::string>(env, path)](const CaptureResult &result) {
+    if (result.ok && !writeFileAtomically(path, FrameCapture::encodePam(result.image))) {
+      LOGE("Capture could not be written to %s", path.c_str());
     }
-    void* gpuData = nullptr;
-    void* cpuData = nullptr;
-    AHardwareBuffer_lock(cameraBuffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &cpuData);
-    AHardwareBuffer_lock(gpuBuffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &gpuData);
-    memcpy(gpuData, cpuData, cameraBufferDescription.height * cameraBufferDescription.width * 4);
-    AHardwareBuffer_unlock(cameraBuffer, nullptr);
-    AHardwareBuffer_unlock(gpuBuffer, nullptr);
-    renderer->processCameraFrame(gpuBuffer, rotationDegrees, backCamera);
+  };
+  renderer->capture(static_cast<CaptureSource>(source), static_cast<CaptureMethod>(method),
+                    std::move(callback));
+  return static_cast<jni::jboolean>(true);
+}
+
+jni::Local<jni::Array<jni::jlong>> CoreEngine::nativeGetCaptureStats(JNIEnv &env) {
+  std::vector<jni::jlong> values;
+  values.reserve(static_cast<size_t>(CaptureMethod::Count) * 6);
+  for (int method = 0; method < static_cast<int>(CaptureMethod::Count); ++method) {
+    const auto stats = renderer ? renderer->captureStats(static_cast<CaptureMethod>(method))
+                                : FrameCapture::MethodStats{};
+    const auto captures = static_cast<int64_t>(std::max<uint64_t>(stats.captures, 1));
+    values.push_back(static_cast<jni::jlong>(stats.captures));
+    values.push_back(static_cast<jni::jlong>(stats.failures));
+    values.push_back(static_cast<jni::jlong>(stats.totalLatencyNanos / captures));
+    values.push_back(static_cast<jni::jlong>(stats.maxLatencyNanos));
+    values.push_back(static_cast<jni::jlong>(stats.totalRenderThreadNanos / captures));
+    values.push_back(static_cast<jni::jlong>(stats.maxRenderThreadNanos));
   }
+  return jni::Make<jni::Array<jni::jlong>>(env, values);
 }
 
 void CoreEngine::nativeDestroy(JNIEnv &env) {
   LOGI("Core engine destroy started");
+  if (renderer) {
+    // no new frames could arrive once detached, frames already delivered are released below
+    frameHub().detach(*renderer);
+  }
   renderer.reset();
   LOGI("Core engine destroy passed");
 }
@@ -7,11 +7,17 @@
 #include <jni/jni.hpp>
 
 #include "base_renderer.hpp"
+#include "camera_ingest.hpp"
+#include "frame_hub.hpp"
+#include "frame_source.hpp"
 #include "opengl_renderer.hpp"
 #include "vulkan_renderer.hpp"
 
 #include "util.hpp"
 
+// STL
+#include <vector>
+
 namespace engine {
 namespace android {
 
@@ -40,9 +46,30 @@ public:
             "initialize",
             "finalize",
             METHOD(&CoreEngine::nativeSetSurface, "nativeSetSurface"),
-            METHOD(&CoreEngine::nativeSendCameraFrame, "nativeSendCameraFrame"),
+            METHOD(&CoreEngine::nativeSetCopyParallelism, "nativeSetCopyParallelism"),
+            METHOD(&CoreEngine::nativeSetYuvConversion, "nativeSetYuvConversion"),
+            METHOD(&CoreEngine::nativeGetFrameStats, "nativeGetFrameStats"),
+            METHOD(&CoreEngine::nativeGetLatencyStats, "nativeGetLatencyStats"),
+            METHOD(&CoreEngine::nativeSetCacheDirectory, "nativeSetCacheDirectory"),
+            METHOD(&CoreEngine::nativeStartHeadless, "nativeStartHeadless"),
+            METHOD(&CoreEngine::nativeStopHeadless, "nativeStopHeadless"),
+            METHOD(&CoreEngine::nativeSetRenderPolicy, "nativeSetRenderPolicy"),
+            METHOD(&CoreEngine::nativeCapture, "nativeCapture"),
+            METHOD(&CoreEngine::nativeGetCaptureStats, "nativeGetCaptureStats"),
             METHOD(&CoreEngine::nativeDestroy, "nativeDestroy")
     );
+    jni::RegisterNatives(
+            env,
+            *jni::Class<CoreEngine>::Singleton(env),
+            jni::MakeNativeMethod<decltype(&CoreEngine::nativeSendCameraFrame),
+                    &CoreEngine::nativeSendCameraFrame>("nativeSendCameraFrame"),
+            jni::MakeNativeMethod<decltype(&CoreEngine::nativeDumpLog),
+                    &CoreEngine::nativeDumpLog>("nativeDumpLog"),
+            jni::MakeNativeMethod<decltype(&CoreEngine::nativeStartFrameSource),
+                    &CoreEngine::nativeStartFrameSource>("nativeStartFrameSource"),
+            jni::MakeNativeMethod<decltype(&CoreEngine::nativeStopFrameSource),
+                    &CoreEngine::nativeStopFrameSource>("nativeStopFrameSource")
+    );
   }
 
   CoreEngine(JNIEnv &env, jni::jint renderingMode);
@@ -54,15 +81,105 @@ public:
   void nativeSetSurface(JNIEnv &env, jni::Object <Surface> const &surface, jni::jint width,
                         jni::jint height);
 
-  void nativeSendCameraFrame(JNIEnv &env, jni::Object <HardwareBuffer> const &buffer, jni::jint rotationDegrees, jni::jboolean backCamera);
+  /**
+   * Ingests camera buffer once and fans it out to renderers of every live engine.
+   * Sensor timestamp is only used for latency tracing, 0 if unknown. It is ignored unless
+   * realtimeTimestamp tells it is in CLOCK_BOOTTIME.
+   */
+  static void nativeSendCameraFrame(JNIEnv &env, jni::Class<CoreEngine> const &,
+                                    jni::Object <HardwareBuffer> const &buffer,
+                                    jni::jint rotationDegrees, jni::jboolean backCamera,
+                                    jni::jlong timestampNanos, jni::jboolean realtimeTimestamp);
+
+  /**
+   * Formats hot path binary log of all native threads into logcat, returns amount of entries.
+   */
+  static jni::jint nativeDumpLog(JNIEnv &env, jni::Class<CoreEngine> const &);
+
+  /**
+   * Feeds synthetic frames to every live engine instead of the camera, see FrameSource::Config.
+   * Camera should not be sending frames meanwhile.
+   */
+  static jni::jboolean nativeStartFrameSource(JNIEnv &env, jni::Class<CoreEngine> const &,
+                                              jni::jint width, jni::jint height,
+                                              jni::jfloat framesPerSecond, jni::jint pattern,
+                                              jni::jboolean gpuSampled, jni::jint jitterMicros,
+                                              jni::jint burstLength, jni::jint burstPeriod,
+                                              jni::jlong seed);
+
+  static void nativeStopFrameSource(JNIEnv &env, jni::Class<CoreEngine> const &);
+
+  /**
+   * Number of threads (camera one included) and horizontal stripes used to copy CPU camera frames,
+   * values <= 0 restore defaults. Applied on the next camera frame, shared by all engines.
+   */
+  void nativeSetCopyParallelism(JNIEnv &env, jni::jint threads, jni::jint stripes);
+
+  /**
+   * Color matrix and range used to convert YUV camera frames, BT.601 full range (JFIF) by default
+   * which is what Android camera produces for YUV_420_888. Shared by all engines.
+   */
+  void nativeSetYuvConversion(JNIEnv &env, jni::jboolean bt709, jni::jboolean limitedRange);
+
+  /**
+   * Renderer frame counters as [received, dropped, consumed], all zeros once engine is destroyed.
+   */
+  jni::Local<jni::Array<jni::jlong>> nativeGetFrameStats(JNIEnv &env);
+
+  /**
+   * Renderer latency breakdown as [samples, p50, p95, p99] in nanoseconds per span, in
+   * LatencyTracker::Span order. All zeros once engine is destroyed.
+   */
+  jni::Local<jni::Array<jni::jlong>> nativeGetLatencyStats(JNIEnv &env);
+
+  /**
+   * App private directory renderer persists its pipeline / program caches to.
+   */
+  void nativeSetCacheDirectory(JNIEnv &env, jni::String const &directory);
+
+  /**
+   * Renders camera frames offscreen without a surface and vsync, see BaseRenderer::startHeadless.
+   */
+  jni::jboolean nativeStartHeadless(JNIEnv &env, jni::jint width, jni::jint height);
+
+  void nativeStopHeadless(JNIEnv &env);
+
+  /**
+   * RenderPolicy ordinal, unknown values are ignored.
+   */
+  void nativeSetRenderPolicy(JNIEnv &env, jni::jint policy);
+
+  /**
+   * CaptureSource and CaptureMethod ordinals, captured image is written to path as binary PAM
+   * from the capture thread. False if the capture could not be requested at all, a capture
+   * failing later on only shows up in the stats and the log.
+   */
+  jni::jboolean nativeCapture(JNIEnv &env, jni::jint source, jni::jint method,
+                              jni::String const &path);
+
+  /**
+   * Capture counters as [captures, failures, avg latency, max latency, avg render thread time,
+   * max render thread time] per CaptureMethod, times in nanoseconds. All zeros once engine is
+   * destroyed.
+   */
+  jni::Local<jni::Array<jni::jlong>> nativeGetCaptureStats(JNIEnv &env);
 
   void nativeDestroy(JNIEnv &env);
 
 private:
+  /**
+   * Camera frames are ingested once per process, copied / converted only once and then fanned out
+   * to every attached renderer. Both outlive all renderers as those report staging slots
+   * they do not use anymore back to the ingest.
+   */
+  static CameraIngest &cameraIngest();
+
+  static FrameHub &frameHub();
+
+  static FrameSource &frameSource();
+
   ANativeWindow *aNativeWindow;
   std::unique_ptr <BaseRenderer> renderer;
-
-  AHardwareBuffer * gpuBuffer = nullptr;
 };
 
 } // namespace android
@@ -0,0 +1,73 @@
+#include "file_util.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "util.hpp"
+
+// STL
+#include <cerrno>
+#include <cstring>
+
+namespace engine {
+namespace android {
+
+bool readFile(const std::string &path, std::vector<uint8_t> &data) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return false;
+  }
+  data.clear();
+  uint8_t chunk[16 * 1024];
+  ssize_t count;
+  while ((count = read(fd, chunk, sizeof(chunk))) != 0) {
+    if (count == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      return false;
+    }
+    data.insert(data.end(), chunk, chunk + count);
+  }
+  close(fd);
+  return true;
+}
+
+bool writeFileAtomically(const std::string &path, const std::vector<uint8_t> &data) {
+  const std::string tmpPath = path + ".tmp";
+  const int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    LOGW("Failed to create %s: %s", tmpPath.c_str(), strerror(errno));
+    return false;
+  }
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t count = write(fd, data.data() + written, data.size() - written);
+    if (count == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOGW("Failed to write %s: %s", tmpPath.c_str(), strerror(errno));
+      close(fd);
+      unlink(tmpPath.c_str());
+      return false;
+    }
+    written += static_cast<size_t>(count);
+  }
+  const bool synced = fsync(fd) == 0;
+  if (close(fd) != 0 || !synced) {
+    LOGW("Failed to sync %s: %s", tmpPath.c_str(), strerror(errno));
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+    LOGW("Failed to rename %s: %s", tmpPath.c_str(), strerror(errno));
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // namespace android
+} // namespace engine
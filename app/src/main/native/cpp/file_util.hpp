@@ -0,0 +1,23 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+/**
+ * Reads the whole file, returns false if it does not exist or could not be read.
+ */
+bool readFile(const std::string &path, std::vector<uint8_t> &data);
+
+/**
+ * Writes data into a temporary file next to path and renames it over path once synced,
+ * so readers never see a partially written file even if the process dies half way.
+ */
+bool writeFileAtomically(const std::string &path, const std::vector<uint8_t> &data);
+
+} // namespace android
+} // namespace engine
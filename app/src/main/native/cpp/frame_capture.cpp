@@ -0,0 +1,144 @@
+#include "frame_capture.hpp"
+
+#include "latency_tracker.hpp"
+#include "trace.hpp"
+#include "util.hpp"
+
+// STL
+#include <algorithm>
+#include <cstring>
+
+namespace engine {
+namespace android {
+
+const char *captureMethodName(CaptureMethod method) {
+  switch (method) {
+    case CaptureMethod::HardwareBufferLock:
+      return "AHardwareBuffer_lock";
+    case CaptureMethod::GlPixelBuffer:
+      return "PBO glReadPixels";
+    case CaptureMethod::VulkanStagingCopy:
+      return "vkCmdCopyImageToBuffer";
+    default:
+      return "unknown";
+  }
+}
+
+const char *captureSourceName(CaptureSource source) {
+  switch (source) {
+    case CaptureSource::CameraFrame:
+      return "camera frame";
+    case CaptureSource::RenderedOutput:
+      return "rendered output";
+    default:
+      return "unknown";
+  }
+}
+
+void FrameCapture::lockAndCopy(CaptureRequest request, AHardwareBuffer *buffer,
+                               std::shared_ptr<void> keepAlive) {
+  captureThread.scheduleTask([this, request = std::move(request), buffer,
+                                     keepAlive = std::move(keepAlive)]() mutable {
+    CapturedImage image;
+    bool ok;
+    {
+      TRACE_SCOPE("captureCopy");
+      ok = copyBuffer(buffer, image);
+    }
+    AHardwareBuffer_release(buffer);
+    keepAlive.reset();
+    finish(request, ok, std::move(image));
+  });
+}
+
+void FrameCapture::complete(CaptureRequest request, bool ok, CapturedImage image) {
+  captureThread.scheduleTask([this, request = std::move(request), ok,
+                                     image = std::move(image)]() mutable {
+    finish(request, ok, std::move(image));
+  });
+}
+
+FrameCapture::MethodStats FrameCapture::stats(CaptureMethod method) const {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return methodStats[static_cast<size_t>(method)];
+}
+
+bool FrameCapture::copyBuffer(AHardwareBuffer *buffer, CapturedImage &image) {
+  AHardwareBuffer_Desc description;
+  AHardwareBuffer_describe(buffer, &description);
+  if (description.format != AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM &&
+      description.format != AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM) {
+    LOGE("Buffer %p of format %u could not be captured, only RGBA is supported", buffer,
+         description.format);
+    return false;
+  }
+  void *pixels = nullptr;
+  if (AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr,
+                           &pixels) != 0) {
+    // e.g. Camera2 buffers allocated for GPU sampling only
+    LOGE("Buffer %p could not be locked for reading", buffer);
+    return false;
+  }
+  const size_t rowBytes = size_t(description.width) * 4;
+  const size_t stride = size_t(description.stride) * 4;
+  image.width = description.width;
+  image.height = description.height;
+  image.pixels.resize(rowBytes * description.height);
+  for (uint32_t row = 0; row < description.height; ++row) {
+    memcpy(image.pixels.data() + row * rowBytes, static_cast<const uint8_t *>(pixels) + row * stride,
+           rowBytes);
+  }
+  AHardwareBuffer_unlock(buffer, nullptr);
+  if (description.format == AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM) {
+    for (size_t i = 3; i < image.pixels.size(); i += 4) {
+      image.pixels[i] = 0xff;
+    }
+  }
+  return true;
+}
+
+std::vector<uint8_t> FrameCapture::encodePam(const CapturedImage &image) {
+  const auto header = "P7\nWIDTH " + std::to_string(image.width) +
+                      "\nHEIGHT " + std::to_string(image.height) +
+                      "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+  std::vector<uint8_t> data;
+  data.reserve(header.size() + image.pixels.size());
+  data.insert(data.end(), header.begin(), header.end());
+  data.insert(data.end(), image.pixels.begin(), image.pixels.end());
+  return data;
+}
+
+void FrameCapture::finish(CaptureRequest &request, bool ok, CapturedImage image) {
+  CaptureResult result{
+          .source = request.source,
+          .method = request.method,
+          .ok = ok,
+          .image = ok ? std::move(image) : CapturedImage{},
+          .latencyNanos = latencyClockNanos() - request.requestedNanos,
+          .renderThreadNanos = request.renderThreadNanos,
+  };
+  {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    auto &stats = methodStats[static_cast<size_t>(request.method)];
+    if (ok) {
+      ++stats.captures;
+      stats.totalLatencyNanos += result.latencyNanos;
+      stats.maxLatencyNanos = std::max(stats.maxLatencyNanos, result.latencyNanos);
+      stats.totalRenderThreadNanos += result.renderThreadNanos;
+      stats.maxRenderThreadNanos = std::max(stats.maxRenderThreadNanos, result.renderThreadNanos);
+    } else {
+      ++stats.failures;
+    }
+  }
+  LOGI("Capture of %s via %s %s: %ux%u, latency=%lld us, render thread=%lld us",
+       captureSourceName(request.source), captureMethodName(request.method),
+       ok ? "done" : "failed", result.image.width, result.image.height,
+       static_cast<long long>(result.latencyNanos / 1000),
+       static_cast<long long>(result.renderThreadNanos / 1000));
+  if (request.callback) {
+    request.callback(result);
+  }
+}
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <android/hardware_buffer.h>
+
+#include "looper_thread.hpp"
+
+// STL
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+enum class CaptureSource : int {
+  // camera buffer currently bound as a texture
+  CameraFrame = 0,
+  // what the renderer drew, before it was presented
+  RenderedOutput = 1,
+};
+
+enum class CaptureMethod : int {
+  // CPU lock of the buffer on the capture thread, camera frames only
+  HardwareBufferLock = 0,
+  // glReadPixels into one of two pixel pack buffers, mapped once its fence signalled
+  GlPixelBuffer = 1,
+  // vkCmdCopyImageToBuffer into a persistently mapped staging buffer, read once its fence signalled
+  VulkanStagingCopy = 2,
+  Count = 3,
+};
+
+const char *captureMethodName(CaptureMethod method);
+
+const char *captureSourceName(CaptureSource source);
+
+/**
+ * RGBA 8888, rows tightly packed and top to bottom.
+ */
+struct CapturedImage {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint8_t> pixels;
+};
+
+struct CaptureResult {
+  CaptureSource source = CaptureSource::CameraFrame;
+  CaptureMethod method = CaptureMethod::HardwareBufferLock;
+  bool ok = false;
+  CapturedImage image;
+  // from the request until pixels were in CPU memory, latencyClockNanos() time base
+  int64_t latencyNanos = 0;
+  // render thread time spent on the capture: recording, polling, mapping and copying out
+  int64_t renderThreadNanos = 0;
+};
+
+/**
+ * Called on the capture thread, also when the capture failed.
+ */
+using CaptureCallback = std::function<void(const CaptureResult &)>;
+
+/**
+ * Capture in progress, travels from the request through render thread to the capture thread.
+ */
+struct CaptureRequest {
+  CaptureSource source = CaptureSource::CameraFrame;
+  CaptureMethod method = CaptureMethod::HardwareBufferLock;
+  CaptureCallback callback;
+  int64_t requestedNanos = 0;
+  int64_t renderThreadNanos = 0;
+};
+
+/**
+ * Owns the capture thread: CPU copies out of locked buffers and result callbacks run there so
+ * neither the camera nor the render thread waits for them. Keeps per method statistics.
+ */
+class FrameCapture {
+public:
+  struct MethodStats {
+    uint64_t captures = 0;
+    uint64_t failures = 0;
+    int64_t totalLatencyNanos = 0;
+    int64_t maxLatencyNanos = 0;
+    int64_t totalRenderThreadNanos = 0;
+    int64_t maxRenderThreadNanos = 0;
+  };
+
+  FrameCapture() = default;
+
+  FrameCapture(FrameCapture const &) = delete;
+
+  /**
+   * Locks buffer and copies it on the capture thread. Takes over a reference of the buffer,
+   * keepAlive holds whatever keeps its content from being overwritten until the copy is done.
+   */
+  void lockAndCopy(CaptureRequest request, AHardwareBuffer *buffer,
+                   std::shared_ptr<void> keepAlive);
+
+  /**
+   * Hands a finished capture over to the capture thread, image is ignored if not ok.
+   */
+  void complete(CaptureRequest request, bool ok, CapturedImage image);
+
+  /**
+   * Could be called from any thread.
+   */
+  MethodStats stats(CaptureMethod method) const;
+
+  /**
+   * CPU readable RGBA 8888 buffer copied into image, false if it could not be locked.
+   */
+  static bool copyBuffer(AHardwareBuffer *buffer, CapturedImage &image);
+
+  /**
+   * Binary PAM (netpbm RGB_ALPHA), header says width and height so no side channel is needed.
+   */
+  static std::vector<uint8_t> encodePam(const CapturedImage &image);
+
+private:
+  void finish(CaptureRequest &request, bool ok, CapturedImage image);
+
+  mutable std::mutex statsMutex;
+  std::array<MethodStats, static_cast<size_t>(CaptureMethod::Count)> methodStats{};
+  LooperThread captureThread;
+};
+
+} // namespace android
+} // namespace engine
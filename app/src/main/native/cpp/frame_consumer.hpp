@@ -0,0 +1,23 @@
+#pragma once
+
+#include "camera_frame.hpp"
+
+namespace engine {
+namespace android {
+
+/**
+ * Anything camera frames could be fed into, renderers first of all.
+ */
+class FrameConsumer {
+public:
+  virtual ~FrameConsumer() = default;
+
+  /**
+   * Always called from camera worker thread, buffer is guaranteed to be alive only during the call
+   * so consumer has to acquire it if it needs it longer.
+   */
+  virtual void processCameraFrame(CameraFrame frame) = 0;
+};
+
+} // namespace android
+} // namespace engine
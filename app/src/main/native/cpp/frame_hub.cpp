@@ -0,0 +1,144 @@
+#include "frame_hub.hpp"
+
+#include "util.hpp"
+
+// STL
+#include <algorithm>
+
+namespace engine {
+namespace android {
+
+/**
+ * Source frame shared by the copies handed to consumers.
+ */
+struct FrameHub::SharedFrame {
+  explicit SharedFrame(CameraFrame frame) : source(std::move(frame)) {}
+
+  ~SharedFrame() {
+    // last consumer let go of the frame, imported or not
+    if (source.onRelease) {
+      source.onRelease();
+    }
+  }
+
+  /**
+   * Source is consumed once, consumers importing it later share the result.
+   */
+  bool consume() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!consumeAttempted) {
+      consumeAttempted = true;
+      consumed = !source.onConsume || source.onConsume();
+    }
+    return consumed;
+  }
+
+  CameraFrame source;
+  std::mutex mutex;
+  bool consumeAttempted = false;
+  bool consumed = false;
+};
+
+/**
+ * Copy of the frame handed to one consumer. It is settled by the first onConsume / onRelease
+ * call or once the consumer destroyed the frame, whichever comes first.
+ */
+struct FrameHub::Delivery {
+  Delivery(std::shared_ptr<SharedFrame> frame, std::shared_ptr<Consumer> consumer)
+          : frame(std::move(frame)), consumer(std::move(consumer)) {
+    ++this->consumer->pending;
+  }
+
+  ~Delivery() {
+    settle();
+  }
+
+  void settle() {
+    if (!settled) {
+      settled = true;
+      --consumer->pending;
+    }
+  }
+
+  std::shared_ptr<SharedFrame> frame;
+  std::shared_ptr<Consumer> consumer;
+  bool settled = false;
+};
+
+FrameHub::~FrameHub() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &consumer: consumers) {
+    LOGI("Frame hub consumer %p: delivered=%llu, skipped=%llu", consumer->consumer,
+         static_cast<unsigned long long>(consumer->delivered.load()),
+         static_cast<unsigned long long>(consumer->skipped.load()));
+  }
+}
+
+void FrameHub::attach(FrameConsumer &consumer, DropPolicy policy) {
+  auto state = std::make_shared<Consumer>();
+  state->consumer = &consumer;
+  state->policy = policy;
+  std::lock_guard<std::mutex> lock(mutex);
+  consumers.push_back(std::move(state));
+}
+
+void FrameHub::detach(FrameConsumer &consumer) {
+  std::lock_guard<std::mutex> lock(mutex);
+  consumers.erase(std::remove_if(consumers.begin(), consumers.end(),
+                                 [&consumer](const std::shared_ptr<Consumer> &state) {
+                                   return state->consumer == &consumer;
+                                 }),
+                  consumers.end());
+}
+
+void FrameHub::processCameraFrame(CameraFrame frame) {
+  // copies hold the shared frame, source is released when the last of them is gone
+  auto shared = std::make_shared<SharedFrame>(std::move(frame));
+  // consumers are only called with the lock held, so detach() waits for a delivery in progress
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &consumer: consumers) {
+    if (consumer->policy == DropPolicy::SkipWhilePending && consumer->pending.load() > 0) {
+      ++consumer->skipped;
+      continue;
+    }
+    ++consumer->delivered;
+    consumer->consumer->processCameraFrame(consumerFrame(shared, consumer));
+  }
+}
+
+FrameHub::ConsumerStats FrameHub::consumerStats(const FrameConsumer &consumer) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &state: consumers) {
+    if (state->consumer == &consumer) {
+      return ConsumerStats{
+              .delivered = state->delivered.load(),
+              .skipped = state->skipped.load(),
+      };
+    }
+  }
+  return {};
+}
+
+CameraFrame FrameHub::consumerFrame(const std::shared_ptr<SharedFrame> &shared,
+                                    const std::shared_ptr<Consumer> &consumer) {
+  // both callbacks are called on the consumer thread, so the delivery is not shared across threads
+  auto delivery = std::make_shared<Delivery>(shared, consumer);
+  return CameraFrame{
+          .buffer = shared->source.buffer,
+          .rotationDegrees = shared->source.rotationDegrees,
+          .backCamera = shared->source.backCamera,
+          .timestamps = shared->source.timestamps,
+          .onConsume = [delivery] {
+            delivery->settle();
+            return delivery->frame && delivery->frame->consume();
+          },
+          .onRelease = [delivery] {
+            delivery->settle();
+            // drops this copy's reference right away even if the consumer keeps the callback around
+            delivery->frame.reset();
+          },
+  };
+}
+
+} // namespace android
+} // namespace engine
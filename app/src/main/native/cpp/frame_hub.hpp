@@ -0,0 +1,81 @@
+#pragma once
+
+#include "frame_consumer.hpp"
+
+// STL
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+/**
+ * Fans every camera frame out to all attached consumers, so a camera buffer is ingested
+ * (copied / converted) once no matter how many renderers display it.
+ *
+ * Each consumer gets its own copy of the frame sharing one reference count: the source is
+ * consumed by whichever consumer imports it first and released once every consumer let go of it.
+ */
+class FrameHub : public FrameConsumer {
+public:
+  enum class DropPolicy {
+    // every frame is delivered, consumer keeps only the newest one pending (renderers mailbox)
+    ReplacePending,
+    // frames arriving while the previous one was not imported yet are not delivered at all
+    SkipWhilePending,
+  };
+
+  struct ConsumerStats {
+    uint64_t delivered = 0;
+    uint64_t skipped = 0;
+  };
+
+  FrameHub() = default;
+
+  FrameHub(FrameHub const &) = delete;
+
+  ~FrameHub() override;
+
+  /**
+   * Could be called from any thread, consumer gets frames starting with the next one.
+   */
+  void attach(FrameConsumer &consumer, DropPolicy policy = DropPolicy::ReplacePending);
+
+  /**
+   * Could be called from any thread, once it returns consumer does not get new frames.
+   * Frames already delivered stay valid and must still be released by the consumer.
+   */
+  void detach(FrameConsumer &consumer);
+
+  /**
+   * Called from camera worker thread.
+   */
+  void processCameraFrame(CameraFrame frame) override;
+
+  ConsumerStats consumerStats(const FrameConsumer &consumer) const;
+
+private:
+  struct Consumer {
+    FrameConsumer *consumer;
+    DropPolicy policy;
+    // delivered frames neither imported nor released yet
+    std::atomic<uint32_t> pending{0};
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> skipped{0};
+  };
+
+  struct SharedFrame;
+  struct Delivery;
+
+  static CameraFrame consumerFrame(const std::shared_ptr<SharedFrame> &shared,
+                                   const std::shared_ptr<Consumer> &consumer);
+
+  mutable std::mutex mutex;
+  std::vector<std::shared_ptr<Consumer>> consumers;
+};
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "camera_frame.hpp"
+
+// STL
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace engine {
+namespace android {
+
+/**
+ * Single slot, latest wins hand-off of camera frames from camera thread to render thread.
+ * Posting a frame while previous one is still pending replaces it, so render thread only ever
+ * imports the newest frame and camera thread never waits for it.
+ *
+ * Lock free: the slot is a single atomic pointer exchanged by both sides.
+ */
+class FrameMailbox {
+public:
+  struct Stats {
+    uint64_t posted = 0;
+    // replaced by a newer frame before render thread picked them up
+    uint64_t replaced = 0;
+    uint64_t taken = 0;
+  };
+
+  FrameMailbox() = default;
+
+  FrameMailbox(FrameMailbox const &) = delete;
+
+  ~FrameMailbox() {
+    delete slot.exchange(nullptr, std::memory_order_acquire);
+  }
+
+  /**
+   * Called from camera thread. Returns the frame that was still pending and got replaced,
+   * caller is responsible for releasing it. Nothing returned means the mailbox was empty and
+   * render thread has to be woken up to take the frame.
+   */
+  std::unique_ptr<CameraFrame> post(CameraFrame frame) {
+    auto *fresh = new CameraFrame(std::move(frame));
+    posted.fetch_add(1, std::memory_order_relaxed);
+    std::unique_ptr<CameraFrame> previous(slot.exchange(fresh, std::memory_order_acq_rel));
+    if (previous) {
+      replaced.fetch_add(1, std::memory_order_relaxed);
+    }
+    return previous;
+  }
+
+  /**
+   * Called from render thread, returns the newest frame or nullptr if it was already taken.
+   */
+  std::unique_ptr<CameraFrame> take() {
+    std::unique_ptr<CameraFrame> frame(slot.exchange(nullptr, std::memory_order_acq_rel));
+    if (frame) {
+      taken.fetch_add(1, std::memory_order_relaxed);
+    }
+    return frame;
+  }
+
+  /**
+   * Could be called from any thread, a frame is waiting to be taken.
+   */
+  bool pending() const {
+    return slot.load(std::memory_order_acquire) != nullptr;
+  }
+
+  Stats stats() const {
+    return Stats{
+            .posted = posted.load(std::memory_order_relaxed),
+            .replaced = replaced.load(std::memory_order_relaxed),
+            .taken = taken.load(std::memory_order_relaxed),
+    };
+  }
+
+private:
+  std::atomic<CameraFrame *> slot{nullptr};
+  std::atomic<uint64_t> posted{0};
+  std::atomic<uint64_t> replaced{0};
+  std::atomic<uint64_t> taken{0};
+};
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,77 @@
+#include "frame_scheduler.hpp"
+
+#include <ctime>
+
+// STL
+#include <algorithm>
+
+namespace engine {
+namespace android {
+
+namespace {
+
+// callbacks further apart than that many vsyncs say nothing about the period
+constexpr int64_t kMaxSkippedVsyncs = 4;
+
+} // namespace
+
+const char *renderPolicyName(RenderPolicy policy) {
+  switch (policy) {
+    case RenderPolicy::VsyncAligned:
+      return "vsync aligned";
+    case RenderPolicy::Immediate:
+      return "immediate";
+    case RenderPolicy::LateLatch:
+      return "late latch";
+    default:
+      return "unknown";
+  }
+}
+
+void FrameScheduler::onVsync(int64_t frameTimeNanos) {
+  const auto now = nowNanos();
+  if (frameTimeNanos > now || now - frameTimeNanos > kMaxSkippedVsyncs * period) {
+    frameTimeNanos = now;
+  }
+  const auto delta = frameTimeNanos - lastVsyncNanos;
+  lastVsyncNanos = frameTimeNanos;
+  if (delta <= 0) {
+    return;
+  }
+  // callbacks are only posted when there is something to draw, some vsyncs are skipped
+  const auto vsyncs = (delta + period / 2) / period;
+  if (vsyncs >= 1 && vsyncs <= kMaxSkippedVsyncs) {
+    period += (delta / vsyncs - period) / 8;
+  }
+}
+
+void FrameScheduler::recordRenderCost(int64_t nanos) {
+  renderCost = std::max(nanos, renderCost - renderCost / 16);
+}
+
+int64_t FrameScheduler::latchDeadline(int64_t nowNanos) const {
+  const auto budget = period - renderCost - kLatchMarginNanos;
+  if (budget <= 0) {
+    return nowNanos;
+  }
+  const auto deadline = lastVsyncNanos + budget;
+  if (nowNanos <= deadline) {
+    return deadline;
+  }
+  return deadline + (nowNanos - deadline + period - 1) / period * period;
+}
+
+void FrameScheduler::reset() {
+  lastVsyncNanos = 0;
+  period = kDefaultPeriodNanos;
+  renderCost = 0;
+}
+
+int64_t FrameScheduler::nowNanos() {
+  timespec now{};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,75 @@
+#pragma once
+
+// STL
+#include <cstdint>
+
+namespace engine {
+namespace android {
+
+/**
+ * When render thread draws a camera frame once it was imported.
+ */
+enum class RenderPolicy : int {
+  // one draw per vsync at most, right in the choreographer callback
+  VsyncAligned = 0,
+  // drawn as soon as imported, swap / acquire provide the back pressure
+  Immediate = 1,
+  // import of the newest frame is postponed until just enough time is left to draw it for the next vsync
+  LateLatch = 2,
+};
+
+const char *renderPolicyName(RenderPolicy policy);
+
+/**
+ * Vsync period and render cost estimates the late latch deadline is derived from.
+ * Times are CLOCK_MONOTONIC, the time base of choreographer frame timestamps.
+ * Accessed from render thread only.
+ */
+class FrameScheduler {
+public:
+  static constexpr int64_t kDefaultPeriodNanos = 16'666'667;
+  // slack left for the compositor on top of the measured render cost
+  static constexpr int64_t kLatchMarginNanos = 2'000'000;
+
+  FrameScheduler() = default;
+
+  FrameScheduler(FrameScheduler const &) = delete;
+
+  /**
+   * Refines vsync phase and period from consecutive choreographer callbacks. Callback time is
+   * taken instead of frameTimeNanos if that is not plausible: 32 bit builds get it truncated
+   * through the `long` of AChoreographer_frameCallback.
+   */
+  void onVsync(int64_t frameTimeNanos);
+
+  /**
+   * Time from latching a frame until its draw was submitted. The estimate follows peaks right
+   * away and decays slowly, a missed vsync costs more than latching a bit early.
+   */
+  void recordRenderCost(int64_t nanos);
+
+  /**
+   * Latest time a frame available at nowNanos could be latched and still make the next vsync it
+   * could make at all, extrapolated from the last vsync seen. nowNanos itself if render cost
+   * leaves no room to wait.
+   */
+  int64_t latchDeadline(int64_t nowNanos) const;
+
+  bool hasVsync() const { return lastVsyncNanos != 0; }
+
+  int64_t periodNanos() const { return period; }
+
+  int64_t renderCostNanos() const { return renderCost; }
+
+  void reset();
+
+  static int64_t nowNanos();
+
+private:
+  int64_t lastVsyncNanos = 0;
+  int64_t period = kDefaultPeriodNanos;
+  int64_t renderCost = 0;
+};
+
+} // namespace android
+} // namespace engine
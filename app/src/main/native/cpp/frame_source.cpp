@@ -0,0 +1,231 @@
+#include "frame_source.hpp"
+
+#include "latency_tracker.hpp"
+#include "trace.hpp"
+#include "util.hpp"
+
+#include <ctime>
+
+// STL
+#include <algorithm>
+
+namespace engine {
+namespace android {
+
+namespace {
+
+constexpr int64_t kMaxSleepNanos = 10'000'000;
+
+/**
+ * splitmix64, spreads consecutive seeds / frame numbers over the whole range.
+ */
+uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * Sleeps on the same clock sensor timestamps are taken from, in slices so stop() is not held up.
+ */
+void sleepUntil(int64_t deadlineNanos, const std::atomic<bool> &stopRequested) {
+  for (auto now = latencyClockNanos(); now < deadlineNanos && !stopRequested.load();
+       now = latencyClockNanos()) {
+    const auto wakeNanos = std::min(deadlineNanos, now + kMaxSleepNanos);
+    const timespec wake{
+            .tv_sec = static_cast<time_t>(wakeNanos / 1000000000),
+            .tv_nsec = static_cast<long>(wakeNanos % 1000000000),
+    };
+    clock_nanosleep(CLOCK_BOOTTIME, TIMER_ABSTIME, &wake, nullptr);
+  }
+}
+
+inline void writePixel(uint8_t *pixel, uint8_t r, uint8_t g, uint8_t b) {
+  pixel[0] = r;
+  pixel[1] = g;
+  pixel[2] = b;
+  pixel[3] = 0xff;
+}
+
+} // namespace
+
+FrameSource::FrameSource(CameraIngest &ingest, FrameConsumer &consumer)
+        : ingest(ingest), consumer(consumer) {
+}
+
+FrameSource::~FrameSource() {
+  stop();
+}
+
+bool FrameSource::start(const Config &config) {
+  stop();
+  if (config.width == 0 || config.height == 0 || config.framesPerSecond <= 0.0) {
+    LOGE("Invalid frame source config %ux%u @ %.1f fps", config.width, config.height,
+         config.framesPerSecond);
+    return false;
+  }
+  const AHardwareBuffer_Desc description{
+          .width = config.width,
+          .height = config.height,
+          .layers = 1,
+          .format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM,
+          .usage = static_cast<uint64_t>(AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN) |
+                   (config.gpuSampled ? AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE
+                                      : AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN),
+          .stride = 0,
+          .rfu0 = 0,
+          .rfu1 = 0,
+  };
+  for (uint32_t i = 0; i < std::max(config.bufferCount, 1u); ++i) {
+    AHardwareBuffer *buffer = nullptr;
+    if (AHardwareBuffer_allocate(&description, &buffer) != 0) {
+      LOGE("Could not allocate %ux%u frame source buffer", config.width, config.height);
+      releaseBuffers();
+      return false;
+    }
+    buffers.push_back(buffer);
+  }
+  {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    currentStats = {};
+  }
+  stopRequested = false;
+  isRunning = true;
+  thread = std::thread(&FrameSource::run, this, config);
+  LOGI("Frame source started: %ux%u @ %.1f fps, pattern %d, jitter %lld us, bursts %u/%u",
+       config.width, config.height, config.framesPerSecond, static_cast<int>(config.pattern),
+       static_cast<long long>(config.jitterNanos / 1000), config.burstLength, config.burstPeriod);
+  return true;
+}
+
+void FrameSource::stop() {
+  stopRequested = true;
+  if (thread.joinable()) {
+    thread.join();
+    const auto result = stats();
+    LOGI("Frame source stopped: frames=%llu, late=%llu",
+         static_cast<unsigned long long>(result.frames),
+         static_cast<unsigned long long>(result.late));
+  }
+  // consumers acquired whatever they still use
+  releaseBuffers();
+}
+
+FrameSource::Stats FrameSource::stats() const {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return currentStats;
+}
+
+void FrameSource::run(Config config) {
+  const auto periodNanos = static_cast<int64_t>(1e9 / config.framesPerSecond);
+  const auto startNanos = latencyClockNanos();
+  for (uint64_t frame = 0; !stopRequested.load(); ++frame) {
+    if (config.frameLimit != 0 && frame >= config.frameLimit) {
+      break;
+    }
+    // generated ahead of time like a sensor exposing the frame, only delivery is scheduled
+    const auto sensorNanos = startNanos + static_cast<int64_t>(frame) * periodNanos;
+    auto *buffer = buffers[frame % buffers.size()];
+    const auto generateStart = latencyClockNanos();
+    void *pixels = nullptr;
+    {
+      TRACE_SCOPE("generateFrame");
+      if (AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr,
+                               &pixels) != 0) {
+        LOGE("Could not lock frame source buffer %p", buffer);
+        break;
+      }
+      AHardwareBuffer_Desc description;
+      AHardwareBuffer_describe(buffer, &description);
+      generate(config.pattern, config.seed, frame, static_cast<uint8_t *>(pixels),
+               description.stride * 4, config.width, config.height);
+      AHardwareBuffer_unlock(buffer, nullptr);
+    }
+    const auto generateNanos = latencyClockNanos() - generateStart;
+    const auto deliverNanos = sensorNanos + deliveryDelay(config, frame, periodNanos);
+    const bool late = latencyClockNanos() > deliverNanos;
+    sleepUntil(deliverNanos, stopRequested);
+    ingest.sendCameraFrame(consumer, buffer, config.rotationDegrees, config.backCamera,
+                           sensorNanos, true);
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++currentStats.frames;
+    currentStats.late += late ? 1 : 0;
+    currentStats.generateNanos += generateNanos;
+  }
+  isRunning = false;
+}
+
+int64_t FrameSource::deliveryDelay(const Config &config, uint64_t frame, int64_t periodNanos) {
+  int64_t delay = 0;
+  if (config.jitterNanos > 0) {
+    delay = static_cast<int64_t>(mix(config.seed ^ mix(frame)) %
+                                 static_cast<uint64_t>(config.jitterNanos + 1));
+  }
+  if (config.burstLength > 1 && config.burstPeriod >= config.burstLength) {
+    const auto position = frame % config.burstPeriod;
+    if (position < config.burstLength) {
+      // held until the last frame of the burst is captured
+      delay = std::max(delay, static_cast<int64_t>(config.burstLength - 1 - position) * periodNanos);
+    }
+  }
+  return delay;
+}
+
+void FrameSource::generate(Pattern pattern, uint64_t seed, uint64_t frame,
+                           uint8_t *pixels, size_t stride, uint32_t width, uint32_t height) {
+  switch (pattern) {
+    case Pattern::MovingGradient: {
+      std::vector<uint8_t> red(width);
+      for (uint32_t x = 0; x < width; ++x) {
+        red[x] = static_cast<uint8_t>((x + frame) % width * 255 / width);
+      }
+      const auto blue = static_cast<uint8_t>(frame);
+      for (uint32_t y = 0; y < height; ++y) {
+        const auto green = static_cast<uint8_t>((y + frame) % height * 255 / height);
+        auto *row = pixels + y * stride;
+        for (uint32_t x = 0; x < width; ++x) {
+          writePixel(row + x * 4, red[x], green, blue);
+        }
+      }
+      break;
+    }
+    case Pattern::Checkerboard: {
+      const auto shift = frame * 4;
+      for (uint32_t y = 0; y < height; ++y) {
+        auto *row = pixels + y * stride;
+        for (uint32_t x = 0; x < width; ++x) {
+          const auto value = (((x + shift) >> 6) + (y >> 6)) & 1 ? 0xf0 : 0x20;
+          writePixel(row + x * 4, value, value, value);
+        }
+      }
+      break;
+    }
+    case Pattern::Noise: {
+      const auto frameSeed = mix(seed ^ mix(frame));
+      for (uint32_t y = 0; y < height; ++y) {
+        // xorshift per row, rows do not depend on each other or on the stride
+        auto state = mix(frameSeed + y) | 1;
+        auto *row = pixels + y * stride;
+        for (uint32_t x = 0; x < width; ++x) {
+          state ^= state << 13;
+          state ^= state >> 7;
+          state ^= state << 17;
+          writePixel(row + x * 4, static_cast<uint8_t>(state), static_cast<uint8_t>(state >> 8),
+                     static_cast<uint8_t>(state >> 16));
+        }
+      }
+      break;
+    }
+  }
+}
+
+void FrameSource::releaseBuffers() {
+  for (auto *buffer : buffers) {
+    AHardwareBuffer_release(buffer);
+  }
+  buffers.clear();
+}
+
+} // namespace android
+} // namespace engine
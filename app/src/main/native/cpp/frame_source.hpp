@@ -0,0 +1,123 @@
+#pragma once
+
+#include <android/hardware_buffer.h>
+
+#include "camera_ingest.hpp"
+#include "frame_consumer.hpp"
+
+// STL
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+/**
+ * Synthetic camera: generates test patterns into hardware buffers at a given rate and feeds them
+ * through CameraIngest exactly as camera callbacks do, so load tests and latency measurements are
+ * reproducible without a camera. Output only depends on the config and the frame number.
+ */
+class FrameSource {
+public:
+  enum class Pattern : int {
+    // diagonal gradient scrolling by a pixel per frame
+    MovingGradient = 0,
+    // 64 px squares moving by 4 px per frame
+    Checkerboard = 1,
+    // seeded per frame, worst case for any compression down the line
+    Noise = 2,
+  };
+
+  struct Config {
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    double framesPerSecond = 30.0;
+    Pattern pattern = Pattern::MovingGradient;
+    /**
+     * Buffers GPU sampled ones are passed to renderers as is (Camera2 path), CPU only ones are
+     * copied into the staging ring (CameraX path).
+     */
+    bool gpuSampled = false;
+    /**
+     * Every frame is delivered up to that late after its sensor timestamp, uniformly distributed.
+     */
+    int64_t jitterNanos = 0;
+    /**
+     * Out of every burstPeriod frames the first burstLength ones are held back and delivered
+     * back-to-back together with the last of them, as a stalled camera HAL does. 0 disables bursts.
+     */
+    uint32_t burstLength = 0;
+    uint32_t burstPeriod = 0;
+    /**
+     * Producer overwrites the oldest buffer once all are used, the same way a camera cycles
+     * through its ImageReader buffers.
+     */
+    uint32_t bufferCount = 4;
+    uint64_t seed = 1;
+    int rotationDegrees = 0;
+    bool backCamera = false;
+    // 0 runs until stop()
+    uint64_t frameLimit = 0;
+  };
+
+  struct Stats {
+    uint64_t frames = 0;
+    // frames delivered after their scheduled time because generation or ingest took too long
+    uint64_t late = 0;
+    int64_t generateNanos = 0;
+  };
+
+  FrameSource(CameraIngest &ingest, FrameConsumer &consumer);
+
+  FrameSource(FrameSource const &) = delete;
+
+  ~FrameSource();
+
+  /**
+   * Starts producing on a dedicated thread, restarting if already running. False if buffers of
+   * the requested size could not be allocated.
+   */
+  bool start(const Config &config);
+
+  /**
+   * Blocks until producer thread is gone, the last frame might still be in flight.
+   */
+  void stop();
+
+  bool running() const { return isRunning.load(); }
+
+  Stats stats() const;
+
+  /**
+   * Writes frame number `frame` of the pattern into RGBA 8888 pixels, stride is in bytes.
+   */
+  static void generate(Pattern pattern, uint64_t seed, uint64_t frame,
+                       uint8_t *pixels, size_t stride, uint32_t width, uint32_t height);
+
+private:
+  void run(Config config);
+
+  /**
+   * Delay of the frame relative to its sensor timestamp, bursts and jitter included.
+   */
+  static int64_t deliveryDelay(const Config &config, uint64_t frame, int64_t periodNanos);
+
+  void releaseBuffers();
+
+  CameraIngest &ingest;
+  FrameConsumer &consumer;
+
+  std::vector<AHardwareBuffer *> buffers;
+  std::thread thread;
+  std::atomic<bool> stopRequested{false};
+  std::atomic<bool> isRunning{false};
+
+  mutable std::mutex statsMutex;
+  Stats currentStats;
+};
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,123 @@
+#include "gl_program_cache.hpp"
+
+#include "file_util.hpp"
+#include "util.hpp"
+
+// STL
+#include <cstring>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+namespace {
+
+// FNV-1a, only has to tell drivers and shader revisions apart
+uint64_t hashString(uint64_t hash, const char *value) {
+  if (!value) {
+    value = "";
+  }
+  // terminating zero is hashed as well so concatenated strings could not collide
+  do {
+    hash ^= static_cast<uint8_t>(*value);
+    hash *= 0x100000001b3ULL;
+  } while (*value++);
+  return hash;
+}
+
+} // namespace
+
+GlProgramCache::~GlProgramCache() {
+  waitForSave();
+}
+
+void GlProgramCache::open(const std::string &directory,
+                          const GLchar *vertexSource,
+                          const GLchar *fragmentSource) {
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (directory.empty() || formats == 0) {
+    path.clear();
+    return;
+  }
+  path = directory + "/" + kFileName;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = hashString(hash, reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+  hash = hashString(hash, reinterpret_cast<const char *>(glGetString(GL_VERSION)));
+  hash = hashString(hash, vertexSource);
+  hash = hashString(hash, fragmentSource);
+  key = hash;
+}
+
+bool GlProgramCache::load(GLuint program) {
+  std::vector<uint8_t> data;
+  if (path.empty() || !readFile(path, data)) {
+    return false;
+  }
+  Header header;
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion || header.key != key
+      || header.binaryLength != data.size() - sizeof(header)) {
+    LOGW("GL program cache %s does not match driver or shaders, ignored", path.c_str());
+    return false;
+  }
+  glProgramBinary(program, header.binaryFormat, data.data() + sizeof(header),
+                  static_cast<GLsizei>(header.binaryLength));
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (linked == GL_FALSE) {
+    // driver may reject its own binaries after an update not changing GL_VERSION
+    LOGW("GL program binary rejected by the driver, building from source");
+    return false;
+  }
+  cachedSourceLinkMicros = header.sourceLinkMicros;
+  return true;
+}
+
+void GlProgramCache::save(GLuint program, int64_t sourceLinkMicros) {
+  if (path.empty()) {
+    return;
+  }
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  Header header{
+          .magic = kMagic,
+          .version = kVersion,
+          .key = key,
+          .binaryFormat = 0,
+          .binaryLength = 0,
+          .sourceLinkMicros = sourceLinkMicros,
+  };
+  std::vector<uint8_t> data(sizeof(header) + length);
+  GLsizei written = 0;
+  GLenum binaryFormat = 0;
+  glGetProgramBinary(program, length, &written, &binaryFormat, data.data() + sizeof(header));
+  if (written <= 0) {
+    return;
+  }
+  header.binaryFormat = binaryFormat;
+  header.binaryLength = static_cast<uint32_t>(written);
+  memcpy(data.data(), &header, sizeof(header));
+  data.resize(sizeof(header) + written);
+  waitForSave();
+  pendingSave = std::async(std::launch::async, [path = path, data = std::move(data)] {
+    if (writeFileAtomically(path, data)) {
+      LOGI("GL program cache saved to %s, %zu bytes", path.c_str(), data.size());
+    }
+  });
+}
+
+void GlProgramCache::waitForSave() {
+  if (pendingSave.valid()) {
+    pendingSave.get();
+  }
+}
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GLES3/gl3.h>
+
+// STL
+#include <cstdint>
+#include <future>
+#include <string>
+
+namespace engine {
+namespace android {
+
+/**
+ * Linked GL program binary persisted in an app provided directory, so shaders are not compiled
+ * from source on every surface creation. Binary is keyed by GL_RENDERER, GL_VERSION and shader
+ * sources, anything else found in the file is ignored.
+ *
+ * Must be used from render thread with the context current, file is written on a background thread.
+ */
+class GlProgramCache {
+public:
+  static constexpr const char *kFileName = "gl_program_cache.bin";
+
+  GlProgramCache() = default;
+
+  GlProgramCache(GlProgramCache const &) = delete;
+
+  ~GlProgramCache();
+
+  /**
+   * Computes the key for the current context and sources. Empty directory disables the cache.
+   */
+  void open(const std::string &directory, const GLchar *vertexSource, const GLchar *fragmentSource);
+
+  /**
+   * Loads cached binary into the program, false if there is none or the driver rejected it -
+   * program should be built from source then.
+   */
+  bool load(GLuint program);
+
+  /**
+   * Writes binary of the program just linked from source in the background,
+   * link time is stored alongside to report the time saved by later loads.
+   */
+  void save(GLuint program, int64_t sourceLinkMicros);
+
+  /**
+   * Source compile and link time stored with the binary by the last successful load.
+   */
+  int64_t sourceLinkMicros() const { return cachedSourceLinkMicros; }
+
+private:
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+    int64_t sourceLinkMicros;
+  };
+
+  static constexpr uint32_t kMagic = 0x47505243; // GPRC
+  static constexpr uint32_t kVersion = 1;
+
+  void waitForSave();
+
+  std::string path;
+  uint64_t key = 0;
+  int64_t cachedSourceLinkMicros = 0;
+  std::future<void> pendingSave;
+};
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,90 @@
+#include "latency_tracker.hpp"
+
+#include <ctime>
+
+// STL
+#include <algorithm>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+int64_t latencyClockNanos() {
+  timespec now{};
+  clock_gettime(CLOCK_BOOTTIME, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+void LatencyTracker::record(const FrameTimestamps &timestamps) {
+  std::lock_guard<std::mutex> lock(mutex);
+  add(SensorToIngest, timestamps.sensor, timestamps.ingested);
+  add(IngestToDeliver, timestamps.ingested, timestamps.delivered);
+  add(DeliverToImport, timestamps.delivered, timestamps.imported);
+  add(ImportToSubmit, timestamps.imported, timestamps.submitted);
+  add(SubmitToPresent, timestamps.submitted, timestamps.presented);
+  add(SensorToPresent, timestamps.sensor, timestamps.presented);
+}
+
+LatencyTracker::Snapshot LatencyTracker::snapshot() const {
+  Snapshot result;
+  std::vector<int64_t> sorted;
+  sorted.reserve(kWindowSize);
+  std::lock_guard<std::mutex> lock(mutex);
+  for (size_t span = 0; span < SpanCount; ++span) {
+    const auto &window = windows[span];
+    if (window.count == 0) {
+      continue;
+    }
+    sorted.assign(window.samples.begin(), window.samples.begin() + window.count);
+    std::sort(sorted.begin(), sorted.end());
+    // nearest rank
+    const auto percentile = [&sorted](size_t percent) {
+      const size_t rank = (percent * sorted.size() + 99) / 100;
+      return sorted[std::max<size_t>(rank, 1) - 1];
+    };
+    result[span] = Percentiles{
+            .samples = static_cast<uint32_t>(window.count),
+            .p50 = percentile(50),
+            .p95 = percentile(95),
+            .p99 = percentile(99),
+    };
+  }
+  return result;
+}
+
+void LatencyTracker::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  windows = {};
+}
+
+const char *LatencyTracker::spanName(Span span) {
+  switch (span) {
+    case SensorToIngest:
+      return "sensor->ingest";
+    case IngestToDeliver:
+      return "ingest->deliver";
+    case DeliverToImport:
+      return "deliver->import";
+    case ImportToSubmit:
+      return "import->submit";
+    case SubmitToPresent:
+      return "submit->present";
+    case SensorToPresent:
+      return "sensor->present";
+    default:
+      return "unknown";
+  }
+}
+
+void LatencyTracker::add(Span span, int64_t start, int64_t end) {
+  if (start <= 0 || end < start) {
+    return;
+  }
+  auto &window = windows[span];
+  window.samples[window.next] = end - start;
+  window.next = (window.next + 1) % kWindowSize;
+  window.count = std::min(window.count + 1, kWindowSize);
+}
+
+} // namespace android
+} // namespace engine
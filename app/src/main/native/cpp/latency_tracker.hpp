@@ -0,0 +1,97 @@
+#pragma once
+
+// STL
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace engine {
+namespace android {
+
+/**
+ * Clock every pipeline stage is stamped with. CLOCK_BOOTTIME is the time base of camera sensor
+ * timestamps (SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME), so they could be compared directly.
+ */
+int64_t latencyClockNanos();
+
+/**
+ * Timestamps of one camera frame on its way to the screen, 0 for stages it did not reach.
+ */
+struct FrameTimestamps {
+  // as reported by the camera in CLOCK_BOOTTIME, 0 when the sensor time base is not realtime
+  int64_t sensor = 0;
+  // camera buffer handed to native code
+  int64_t ingested = 0;
+  // copied / converted if needed and handed to the renderer
+  int64_t delivered = 0;
+  // imported as a texture on render thread
+  int64_t imported = 0;
+  // first draw using it submitted
+  int64_t submitted = 0;
+  // swap / present of that draw returned
+  int64_t presented = 0;
+};
+
+/**
+ * Rolling per stage latency breakdown over the last kWindowSize presented frames.
+ * Recording is done from render thread, snapshots could be taken from any thread.
+ */
+class LatencyTracker {
+public:
+  enum Span : size_t {
+    SensorToIngest,
+    IngestToDeliver,
+    DeliverToImport,
+    ImportToSubmit,
+    SubmitToPresent,
+    SensorToPresent,
+    SpanCount,
+  };
+
+  static constexpr size_t kWindowSize = 256;
+
+  struct Percentiles {
+    // frames the percentiles are computed over
+    uint32_t samples = 0;
+    int64_t p50 = 0;
+    int64_t p95 = 0;
+    int64_t p99 = 0;
+  };
+
+  using Snapshot = std::array<Percentiles, SpanCount>;
+
+  LatencyTracker() = default;
+
+  LatencyTracker(LatencyTracker const &) = delete;
+
+  /**
+   * Spans with a missing or out of order end point are skipped, e.g. sensor ones when camera
+   * timestamp source is not realtime and the sensor timestamp is left 0.
+   */
+  void record(const FrameTimestamps &timestamps);
+
+  Snapshot snapshot() const;
+
+  /**
+   * Forgets every sample, e.g. once frames are paced differently and old ones are not comparable.
+   */
+  void clear();
+
+  static const char *spanName(Span span);
+
+private:
+  struct Window {
+    std::array<int64_t, kWindowSize> samples{};
+    size_t next = 0;
+    size_t count = 0;
+  };
+
+  void add(Span span, int64_t start, int64_t end);
+
+  mutable std::mutex mutex;
+  std::array<Window, SpanCount> windows;
+};
+
+} // namespace android
+} // namespace engine
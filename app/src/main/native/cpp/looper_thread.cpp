@@ -29,7 +29,7 @@ LooperThread::~LooperThread() {
 }
 
 void LooperThread::scheduleTask(Task &&task) {
-  runLoop_->schedule(std::make_unique<Task>(task));
+  runLoop_->schedule(std::move(task));
 }
 
 }  // namespace android
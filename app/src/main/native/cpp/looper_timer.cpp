@@ -0,0 +1,77 @@
+#include "looper_timer.hpp"
+
+#include <android/looper.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// STL
+#include <cerrno>
+#include <stdexcept>
+
+namespace engine {
+namespace android {
+
+LooperTimer::LooperTimer(ALooper *alooper, Callback callback)
+        : alooper_(alooper), callback_(std::move(callback)),
+          fd_(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) {
+  if (fd_ == -1) {
+    throw std::runtime_error("Failed to create timerfd.");
+  }
+  const int ret = ALooper_addFd(
+          alooper_.get(), fd_, ALOOPER_POLL_CALLBACK, ALOOPER_EVENT_INPUT,
+          [](int, int, void *data) -> int {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            auto timer = reinterpret_cast<LooperTimer *>(data);
+            return timer->looperCallback();
+          },
+          this);
+  if (ret != 1) {
+    close(fd_);
+    throw std::runtime_error("Failed to add timerfd to Looper.");
+  }
+}
+
+LooperTimer::~LooperTimer() {
+  ALooper_removeFd(alooper_.get(), fd_);
+  close(fd_);
+}
+
+void LooperTimer::armAt(int64_t deadlineNanos) {
+  // zero would disarm it, a deadline in the past fires right away
+  setDeadline(deadlineNanos > 0 ? deadlineNanos : 1);
+  armed_ = true;
+}
+
+void LooperTimer::cancel() {
+  if (armed_) {
+    setDeadline(0);
+    armed_ = false;
+  }
+}
+
+void LooperTimer::setDeadline(int64_t deadlineNanos) {
+  itimerspec spec{};
+  spec.it_value.tv_sec = static_cast<time_t>(deadlineNanos / 1'000'000'000);
+  spec.it_value.tv_nsec = static_cast<long>(deadlineNanos % 1'000'000'000);
+  if (timerfd_settime(fd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+    throw std::runtime_error("Failed to arm timerfd.");
+  }
+}
+
+int LooperTimer::looperCallback() {
+  uint64_t expirations;
+  ssize_t count;
+  do {
+    count = read(fd_, &expirations, sizeof(expirations));
+  } while (count == -1 && errno == EINTR);
+  // re-armed or cancelled after it expired but before this poll, nothing to report
+  if (count == -1 || !armed_) {
+    return 1;
+  }
+  armed_ = false;
+  callback_();
+  return 1;
+}
+
+}  // namespace android
+}  // namespace engine
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "run_loop.hpp"
+
+// STL
+#include <cstdint>
+#include <functional>
+
+class ALooper;
+
+namespace engine {
+namespace android {
+
+/**
+ * One shot timer firing on a looper thread: a timerfd the looper watches next to its other fds,
+ * so the thread keeps servicing tasks and choreographer callbacks until it fires.
+ * Armed and cancelled from the looper thread only.
+ */
+class LooperTimer {
+public:
+  using Callback = std::function<void()>;
+
+  LooperTimer(ALooper *alooper, Callback callback);
+
+  LooperTimer(LooperTimer const &) = delete;
+
+  /**
+   * Looper thread must not be polling anymore or be the calling one.
+   */
+  ~LooperTimer();
+
+  /**
+   * Callback runs once at deadlineNanos (CLOCK_MONOTONIC) or on the next poll if that has passed,
+   * replaces the deadline of a timer still armed.
+   */
+  void armAt(int64_t deadlineNanos);
+
+  void cancel();
+
+  bool armed() const { return armed_; }
+
+private:
+  int looperCallback();
+
+  void setDeadline(int64_t deadlineNanos);
+
+  internal::ALooperHolder alooper_;
+  Callback callback_;
+  int fd_ = -1;
+  bool armed_ = false;
+};
+
+}  // namespace android
+}  // namespace engine
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace engine {
+namespace android {
+
+/**
+ * Everything the camera quad transform depends on, renderers recompute it when any of it changes.
+ */
+struct MvpParams {
+  float viewportRatio = 1.f;
+  float bufferImageRatio = 1.f;
+  int rotationDegrees = 0;
+  bool backCamera = false;
+  // Vulkan clip space has Y pointing down
+  bool flipClipY = false;
+};
+
+inline glm::mat4 cameraMvp(const MvpParams &params) {
+  float ratio = params.viewportRatio * params.bufferImageRatio;
+  float fov = 45.f;
+  auto proj = glm::perspective(glm::radians(fov), ratio, 0.1f, 100.0f);
+  if (params.flipClipY) {
+    // GLM was originally designed for OpenGL, where the Y coordinate of the clip coordinates is inverted.
+    // The easiest way to compensate for that is to flip the sign on the scaling factor of the Y axis in the projection matrix.
+    // If you don't do this, then the image will be rendered upside down.
+    proj[1][1] *= -1.f;
+  }
+  if (params.backCamera) {
+    proj[0][0] *= -1.f;
+  }
+  auto view = glm::lookAt(
+          // TODO make z = f(pov) and not hardcoded 3.f
+          glm::vec3(0.f, 0.f, 3.f),
+          glm::vec3(0.f, 0.f, 0.f),
+          // in majority of examples Y is expected to be 1.f but the actual image from camera is then flipped
+          // so using Y = -1.f
+          glm::vec3(0.f, -1.f, 0.f)
+  );
+  auto model = glm::rotate(
+          glm::mat4(1.0f),
+          glm::radians(static_cast<float>(params.rotationDegrees)),
+          glm::vec3(0.0f, 0.0f, 1.0f)
+          );
+  return proj * view * model;
+}
+
+} // namespace android
+} // namespace engine
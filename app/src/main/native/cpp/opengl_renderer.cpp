@@ -1,5 +1,10 @@
 #include "opengl_renderer.hpp"
 
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
 PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC eglGetNativeClientBufferANDROID = nullptr;
 PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR = nullptr;
 PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR = nullptr;
@@ -68,13 +73,26 @@ void checkCompileStatus(GLuint shader) {
   }
 }
 
+bool hasExtension(const char *extensions, const char *name) {
+  if (!extensions) {
+    return false;
+  }
+  // names are separated by spaces, one could be a prefix of another
+  const size_t length = strlen(name);
+  for (const char *found = strstr(extensions, name); found; found = strstr(found + length, name)) {
+    const bool startsWord = found == extensions || found[-1] == ' ';
+    if (startsWord && (found[length] == ' ' || found[length] == '\0')) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // OPENGL HELPER METHODS END
 
-void OpenGLRenderer::doFrame(long, void *data) {
+void OpenGLRenderer::doFrame(long timeStampNanos, void *data) {
   auto *renderer = reinterpret_cast<engine::android::OpenGLRenderer *>(data);
-  if (renderer->couldRender()) {
-    renderer->render();
-  }
+  renderer->onVsync(timeStampNanos);
 }
 
 bool OpenGLRenderer::prepareEgl() {
@@ -91,7 +109,7 @@ bool OpenGLRenderer::prepareEgl() {
   // see https://github.com/google/grafika/blob/b1df331e89cffeab621f02b102d4c2c25eb6088a/app/src/main/java/com/android/grafika/gles/EglCore.java#L150-L152
   const int attr[] = {
           EGL_CONFIG_CAVEAT, EGL_NONE,
-          EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+          EGL_SURFACE_TYPE, headless ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT,
           EGL_RED_SIZE, 8,
           EGL_GREEN_SIZE, 8,
           EGL_BLUE_SIZE, 8,
@@ -123,17 +141,33 @@ bool OpenGLRenderer::prepareEgl() {
     return false;
   }
 
-  if (!aNativeWindow) {
-    LOGW("ANativeWindow was destroyed, could not prepare EGL");
-    return false;
-  }
+  if (headless) {
+    // pbuffer works with every EGL implementation, Mesa llvmpipe included
+    const EGLint pbufferAttributes[] = {
+            EGL_WIDTH, viewportWidth,
+            EGL_HEIGHT, viewportHeight,
+            EGL_NONE
+    };
+    if (!(surface = eglCreatePbufferSurface(display, config, pbufferAttributes))) {
+      LOGE("eglCreatePbufferSurface() returned error %d", eglGetError());
+      destroyEgl();
+      return false;
+    }
+  } else {
+    if (!aNativeWindow) {
+      LOGW("ANativeWindow was destroyed, could not prepare EGL");
+      return false;
+    }
 
-  ANativeWindow_setBuffersGeometry(aNativeWindow, 0, 0, format);
+    ANativeWindow_setBuffersGeometry(aNativeWindow, 0, 0, format);
 
-  if (!(surface = eglCreateWindowSurface(display, config, aNativeWindow, nullptr))) {
-    LOGE("eglCreateWindowSurface() returned error %d", eglGetError());
-    destroyEgl();
-    return false;
+    // same type on Android, an integer handle in the Mesa headers of the host build
+    const auto window = reinterpret_cast<EGLNativeWindowType>(aNativeWindow);
+    if (!(surface = eglCreateWindowSurface(display, config, window, nullptr))) {
+      LOGE("eglCreateWindowSurface() returned error %d", eglGetError());
+      destroyEgl();
+      return false;
+    }
   }
   const int attribute_list[] = {
           EGL_CONTEXT_CLIENT_VERSION, 3,
@@ -160,50 +194,41 @@ bool OpenGLRenderer::prepareEgl() {
 
   // initialize extensions
 
-  eglCreateImageKHR = (PFNEGLCREATEIMAGEKHRPROC) eglGetProcAddress("eglCreateImageKHR");
-  if (!eglCreateImageKHR) {
-    LOGE("Couldn't get function pointer to eglCreateImageKHR extension!");
-    return false;
-  }
-  glEGLImageTargetTexture2DOES = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC) eglGetProcAddress(
-          "glEGLImageTargetTexture2DOES");
-  if (!glEGLImageTargetTexture2DOES) {
-    LOGE("Couldn't get function pointer to glEGLImageTargetTexture2DOES extension!");
-    return false;
-  }
-  eglDestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC) eglGetProcAddress("eglDestroyImageKHR");
-  if (!eglDestroyImageKHR) {
-    LOGE("Couldn't get function pointer to eglDestroyImageKHR extension!");
-    return false;
-  }
-  eglGetNativeClientBufferANDROID = (PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC) eglGetProcAddress(
-          "eglGetNativeClientBufferANDROID");
-  if (!eglGetNativeClientBufferANDROID) {
-    LOGE("Couldn't get function pointer to eglGetNativeClientBufferANDROID extension!");
-    return false;
+  hardwareBufferImport =
+          hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_ANDROID_get_native_client_buffer")
+          && hasExtension((const char *) glGetString(GL_EXTENSIONS), "GL_OES_EGL_image_external_essl3");
+  if (hardwareBufferImport) {
+    eglCreateImageKHR = (PFNEGLCREATEIMAGEKHRPROC) eglGetProcAddress("eglCreateImageKHR");
+    if (!eglCreateImageKHR) {
+      LOGE("Couldn't get function pointer to eglCreateImageKHR extension!");
+      return false;
+    }
+    glEGLImageTargetTexture2DOES = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC) eglGetProcAddress(
+            "glEGLImageTargetTexture2DOES");
+    if (!glEGLImageTargetTexture2DOES) {
+      LOGE("Couldn't get function pointer to glEGLImageTargetTexture2DOES extension!");
+      return false;
+    }
+    eglDestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC) eglGetProcAddress("eglDestroyImageKHR");
+    if (!eglDestroyImageKHR) {
+      LOGE("Couldn't get function pointer to eglDestroyImageKHR extension!");
+      return false;
+    }
+    eglGetNativeClientBufferANDROID = (PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC) eglGetProcAddress(
+            "eglGetNativeClientBufferANDROID");
+    if (!eglGetNativeClientBufferANDROID) {
+      LOGE("Couldn't get function pointer to eglGetNativeClientBufferANDROID extension!");
+      return false;
+    }
+    cameraTextureTarget = GL_TEXTURE_EXTERNAL_OES;
+  } else {
+    LOGW("AHardwareBuffer import is not supported, camera frames are uploaded from CPU");
+    cameraTextureTarget = GL_TEXTURE_2D;
   }
 
   // initial OpenGL ES setup
 
-  program = glCreateProgram();
-  vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-  glCompileShader(vertexShader);
-  checkCompileStatus(vertexShader);
-  glAttachShader(program, vertexShader);
-  glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-  glCompileShader(fragmentShader);
-  checkCompileStatus(fragmentShader);
-  glAttachShader(program, fragmentShader);
-  glLinkProgram(program);
-  checkLinkStatus(program);
-
-  glGenTextures(1, &cameraExternalTex);
-  glBindTexture(GL_TEXTURE_EXTERNAL_OES, cameraExternalTex);
-  glTexParameterf(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameterf(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+  createProgram();
 
   glGenBuffers(1, vbo);
   glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
@@ -231,8 +256,77 @@ bool OpenGLRenderer::prepareEgl() {
   return true;
 }
 
+void OpenGLRenderer::createProgram() {
+  const auto start = std::chrono::steady_clock::now();
+  const auto elapsedMicros = [&start] {
+    return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+  };
+  const GLchar *fragmentSource = hardwareBufferImport ? fragmentShaderSource
+                                                     : uploadFragmentShaderSource;
+  program = glCreateProgram();
+  programCache.open(cacheDirectory, vertexShaderSource, fragmentSource);
+  if (programCache.load(program)) {
+    const auto loadMicros = elapsedMicros();
+    LOGI("GL program loaded from binary cache in %lld us, saved %lld us of shader compilation",
+         static_cast<long long>(loadMicros),
+         static_cast<long long>(programCache.sourceLinkMicros() - loadMicros));
+    return;
+  }
+  // binary could have been rejected, start over with a clean program object
+  glDeleteProgram(program);
+  program = glCreateProgram();
+  vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
+  glCompileShader(vertexShader);
+  checkCompileStatus(vertexShader);
+  glAttachShader(program, vertexShader);
+  glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
+  glCompileShader(fragmentShader);
+  checkCompileStatus(fragmentShader);
+  glAttachShader(program, fragmentShader);
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(program);
+  checkLinkStatus(program);
+  const auto linkMicros = elapsedMicros();
+  LOGI("GL program compiled from source in %lld us", static_cast<long long>(linkMicros));
+  programCache.save(program, linkMicros);
+}
+
 void OpenGLRenderer::destroyEgl() {
   LOGI("Destroying EGL");
+  if (eglPrepared) {
+    destroyReadbacks();
+    // camera frames are handed back right after, nothing may sample them anymore
+    glFinish();
+    for (const auto &drawFence: drawFences) {
+      glDeleteSync(drawFence.fence);
+    }
+    drawFences.clear();
+    submitSerial = 0;
+    completedSerial = 0;
+    // context is still current, textures and images could be deleted
+    importedImages.clear([this](GlImportedImage &importedImage) {
+      destroyImportedImage(importedImage);
+    });
+    const auto stats = importedImages.stats();
+    LOGI("EGLImage cache: hits=%llu, misses=%llu, evictions=%llu",
+         static_cast<unsigned long long>(stats.hits),
+         static_cast<unsigned long long>(stats.misses),
+         static_cast<unsigned long long>(stats.evictions));
+    if (uploadTexture != 0) {
+      glDeleteTextures(1, &uploadTexture);
+    }
+  }
+  uploadTexture = 0;
+  uploadWidth = 0;
+  uploadHeight = 0;
+  cameraExternalTex = 0;
+  importedWidth = 0;
+  importedHeight = 0;
+  importedFormat = 0;
+  hardwareBufferDescribed = false;
   eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
   eglDestroyContext(eglDisplay, eglContext);
   eglDestroySurface(eglDisplay, eglSurface);
@@ -246,12 +340,12 @@ void OpenGLRenderer::destroyEgl() {
 }
 
 void OpenGLRenderer::renderImpl() {
+  TRACE_SCOPE("draw");
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   // no actual camera drawing to do if first hardware buffer was not described and loaded to ext texture
   if (!hardwareBufferDescribed) {
-    if (!eglSwapBuffers(eglDisplay, eglSurface)) {
-      LOGE("eglSwapBuffers returned error %d", eglGetError());
-    }
+    onFrameDrawn();
+    swap();
     return;
   }
   glUseProgram(program);
@@ -276,17 +370,141 @@ void OpenGLRenderer::renderImpl() {
   glEnableVertexAttribArray(1);
   glUniformMatrix4fv(uniformMvp, 1, GL_FALSE, glm::value_ptr(mvp));
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_EXTERNAL_OES, cameraExternalTex);
+  glBindTexture(cameraTextureTarget, cameraExternalTex);
   glUniform1i(externalSampler, 0);
   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
   glDisableVertexAttribArray(0);
   glDisableVertexAttribArray(1);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glUseProgram(0);
+  onFrameSubmitted();
+  // back buffer is undefined after the swap, read back has to be issued before it
+  onFrameDrawn();
+  // flushed together with the swap
+  drawFences.push_back(GlDrawFence{
+          .serial = ++submitSerial,
+          .fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0),
+  });
+  if (swap()) {
+    onFramePresented();
+    BLOG("Swapped buffers!");
+  }
+  releaseRetiredFrames();
+}
+
+uint64_t OpenGLRenderer::completedDrawSerial() {
+  while (!drawFences.empty()) {
+    const auto status = glClientWaitSync(drawFences.front().fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      break;
+    }
+    completedSerial = drawFences.front().serial;
+    glDeleteSync(drawFences.front().fence);
+    drawFences.pop_front();
+  }
+  return completedSerial;
+}
+
+bool OpenGLRenderer::swap() {
+  TRACE_SCOPE("swap");
+  if (headless) {
+    // swapping a pbuffer is a no-op, only make sure the commands reach the GPU
+    glFlush();
+    return true;
+  }
   if (!eglSwapBuffers(eglDisplay, eglSurface)) {
     LOGE("eglSwapBuffers returned error %d", eglGetError());
-  } else {
-    LOGI("Swapped buffers!");
+    return false;
+  }
+  return true;
+}
+
+bool OpenGLRenderer::startReadback(CaptureRequest &request) {
+  auto readback = std::find_if(readbacks.begin(), readbacks.end(), [](const GlReadback &slot) {
+    return !slot.inFlight;
+  });
+  if (readback == readbacks.end()) {
+    return false;
+  }
+  TRACE_SCOPE("readPixels");
+  const auto start = latencyClockNanos();
+  const auto size = static_cast<GLsizeiptr>(viewportWidth) * viewportHeight * 4;
+  if (readback->pbo == 0) {
+    glGenBuffers(1, &readback->pbo);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+  if (readback->size != size) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    readback->size = size;
+  }
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  // with a pack buffer bound this only queues the copy behind the draw and returns
+  glReadPixels(0, 0, viewportWidth, viewportHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback->width = viewportWidth;
+  readback->height = viewportHeight;
+  readback->inFlight = true;
+  readback->request = std::move(request);
+  readback->request.renderThreadNanos += latencyClockNanos() - start;
+  return true;
+}
+
+bool OpenGLRenderer::completeReadbacks(bool wait) {
+  bool inFlight = false;
+  for (auto &readback: readbacks) {
+    if (!readback.inFlight) {
+      continue;
+    }
+    const auto start = latencyClockNanos();
+    // flushes so the fence signals at all, zero timeout only queries it
+    const auto status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                         wait ? GLuint64(1000000000) : 0);
+    if (status == GL_TIMEOUT_EXPIRED && !wait) {
+      readback.request.renderThreadNanos += latencyClockNanos() - start;
+      inFlight = true;
+      continue;
+    }
+    CapturedImage image;
+    bool ok = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    if (ok) {
+      TRACE_SCOPE("mapReadback");
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+      const auto *pixels = static_cast<const uint8_t *>(
+              glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.size, GL_MAP_READ_BIT));
+      if (pixels) {
+        const size_t rowBytes = size_t(readback.width) * 4;
+        image.width = static_cast<uint32_t>(readback.width);
+        image.height = static_cast<uint32_t>(readback.height);
+        image.pixels.resize(rowBytes * image.height);
+        // GL rows go bottom to top
+        for (size_t row = 0; row < image.height; ++row) {
+          memcpy(image.pixels.data() + row * rowBytes,
+                 pixels + (image.height - 1 - row) * rowBytes, rowBytes);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      } else {
+        LOGE("glMapBufferRange returned error %d", glGetError());
+        ok = false;
+      }
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+    readback.inFlight = false;
+    readback.request.renderThreadNanos += latencyClockNanos() - start;
+    finishReadback(std::move(readback.request), ok, std::move(image));
+  }
+  return inFlight;
+}
+
+void OpenGLRenderer::destroyReadbacks() {
+  completeReadbacks(true);
+  for (auto &readback: readbacks) {
+    if (readback.pbo != 0) {
+      glDeleteBuffers(1, &readback.pbo);
+    }
+    readback = {};
   }
 }
 
@@ -295,10 +513,44 @@ void OpenGLRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
   if (!eglPrepared) {
     return;
   }
-  // first thing post another doFrame callback as we will need to render this texture
-  AChoreographer_postFrameCallback(aChoreographer, doFrame, this);
+  const auto destroy = [this](GlImportedImage &importedImage) {
+    destroyImportedImage(importedImage);
+  };
+  AHardwareBuffer_Desc description;
+  AHardwareBuffer_describe(buffer, &description);
+  if (!hardwareBufferImport) {
+    if (uploadHwBuffer(buffer, description)) {
+      cameraExternalTex = uploadTexture;
+      hardwareBufferDescribed = true;
+    }
+    return;
+  }
+  if (description.width != importedWidth || description.height != importedHeight
+      || description.format != importedFormat) {
+    // camera stream was re-configured, buffers of the old one are released by the producer
+    importedImages.retireAll();
+    importedWidth = description.width;
+    importedHeight = description.height;
+    importedFormat = description.format;
+  }
+  auto *entry = importedImages.find(buffer);
+  if (!entry) {
+    GlImportedImage importedImage{};
+    if (!importHwBuffer(buffer, importedImage)) {
+      return;
+    }
+    entry = &importedImages.insert(buffer, importedImage);
+  }
+  importedImages.collect(UINT64_MAX, destroy);
+  cameraExternalTex = entry->value.texture;
+  if (!hardwareBufferDescribed) {
+    hardwareBufferDescribed = true;
+  }
+}
+
+bool OpenGLRenderer::importHwBuffer(AHardwareBuffer *buffer, GlImportedImage &importedImage) const {
   static EGLint attrs[] = {EGL_NONE};
-  EGLImageKHR image = eglCreateImageKHR(
+  importedImage.image = eglCreateImageKHR(
           eglDisplay,
           // a bit strange - at least Adreno 640 works OK only when EGL_NO_CONTEXT is passed...
           // on Mali G77 passing valid OpenGL context works here but EGL_NO_CONTEXT works as well so
@@ -307,14 +559,60 @@ void OpenGLRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
           EGL_NATIVE_BUFFER_ANDROID,
           eglGetNativeClientBufferANDROID(buffer),
           attrs);
-  glBindTexture(GL_TEXTURE_EXTERNAL_OES, cameraExternalTex);
-  glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, image);
+  if (importedImage.image == EGL_NO_IMAGE_KHR) {
+    LOGE("eglCreateImageKHR() returned error %d", eglGetError());
+    return false;
+  }
+  glGenTextures(1, &importedImage.texture);
+  glBindTexture(GL_TEXTURE_EXTERNAL_OES, importedImage.texture);
+  glTexParameterf(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameterf(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // texture samples the buffer memory directly, frames written into it later show up as is
+  glEGLImageTargetTexture2DOES(GL_TEXTURE_EXTERNAL_OES, importedImage.image);
   glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
-  // interesting - works OK destroying it here, before actual rendering
-  eglDestroyImageKHR(eglDisplay, image);
-  if (!hardwareBufferDescribed) {
-    hardwareBufferDescribed = true;
+  return true;
+}
+
+void OpenGLRenderer::destroyImportedImage(GlImportedImage &importedImage) const {
+  glDeleteTextures(1, &importedImage.texture);
+  eglDestroyImageKHR(eglDisplay, importedImage.image);
+}
+
+bool OpenGLRenderer::uploadHwBuffer(AHardwareBuffer *buffer, const AHardwareBuffer_Desc &description) {
+  if (description.format != AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM
+      && description.format != AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM) {
+    LOGE("Camera buffer format %u could not be uploaded, only RGBA 8888 is supported", description.format);
+    return false;
+  }
+  TRACE_SCOPE("upload");
+  void *pixels = nullptr;
+  if (AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_READ_RARELY, -1, nullptr, &pixels) != 0) {
+    LOGE("Could not lock camera buffer %p for upload", buffer);
+    return false;
   }
+  if (uploadTexture == 0) {
+    glGenTextures(1, &uploadTexture);
+  }
+  glBindTexture(GL_TEXTURE_2D, uploadTexture);
+  if (description.width != uploadWidth || description.height != uploadHeight) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, static_cast<GLsizei>(description.width),
+                 static_cast<GLsizei>(description.height), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    uploadWidth = description.width;
+    uploadHeight = description.height;
+  }
+  // buffer stride is in pixels, GL copies the rows out before returning so it could be unlocked
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(description.stride));
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(description.width),
+                  static_cast<GLsizei>(description.height), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  AHardwareBuffer_unlock(buffer, nullptr);
+  return true;
 }
 
 } // namespace android
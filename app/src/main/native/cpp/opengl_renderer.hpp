@@ -7,11 +7,22 @@
 #include <GLES2/gl2ext.h>
 
 #include "base_renderer.hpp"
+#include "buffer_import_cache.hpp"
+#include "gl_program_cache.hpp"
+
+// STL
+#include <array>
+#include <deque>
 
 namespace engine {
 namespace android {
 
 class OpenGLRenderer : public BaseRenderer {
+public:
+    ~OpenGLRenderer() override {
+        stopRendering();
+    }
+
 protected:
 
     const char *renderingModeName() override {
@@ -46,6 +57,22 @@ protected:
         AChoreographer_postFrameCallback(aChoreographer, doFrame, this);
     }
 
+    bool supportsReadback(CaptureMethod method) const override {
+        return method == CaptureMethod::GlPixelBuffer;
+    }
+
+    bool startReadback(CaptureRequest &request) override;
+
+    bool pollReadbacks() override {
+        return completeReadbacks(false);
+    }
+
+    uint64_t submittedDrawSerial() const override {
+        return submitSerial;
+    }
+
+    uint64_t completedDrawSerial() override;
+
 private:
     ///////// OpenGL
     const GLchar *vertexShaderSource = "#version 320 es\n"
@@ -67,6 +94,15 @@ private:
                                          "void main() {"
                                          " FragColor = texture(sExtSampler, vCoordinate);"
                                          "}";
+    // camera frames copied into a regular texture when the driver could not import them
+    const GLchar *uploadFragmentShaderSource = "#version 320 es\n"
+                                               "precision mediump float;"
+                                               "in vec2 vCoordinate;"
+                                               "out vec4 FragColor;"
+                                               "uniform sampler2D sExtSampler;"
+                                               "void main() {"
+                                               " FragColor = texture(sExtSampler, vCoordinate);"
+                                               "}";
 
     /**
      * Store all the verticies in one array and operate with strides instead of storing 2 VBOs:
@@ -85,7 +121,69 @@ private:
     GLuint vbo[1];
     GLint uniformMvp = 0;
     GLint externalSampler = 0;
+
+    /**
+     * Camera buffer wrapped as EGLImage together with the external texture it is bound to.
+     */
+    struct GlImportedImage {
+        EGLImageKHR image;
+        GLuint texture;
+    };
+    using ImportedImageCache = BufferImportCache<GlImportedImage>;
+    /**
+     * Camera producers cycle through a few buffers, a recycled one only switches the bound texture.
+     * GL defers deleting objects still used by queued commands so entries are destroyed right away.
+     */
+    ImportedImageCache importedImages;
+    // texture of the most recent frame, external one unless it was uploaded
     GLuint cameraExternalTex = 0;
+    // geometry of cached buffers, producer re-allocates its buffers when it changes
+    uint32_t importedWidth = 0;
+    uint32_t importedHeight = 0;
+    uint32_t importedFormat = 0;
+
+    /**
+     * Set when the driver imports AHardwareBuffers (EGL_ANDROID_get_native_client_buffer and
+     * external textures), every Android one. Otherwise, e.g. Mesa on a Linux host, frames are locked
+     * and copied into uploadTexture, only RGBA 8888 ones.
+     */
+    bool hardwareBufferImport = false;
+    GLenum cameraTextureTarget = GL_TEXTURE_EXTERNAL_OES;
+    GLuint uploadTexture = 0;
+    uint32_t uploadWidth = 0;
+    uint32_t uploadHeight = 0;
+
+    /**
+     * Program binary persisted in cacheDirectory, skips shader compilation on surface re-creation.
+     */
+    GlProgramCache programCache;
+
+    /**
+     * Pixel pack buffer glReadPixels of the back buffer goes into without waiting for the draw,
+     * mapped once its fence signalled. Two of them so a capture could start while the previous one
+     * is still on its way.
+     */
+    struct GlReadback {
+        GLuint pbo = 0;
+        GLsizeiptr size = 0;
+        GLsync fence = nullptr;
+        int width = 0;
+        int height = 0;
+        bool inFlight = false;
+        CaptureRequest request;
+    };
+    std::array<GlReadback, 2> readbacks;
+
+    /**
+     * Fence behind every camera draw, camera frames it sampled are handed back once it signalled.
+     */
+    struct GlDrawFence {
+        uint64_t serial = 0;
+        GLsync fence = nullptr;
+    };
+    std::deque<GlDrawFence> drawFences;
+    uint64_t submitSerial = 0;
+    uint64_t completedSerial = 0;
 
     ///////// EGL
 
@@ -102,10 +200,43 @@ private:
 
     bool prepareEgl();
 
+    /**
+     * Links the program from the cached binary if possible, compiles shaders from source otherwise.
+     */
+    void createProgram();
+
+    /**
+     * Wraps camera buffer as EGLImage bound to a new external texture, false on failure.
+     */
+    bool importHwBuffer(AHardwareBuffer *buffer, GlImportedImage &importedImage) const;
+
+    void destroyImportedImage(GlImportedImage &importedImage) const;
+
+    /**
+     * Copies camera buffer into uploadTexture, false on failure.
+     */
+    bool uploadHwBuffer(AHardwareBuffer *buffer, const AHardwareBuffer_Desc &description);
+
     void destroyEgl();
 
+    /**
+     * Finishes readbacks whose fence signalled, waits for all of them if wait is set.
+     * Returns true while any is still in flight.
+     */
+    bool completeReadbacks(bool wait);
+
+    /**
+     * Context must be current, readbacks still in flight are waited for.
+     */
+    void destroyReadbacks();
+
     void renderImpl();
 
+    /**
+     * Presents the window surface, only flushes in headless mode. False on failure.
+     */
+    bool swap();
+
     ///////// Callbacks for AChoreographer and ALooper stored as private static functions
 
     static void doFrame(long timeStampNanos, void *data);
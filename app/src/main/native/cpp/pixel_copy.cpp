@@ -0,0 +1,263 @@
+#include "pixel_copy.hpp"
+
+#include "worker_pool.hpp"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// STL
+#include <cstring>
+
+namespace engine {
+namespace android {
+
+namespace {
+
+constexpr size_t kBlockBytes = 64;
+
+[[maybe_unused]] size_t alignmentHead(const uint8_t *ptr, size_t alignment, size_t bytes) {
+  const size_t head = (alignment - (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1))) &
+                      (alignment - 1);
+  return head < bytes ? head : bytes;
+}
+
+#if defined(__ARM_NEON)
+
+void copyRowNeon(const uint8_t *src, uint8_t *dst, size_t bytes, bool nonTemporal) {
+#if defined(__aarch64__)
+  if (nonTemporal) {
+    // there is no intrinsic for STNP so doing it by hand, 64 bytes per iteration
+    for (; bytes >= kBlockBytes; bytes -= kBlockBytes, src += kBlockBytes, dst += kBlockBytes) {
+      asm volatile(
+              "ldp q0, q1, [%0]\n"
+              "ldp q2, q3, [%0, #32]\n"
+              "stnp q0, q1, [%1]\n"
+              "stnp q2, q3, [%1, #32]\n"
+              :
+              : "r"(src), "r"(dst)
+              : "v0", "v1", "v2", "v3", "memory");
+    }
+  }
+#else
+  (void) nonTemporal;
+#endif
+  for (; bytes >= kBlockBytes; bytes -= kBlockBytes, src += kBlockBytes, dst += kBlockBytes) {
+    const uint8x16_t a = vld1q_u8(src);
+    const uint8x16_t b = vld1q_u8(src + 16);
+    const uint8x16_t c = vld1q_u8(src + 32);
+    const uint8x16_t d = vld1q_u8(src + 48);
+    vst1q_u8(dst, a);
+    vst1q_u8(dst + 16, b);
+    vst1q_u8(dst + 32, c);
+    vst1q_u8(dst + 48, d);
+  }
+  memcpy(dst, src, bytes);
+}
+
+#endif
+
+#if defined(__SSE2__)
+
+void copyRowSse2(const uint8_t *src, uint8_t *dst, size_t bytes, bool nonTemporal) {
+  if (nonTemporal) {
+    // streaming stores require aligned destination
+    const size_t head = alignmentHead(dst, 16, bytes);
+    memcpy(dst, src, head);
+    src += head;
+    dst += head;
+    bytes -= head;
+    for (; bytes >= kBlockBytes; bytes -= kBlockBytes, src += kBlockBytes, dst += kBlockBytes) {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+      const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+      const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+      _mm_stream_si128(reinterpret_cast<__m128i *>(dst), a);
+      _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 16), b);
+      _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 32), c);
+      _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 48), d);
+    }
+  } else {
+    for (; bytes >= kBlockBytes; bytes -= kBlockBytes, src += kBlockBytes, dst += kBlockBytes) {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+      const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+      const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), a);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), b);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 32), c);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 48), d);
+    }
+  }
+  memcpy(dst, src, bytes);
+}
+
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// compiled for AVX2 regardless of global flags, only called after runtime CPU check
+__attribute__((target("avx2")))
+void copyRowAvx2(const uint8_t *src, uint8_t *dst, size_t bytes, bool nonTemporal) {
+  if (nonTemporal) {
+    const size_t head = alignmentHead(dst, 32, bytes);
+    memcpy(dst, src, head);
+    src += head;
+    dst += head;
+    bytes -= head;
+    for (; bytes >= kBlockBytes; bytes -= kBlockBytes, src += kBlockBytes, dst += kBlockBytes) {
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+      _mm256_stream_si256(reinterpret_cast<__m256i *>(dst), a);
+      _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 32), b);
+    }
+  } else {
+    for (; bytes >= kBlockBytes; bytes -= kBlockBytes, src += kBlockBytes, dst += kBlockBytes) {
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), a);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), b);
+    }
+  }
+  memcpy(dst, src, bytes);
+}
+
+#endif
+
+void copyRowMemcpy(const uint8_t *src, uint8_t *dst, size_t bytes, bool) {
+  memcpy(dst, src, bytes);
+}
+
+using RowCopyFunction = void (*)(const uint8_t *, uint8_t *, size_t, bool);
+
+RowCopyFunction rowCopyFunction(CopyKernel kernel) {
+  switch (kernel) {
+#if defined(__ARM_NEON)
+    case CopyKernel::Neon:
+      return copyRowNeon;
+#endif
+#if defined(__SSE2__)
+    case CopyKernel::Sse2:
+      return copyRowSse2;
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    case CopyKernel::Avx2:
+      return __builtin_cpu_supports("avx2") ? copyRowAvx2 : copyRowMemcpy;
+#endif
+    default:
+      return copyRowMemcpy;
+  }
+}
+
+void storeFence(CopyKernel kernel) {
+#if defined(__SSE2__)
+  if (kernel == CopyKernel::Sse2 || kernel == CopyKernel::Avx2) {
+    // make streaming stores globally visible before the GPU gets the buffer
+    _mm_sfence();
+  }
+#elif defined(__aarch64__)
+  if (kernel == CopyKernel::Neon) {
+    asm volatile("dmb ishst" ::: "memory");
+  }
+#else
+  (void) kernel;
+#endif
+}
+
+}  // namespace
+
+CopyKernel bestCopyKernel() {
+  static const CopyKernel kernel = [] {
+#if defined(__ARM_NEON)
+    return CopyKernel::Neon;
+#elif defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+      return CopyKernel::Avx2;
+    }
+#if defined(__SSE2__)
+    return CopyKernel::Sse2;
+#else
+    return CopyKernel::Memcpy;
+#endif
+#else
+    return CopyKernel::Memcpy;
+#endif
+  }();
+  return kernel;
+}
+
+const char *copyKernelName(CopyKernel kernel) {
+  switch (kernel) {
+    case CopyKernel::Memcpy:
+      return "memcpy";
+    case CopyKernel::Neon:
+      return "NEON";
+    case CopyKernel::Sse2:
+      return "SSE2";
+    case CopyKernel::Avx2:
+      return "AVX2";
+  }
+  return "unknown";
+}
+
+void copyPlane(const uint8_t *src, size_t srcStride,
+               uint8_t *dst, size_t dstStride,
+               size_t rowBytes, size_t rows) {
+  copyPlane(bestCopyKernel(), rowBytes * rows >= kNonTemporalThresholdBytes,
+            src, srcStride, dst, dstStride, rowBytes, rows);
+}
+
+void copyPlane(CopyKernel kernel, bool nonTemporal,
+               const uint8_t *src, size_t srcStride,
+               uint8_t *dst, size_t dstStride,
+               size_t rowBytes, size_t rows) {
+  if (rowBytes == 0 || rows == 0) {
+    return;
+  }
+  // no padding on both sides - whole plane is one long row
+  if (srcStride == rowBytes && dstStride == rowBytes) {
+    rowBytes *= rows;
+    rows = 1;
+  }
+  const auto copyRow = rowCopyFunction(kernel);
+  for (size_t row = 0; row < rows; ++row) {
+    copyRow(src + row * srcStride, dst + row * dstStride, rowBytes, nonTemporal);
+  }
+  if (nonTemporal) {
+    storeFence(kernel);
+  }
+}
+
+void copyPlaneStriped(WorkerPool &pool, size_t stripes,
+                      const uint8_t *src, size_t srcStride,
+                      uint8_t *dst, size_t dstStride,
+                      size_t rowBytes, size_t rows) {
+  const auto kernel = bestCopyKernel();
+  const bool nonTemporal = rowBytes * rows >= kNonTemporalThresholdBytes;
+  pool.parallelFor(stripes, [&](size_t stripe, size_t stripeCount) {
+    const auto range = WorkerPool::stripeRows(rows, stripe, stripeCount);
+    // every stripe fences its own non-temporal stores before the join
+    copyPlane(kernel, nonTemporal,
+              src + range.first * srcStride, srcStride,
+              dst + range.first * dstStride, dstStride,
+              rowBytes, range.second - range.first);
+  });
+}
+
+void copyPlaneScalar(const uint8_t *src, size_t srcStride,
+                     uint8_t *dst, size_t dstStride,
+                     size_t rowBytes, size_t rows) {
+  for (size_t row = 0; row < rows; ++row) {
+    const uint8_t *srcRow = src + row * srcStride;
+    uint8_t *dstRow = dst + row * dstStride;
+    for (size_t i = 0; i < rowBytes; ++i) {
+      dstRow[i] = srcRow[i];
+    }
+  }
+}
+
+}  // namespace android
+}  // namespace engine
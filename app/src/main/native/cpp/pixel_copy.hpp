@@ -0,0 +1,66 @@
+#pragma once
+
+// STL
+#include <cstddef>
+#include <cstdint>
+
+namespace engine {
+namespace android {
+
+class WorkerPool;
+
+enum class CopyKernel {
+  Memcpy,
+  Neon,
+  Sse2,
+  Avx2,
+};
+
+/**
+ * Frames bigger than this are written with non-temporal stores - 4K RGBA frame does not fit
+ * any mobile cache anyway so there is no point in evicting render thread data for it.
+ */
+constexpr size_t kNonTemporalThresholdBytes = 8u << 20;
+
+/**
+ * Best kernel supported by the CPU we are running on, resolved once.
+ */
+CopyKernel bestCopyKernel();
+
+const char *copyKernelName(CopyKernel kernel);
+
+/**
+ * Copies `rows` rows of `rowBytes` bytes each honouring the stride (in bytes) of both sides,
+ * so that neither padding is copied nor rows are torn when strides differ.
+ */
+void copyPlane(const uint8_t *src, size_t srcStride,
+               uint8_t *dst, size_t dstStride,
+               size_t rowBytes, size_t rows);
+
+/**
+ * Same as above but with explicit kernel and store type, mostly needed for benchmarks.
+ * Falls back to plain memcpy if requested kernel is not compiled in.
+ */
+void copyPlane(CopyKernel kernel, bool nonTemporal,
+               const uint8_t *src, size_t srcStride,
+               uint8_t *dst, size_t dstStride,
+               size_t rowBytes, size_t rows);
+
+/**
+ * Splits the plane into `stripes` horizontal stripes copied in parallel on the pool, returns
+ * once the whole plane is copied. Store type is chosen based on the whole plane size.
+ */
+void copyPlaneStriped(WorkerPool &pool, size_t stripes,
+                      const uint8_t *src, size_t srcStride,
+                      uint8_t *dst, size_t dstStride,
+                      size_t rowBytes, size_t rows);
+
+/**
+ * Byte by byte reference implementation used to validate SIMD kernels.
+ */
+void copyPlaneScalar(const uint8_t *src, size_t srcStride,
+                     uint8_t *dst, size_t dstStride,
+                     size_t rowBytes, size_t rows);
+
+}  // namespace android
+}  // namespace engine
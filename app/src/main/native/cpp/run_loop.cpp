@@ -1,36 +1,85 @@
 #include "run_loop.hpp"
 
+#include "trace.hpp"
+
 #include <android/looper.h>
 #include <fcntl.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
 // STL
 #include <cassert>
+#include <cerrno>
 #include <memory>
+#include <stdexcept>
 
 namespace engine {
 namespace android {
 
 namespace internal {
 
-Pipe::Pipe() {
+WakeFd::WakeFd(Kind preferred) : kind_(preferred) {
+  if (kind_ == Kind::EventFd) {
+    const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd != -1) {
+      fds_[FD_READ] = fd;
+      fds_[FD_WRITE] = fd;
+      return;
+    }
+    kind_ = Kind::Pipe;
+  }
+
   if (pipe(fds_) != 0) {
     throw std::runtime_error("Failed to create pipe");
   }
 
-  if (fcntl(fds_[PIPE_OUT], F_SETFL, O_NONBLOCK)) {
+  if (fcntl(fds_[FD_READ], F_SETFL, O_NONBLOCK)) {
     closeFds();
     throw std::runtime_error("Failed to set pipe read end non-blocking.");
   }
 }
 
-Pipe::~Pipe() {
+WakeFd::~WakeFd() {
   closeFds();
 }
 
-void Pipe::closeFds() {
-  close(fds_[PIPE_IN]);
-  close(fds_[PIPE_OUT]);
+void WakeFd::closeFds() {
+  close(fds_[FD_READ]);
+  if (fds_[FD_WRITE] != fds_[FD_READ]) {
+    close(fds_[FD_WRITE]);
+  }
+}
+
+void WakeFd::signal() {
+  syscalls_.fetch_add(1, std::memory_order_relaxed);
+  if (kind_ == Kind::EventFd) {
+    const uint64_t value = 1;
+    if (write(fds_[FD_WRITE], &value, sizeof(value)) == -1 && errno != EAGAIN) {
+      throw std::runtime_error("Failed to write to eventfd.");
+    }
+  } else if (write(fds_[FD_WRITE], "\n", 1) == -1 && errno != EAGAIN) {
+    throw std::runtime_error("Failed to write to file descriptor.");
+  }
+}
+
+void WakeFd::drain() {
+  if (kind_ == Kind::EventFd) {
+    // a single read resets the counter however many signals were coalesced in it
+    uint64_t value;
+    ssize_t count;
+    do {
+      syscalls_.fetch_add(1, std::memory_order_relaxed);
+      count = read(fds_[FD_READ], &value, sizeof(value));
+    } while (count == -1 && errno == EINTR);
+    return;
+  }
+
+  char buffer[16];
+  ssize_t count;
+  do {
+    syscalls_.fetch_add(1, std::memory_order_relaxed);
+    count = read(fds_[FD_READ], buffer, sizeof(buffer));
+  } while (count == sizeof(buffer));
 }
 
 ALooperHolder::ALooperHolder(ALooper *alooper) : alooper_(alooper) {
@@ -44,14 +93,11 @@ ALooperHolder::~ALooperHolder() {
 
 }  // namespace internal
 
-RunLoop::RunLoop(ALooper *alooper) : alooper_(alooper) {
+RunLoop::RunLoop(ALooper *alooper, internal::WakeFd::Kind wakeKind)
+        : wakeFd_(wakeKind), alooper_(alooper) {
   int ret = ALooper_addFd(
-          alooper_.get(), pipe_.outFd(), ALOOPER_POLL_CALLBACK, ALOOPER_EVENT_INPUT,
-          [](int fd, int, void *data) -> int {
-            int buffer[1];
-            while (read(fd, buffer, sizeof(buffer)) > 0) {
-            }
-
+          alooper_.get(), wakeFd_.readFd(), ALOOPER_POLL_CALLBACK, ALOOPER_EVENT_INPUT,
+          [](int, int, void *data) -> int {
             // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
             auto loop = reinterpret_cast<RunLoop *>(data);
             return loop->looperCallback();
@@ -63,60 +109,74 @@ RunLoop::RunLoop(ALooper *alooper) : alooper_(alooper) {
 }
 
 int RunLoop::looperCallback() {
+  wakeFd_.drain();
   runTasks();
   return 1;
 }
 
 void RunLoop::runTasks() {
-  std::deque <std::unique_ptr<Task>> tasks{};
-
-  // collect ready to run tasks
-  {
-    std::lock_guard <std::mutex> lock(mutex_);
-
-    wakeCalled_.clear();
-
-    while (!tasks_.empty()) {
-      tasks.emplace_back(std::move(tasks_.front()));
-      tasks_.pop_front();
+  // cleared before draining: producer that still finds the flag set has pushed its task before
+  // this point so it is picked up below
+  wakeCalled_.clear();
+  batches_.fetch_add(1, std::memory_order_relaxed);
+
+  for (size_t count = 0; count < kMaxTasksPerBatch; ++count) {
+    auto node = tasks_.pop();
+    if (!node) {
+      return;
     }
+    TRACE_SCOPE("runLoopTask");
+    node->task();
   }
 
-  while (!tasks.empty()) {
-    auto task = std::move(tasks.front());
-    tasks.pop_front();
-    task->operator()();
+  // leftovers run on the next callback, after whatever else became ready on this looper
+  if (!tasks_.empty()) {
+    wake();
   }
 }
 
 void RunLoop::run() {
   int outFd, outEvents;
   char *outData = nullptr;
-  ALooper_pollAll(-1, &outFd, &outEvents, reinterpret_cast<void **>(&outData));
+  // not pollAll: it keeps polling after callbacks, so a stop wake reported in the same batch as
+  // one would be swallowed and run() never returned
+  while (!stopped_.load(std::memory_order_acquire)) {
+    ALooper_pollOnce(-1, &outFd, &outEvents, reinterpret_cast<void **>(&outData));
+  }
 }
 
 void RunLoop::stop() {
+  stopped_.store(true, std::memory_order_release);
   ALooper_wake(alooper_.get());
 }
 
 void RunLoop::wake() {
-  if (wakeCalled_.test_and_set(std::memory_order_acquire)) {
+  if (wakeCalled_.test_and_set()) {
     return;
   }
 
-  if (write(pipe_.inFd(), "\n", 1) == -1) {
-    throw std::runtime_error("Failed to write to file descriptor.");
-  }
+  wakes_.fetch_add(1, std::memory_order_relaxed);
+  wakeFd_.signal();
 }
 
 void RunLoop::schedule(std::unique_ptr <Task> task) {
   assert(task);
+  schedule(std::move(*task));
+}
 
-  {
-    std::lock_guard <std::mutex> lock(mutex_);
-    tasks_.emplace_back(std::move(task));
-    wake();
-  }
+void RunLoop::schedule(Task &&task) {
+  scheduled_.fetch_add(1, std::memory_order_relaxed);
+  tasks_.push(std::move(task));
+  wake();
+}
+
+RunLoop::Stats RunLoop::stats() const {
+  return Stats{
+          .scheduled = scheduled_.load(std::memory_order_relaxed),
+          .wakes = wakes_.load(std::memory_order_relaxed),
+          .batches = batches_.load(std::memory_order_relaxed),
+          .syscalls = wakeFd_.syscalls(),
+  };
 }
 
 }  // namespace android
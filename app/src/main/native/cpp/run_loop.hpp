@@ -1,10 +1,13 @@
 #pragma once
 
+#include "task_queue.hpp"
+
 // STL
-#include <deque>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
-#include <mutex>
 
 class ALooper;
 
@@ -13,22 +16,48 @@ namespace android {
 
 namespace internal {
 
-class Pipe {
+/**
+ * File descriptor ALooper watches to wake the loop up: a single eventfd when the kernel
+ * provides one, a non blocking pipe otherwise.
+ */
+class WakeFd {
 public:
-  Pipe();
+  enum class Kind {
+    EventFd,
+    Pipe,
+  };
+
+  explicit WakeFd(Kind preferred = Kind::EventFd);
+
+  WakeFd(WakeFd const &) = delete;
+
+  ~WakeFd();
+
+  Kind kind() const { return kind_; }
+
+  int readFd() const { return fds_[FD_READ]; }
 
-  ~Pipe();
+  /**
+   * Could be called from any thread.
+   */
+  void signal();
 
-  int inFd() const { return fds_[PIPE_IN]; }
+  /**
+   * Called from looper thread once the fd got readable.
+   */
+  void drain();
 
-  int outFd() const { return fds_[PIPE_OUT]; }
+  uint64_t syscalls() const { return syscalls_.load(std::memory_order_relaxed); }
 
 private:
   void closeFds();
 
-  const int PIPE_OUT = 0;
-  const int PIPE_IN = 1;
-  int fds_[2];
+  static constexpr int FD_READ = 0;
+  static constexpr int FD_WRITE = 1;
+  Kind kind_;
+  // eventfd is used for both ends
+  int fds_[2] = {-1, -1};
+  std::atomic<uint64_t> syscalls_{0};
 };
 
 class ALooperHolder {
@@ -49,16 +78,43 @@ class RunLoop {
 public:
   using Task = std::function<void()>;
 
-  explicit RunLoop(ALooper *);
+  struct Stats {
+    uint64_t scheduled = 0;
+    // wake ups actually signalled, the rest were coalesced
+    uint64_t wakes = 0;
+    // looper callbacks, more than wakes means a batch left tasks for the next one
+    uint64_t batches = 0;
+    uint64_t syscalls = 0;
+  };
+
+  /**
+   * Tasks run per looper callback, the rest wait for the next one so other fds of the same
+   * looper (Choreographer) are serviced in between.
+   */
+  static constexpr size_t kMaxTasksPerBatch = 32;
+
+  explicit RunLoop(ALooper *, internal::WakeFd::Kind wakeKind = internal::WakeFd::Kind::EventFd);
 
   ~RunLoop() = default;
 
   void run();
 
+  /**
+   * Makes run() return, also when the wake gets reported together with a task callback.
+   */
   void stop();
 
+  /**
+   * Could be called from any thread, lock free.
+   */
   void schedule(std::unique_ptr <Task> task);
 
+  void schedule(Task &&task);
+
+  internal::WakeFd::Kind wakeKind() const { return wakeFd_.kind(); }
+
+  Stats stats() const;
+
 private:
   int looperCallback();
 
@@ -66,11 +122,14 @@ private:
 
   void wake();
 
-  internal::Pipe pipe_;
+  internal::WakeFd wakeFd_;
   internal::ALooperHolder alooper_;
   std::atomic_flag wakeCalled_ = ATOMIC_FLAG_INIT;
-  std::mutex mutex_;
-  std::deque <std::unique_ptr<Task>> tasks_;
+  std::atomic<bool> stopped_{false};
+  TaskQueue tasks_;
+  std::atomic<uint64_t> scheduled_{0};
+  std::atomic<uint64_t> wakes_{0};
+  std::atomic<uint64_t> batches_{0};
 };
 
 }  // namespace android
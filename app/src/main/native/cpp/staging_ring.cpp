@@ -0,0 +1,165 @@
+#include "staging_ring.hpp"
+
+#include "util.hpp"
+
+namespace engine {
+namespace android {
+
+StagingRing::StagingRing(uint32_t slotCount) : slots(slotCount) {
+}
+
+StagingRing::~StagingRing() {
+  const auto s = stats();
+  LOGI("Staging ring destroyed: acquired=%llu, steals=%llu, exhausted=%llu, allocations=%llu",
+       static_cast<unsigned long long>(s.acquired),
+       static_cast<unsigned long long>(s.steals),
+       static_cast<unsigned long long>(s.exhausted),
+       static_cast<unsigned long long>(s.allocations));
+  for (auto &slot: slots) {
+    if (slot.buffer) {
+      AHardwareBuffer_release(slot.buffer);
+    }
+  }
+}
+
+StagingRing::Lease StagingRing::acquire(uint32_t width, uint32_t height, uint32_t format) {
+  std::lock_guard<std::mutex> lock(mutex);
+  int chosen = -1;
+  for (uint32_t i = 0; i < slots.size(); ++i) {
+    if (slots[i].state == SlotState::Free) {
+      chosen = static_cast<int>(i);
+      break;
+    }
+  }
+  if (chosen < 0) {
+    // renderer did not keep up - overwrite the oldest frame it has not picked up yet
+    for (uint32_t i = 0; i < slots.size(); ++i) {
+      if (slots[i].state == SlotState::Ready &&
+          (chosen < 0 || slots[i].publishSequence < slots[chosen].publishSequence)) {
+        chosen = static_cast<int>(i);
+      }
+    }
+    if (chosen < 0) {
+      ++counters.exhausted;
+      return {};
+    }
+    ++counters.steals;
+  }
+  auto &slot = slots[chosen];
+  // invalidates any lease handed out for the previous content of this slot
+  ++slot.generation;
+  if (!ensureAllocated(slot, width, height, format)) {
+    slot.state = SlotState::Free;
+    return {};
+  }
+  slot.state = SlotState::Writing;
+  ++counters.acquired;
+  return leaseFor(chosen);
+}
+
+void StagingRing::publish(const Lease &lease) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &slot = slots[lease.slot];
+  if (slot.generation == lease.generation && slot.state == SlotState::Writing) {
+    slot.state = SlotState::Ready;
+    slot.publishSequence = ++publishCounter;
+  }
+}
+
+void StagingRing::cancel(const Lease &lease) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &slot = slots[lease.slot];
+  if (slot.generation == lease.generation && slot.state == SlotState::Writing) {
+    slot.state = SlotState::Free;
+  }
+}
+
+bool StagingRing::consume(const Lease &lease) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &slot = slots[lease.slot];
+  if (slot.generation != lease.generation || slot.state != SlotState::Ready) {
+    return false;
+  }
+  slot.state = SlotState::InUse;
+  return true;
+}
+
+void StagingRing::release(const Lease &lease) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &slot = slots[lease.slot];
+  if (slot.generation == lease.generation &&
+      (slot.state == SlotState::InUse || slot.state == SlotState::Ready)) {
+    slot.state = SlotState::Free;
+  }
+}
+
+StagingRing::Stats StagingRing::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto result = counters;
+  for (const auto &slot: slots) {
+    switch (slot.state) {
+      case SlotState::Free:
+        ++result.free;
+        break;
+      case SlotState::Writing:
+        ++result.writing;
+        break;
+      case SlotState::Ready:
+        ++result.ready;
+        break;
+      case SlotState::InUse:
+        ++result.inUse;
+        break;
+    }
+  }
+  return result;
+}
+
+bool StagingRing::ensureAllocated(Slot &slot, uint32_t width, uint32_t height, uint32_t format) {
+  if (slot.buffer && slot.description.width == width && slot.description.height == height &&
+      slot.description.format == format) {
+    return true;
+  }
+  if (slot.buffer) {
+    // renderer keeps its own reference while the buffer is imported so releasing is safe here
+    AHardwareBuffer_release(slot.buffer);
+    slot.buffer = nullptr;
+  }
+  AHardwareBuffer_Desc description{
+          .width = width,
+          .height = height,
+          .layers = 1,
+          .format = format,
+          // read back by renderers which could not import it and upload it instead
+          .usage = AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE | AHARDWAREBUFFER_USAGE_GPU_FRAMEBUFFER |
+                   AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN | AHARDWAREBUFFER_USAGE_CPU_READ_RARELY,
+          .stride = 0,
+          .rfu0 = 0,
+          .rfu1 = 0,
+  };
+  const int res = AHardwareBuffer_allocate(&description, &slot.buffer);
+  if (res != 0) {
+    LOGE("Could not allocate staging buffer %ux%u, result: %d", width, height, res);
+    slot.buffer = nullptr;
+    return false;
+  }
+  // allocator is free to pick any stride so need to know the real one
+  AHardwareBuffer_describe(slot.buffer, &slot.description);
+  ++counters.allocations;
+  LOGI("Allocated staging buffer %ux%u (stride %u) for slot %u", width, height,
+       slot.description.stride, static_cast<uint32_t>(&slot - slots.data()));
+  return true;
+}
+
+StagingRing::Lease StagingRing::leaseFor(uint32_t index) {
+  const auto &slot = slots[index];
+  return Lease{
+          .buffer = slot.buffer,
+          .stride = slot.description.stride,
+          .slot = index,
+          .generation = slot.generation,
+  };
+}
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <android/hardware_buffer.h>
+
+// STL
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+/**
+ * Ring of GPU sampled hardware buffers camera frames are copied into when camera buffers
+ * could not be sampled directly. Camera thread always writes into a slot nobody reads from,
+ * render thread marks slots as in use while they are bound as a texture.
+ *
+ * Slot life cycle: Free -> Writing -> Ready -> InUse -> Free.
+ * When no slot is free the oldest Ready one (published but not picked up by renderer yet) is stolen.
+ */
+class StagingRing {
+public:
+  static constexpr uint32_t kDefaultSlotCount = 3;
+
+  enum class SlotState {
+    Free,
+    Writing,
+    Ready,
+    InUse,
+  };
+
+  struct Lease {
+    AHardwareBuffer *buffer = nullptr;
+    // in pixels, as reported by the allocator
+    uint32_t stride = 0;
+    uint32_t slot = 0;
+    uint64_t generation = 0;
+
+    explicit operator bool() const { return buffer != nullptr; }
+  };
+
+  struct Stats {
+    uint32_t free = 0;
+    uint32_t writing = 0;
+    uint32_t ready = 0;
+    uint32_t inUse = 0;
+    uint64_t acquired = 0;
+    uint64_t steals = 0;
+    uint64_t exhausted = 0;
+    uint64_t allocations = 0;
+  };
+
+  explicit StagingRing(uint32_t slotCount = kDefaultSlotCount);
+
+  StagingRing(StagingRing const &) = delete;
+
+  ~StagingRing();
+
+  /**
+   * Called from camera thread. Returns slot to write next frame into, (re)allocating its buffer
+   * lazily if camera resolution or format changed. Empty lease means every slot is being written
+   * or displayed and the frame has to be dropped.
+   */
+  Lease acquire(uint32_t width, uint32_t height, uint32_t format);
+
+  /**
+   * Writing -> Ready, frame could be handed to renderer.
+   */
+  void publish(const Lease &lease);
+
+  /**
+   * Writing -> Free, e.g. when camera buffer could not be locked.
+   */
+  void cancel(const Lease &lease);
+
+  /**
+   * Called from render thread right before import, Ready -> InUse.
+   * Returns false if the slot has been stolen in the meantime.
+   */
+  bool consume(const Lease &lease);
+
+  /**
+   * Called from render thread once the slot is not displayed anymore, InUse -> Free.
+   * No-op for leases whose slot has been stolen.
+   */
+  void release(const Lease &lease);
+
+  Stats stats() const;
+
+private:
+  struct Slot {
+    AHardwareBuffer *buffer = nullptr;
+    AHardwareBuffer_Desc description{};
+    SlotState state = SlotState::Free;
+    uint64_t generation = 0;
+    // order of publishing, used to find oldest Ready slot
+    uint64_t publishSequence = 0;
+  };
+
+  bool ensureAllocated(Slot &slot, uint32_t width, uint32_t height, uint32_t format);
+
+  Lease leaseFor(uint32_t index);
+
+  mutable std::mutex mutex;
+  std::vector<Slot> slots;
+  uint64_t publishCounter = 0;
+  Stats counters;
+};
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,81 @@
+#include "task_queue.hpp"
+
+// STL
+#include <cassert>
+#include <thread>
+
+namespace engine {
+namespace android {
+
+TaskQueue::TaskQueue() : head_(&stub_), tail_(&stub_) {}
+
+TaskQueue::~TaskQueue() {
+  while (pop()) {
+  }
+}
+
+void TaskQueue::push(std::unique_ptr<Node> node) {
+  assert(node);
+  node->next.store(nullptr, std::memory_order_relaxed);
+  pushNode(node.release());
+}
+
+void TaskQueue::push(Task &&task) {
+  auto node = std::make_unique<Node>();
+  node->task = std::move(task);
+  pushNode(node.release());
+}
+
+void TaskQueue::pushNode(Node *node) {
+  // seq_cst so that a consumer which cleared its wake flag afterwards sees this node,
+  // RunLoop relies on it to coalesce wakes
+  Node *previous = head_.exchange(node);
+  previous->next.store(node, std::memory_order_release);
+}
+
+TaskQueue::Node *TaskQueue::waitNext(Node *node) {
+  Node *next;
+  while (!(next = node->next.load(std::memory_order_acquire))) {
+    // producer got preempted between exchange and link, it is a few instructions away
+    std::this_thread::yield();
+  }
+  return next;
+}
+
+std::unique_ptr<TaskQueue::Node> TaskQueue::pop() {
+  Node *tail = tail_;
+  Node *next = tail->next.load(std::memory_order_acquire);
+  if (tail == &stub_) {
+    if (!next) {
+      if (head_.load() == &stub_) {
+        return nullptr;
+      }
+      next = waitNext(tail);
+    }
+    tail_ = next;
+    tail = next;
+    next = tail->next.load(std::memory_order_acquire);
+  }
+  if (next) {
+    tail_ = next;
+    return std::unique_ptr<Node>(tail);
+  }
+  if (tail != head_.load()) {
+    tail_ = waitNext(tail);
+    return std::unique_ptr<Node>(tail);
+  }
+  // tail is the only node left, put stub behind it so it could be handed out
+  stub_.next.store(nullptr, std::memory_order_relaxed);
+  pushNode(&stub_);
+  tail_ = waitNext(tail);
+  return std::unique_ptr<Node>(tail);
+}
+
+bool TaskQueue::empty() const {
+  // tail_ is the next node to hand out unless it is the stub, and nothing was pushed after the
+  // stub while head_ still points to it
+  return tail_ == &stub_ && head_.load() == &stub_;
+}
+
+}  // namespace android
+}  // namespace engine
@@ -0,0 +1,65 @@
+#pragma once
+
+// STL
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace engine {
+namespace android {
+
+/**
+ * Unbounded lock free multi producer single consumer queue of tasks (Vyukov's intrusive MPSC).
+ * Producers only do one exchange and one store, consumer never blocks producers.
+ *
+ * Push is not atomic as a whole: between the exchange and linking the node queue looks empty
+ * after the node it is appended to. pop() spins over that short window instead of reporting an
+ * empty queue so a wake skipped by the producer can not lose a task.
+ */
+class TaskQueue {
+public:
+  using Task = std::function<void()>;
+
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    Task task;
+  };
+
+  TaskQueue();
+
+  TaskQueue(TaskQueue const &) = delete;
+
+  ~TaskQueue();
+
+  /**
+   * Could be called from any thread.
+   */
+  void push(std::unique_ptr<Node> node);
+
+  void push(Task &&task);
+
+  /**
+   * Must be called from the consumer thread only. Returns nullptr once the queue is empty.
+   */
+  std::unique_ptr<Node> pop();
+
+  /**
+   * Must be called from the consumer thread only. A push still in flight counts as not empty.
+   */
+  bool empty() const;
+
+private:
+  void pushNode(Node *node);
+
+  Node *waitNext(Node *node);
+
+  // last pushed node, shared by producers
+  alignas(64) std::atomic<Node *> head_;
+  // next node to pop, consumer only
+  alignas(64) Node *tail_;
+  // keeps the list non empty so push never has to touch tail_
+  Node stub_;
+};
+
+}  // namespace android
+}  // namespace engine
@@ -0,0 +1,211 @@
+#include "trace.hpp"
+
+#include "file_util.hpp"
+#include "latency_tracker.hpp"
+#include "util.hpp"
+
+#include <dlfcn.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+namespace {
+
+#if defined(__ANDROID__)
+
+/**
+ * ATrace lives in libandroid since API 23, resolved at runtime so the library still loads
+ * on devices / NDK versions where the symbols are missing.
+ */
+struct ATraceFunctions {
+  using IsEnabled = bool (*)();
+  using BeginSection = void (*)(const char *);
+  using EndSection = void (*)();
+
+  IsEnabled isEnabled = nullptr;
+  BeginSection beginSection = nullptr;
+  EndSection endSection = nullptr;
+
+  ATraceFunctions() {
+    void *libandroid = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+    if (!libandroid) {
+      LOGW("libandroid.so could not be opened, trace sections are disabled");
+      return;
+    }
+    isEnabled = reinterpret_cast<IsEnabled>(dlsym(libandroid, "ATrace_isEnabled"));
+    beginSection = reinterpret_cast<BeginSection>(dlsym(libandroid, "ATrace_beginSection"));
+    endSection = reinterpret_cast<EndSection>(dlsym(libandroid, "ATrace_endSection"));
+    if (!isEnabled || !beginSection || !endSection) {
+      LOGW("ATrace is not available, trace sections are disabled");
+      isEnabled = nullptr;
+    }
+  }
+};
+
+const ATraceFunctions &atrace() {
+  static const ATraceFunctions functions;
+  return functions;
+}
+
+#else
+
+struct Section {
+  const char *name;
+  uint32_t threadId;
+  int64_t beginNanos;
+  int64_t endNanos;
+};
+
+/**
+ * Sections are recorded once complete, so a single ring of complete events is enough
+ * and export never sees unbalanced begin / end pairs.
+ */
+struct SectionRing {
+  std::mutex mutex;
+  std::vector<Section> sections;
+  size_t next = 0;
+};
+
+std::atomic<bool> recording{false};
+
+SectionRing &sectionRing() {
+  static SectionRing ring;
+  return ring;
+}
+
+uint32_t currentThreadId() {
+  thread_local const auto threadId = static_cast<uint32_t>(syscall(SYS_gettid));
+  return threadId;
+}
+
+void appendJsonString(std::string &json, const char *value) {
+  json += '"';
+  for (const char *c = value; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      json += '\\';
+    }
+    json += *c;
+  }
+  json += '"';
+}
+
+#endif
+
+} // namespace
+
+#if defined(__ANDROID__)
+
+bool Trace::enabled() {
+  const auto &functions = atrace();
+  return functions.isEnabled && functions.isEnabled();
+}
+
+void Trace::setRecording(bool) {
+}
+
+std::string Trace::chromeTraceJson() {
+  return "{\"traceEvents\":[]}";
+}
+
+bool Trace::exportChromeTrace(const std::string &) {
+  LOGW("Chrome trace export is host only, use Perfetto on device");
+  return false;
+}
+
+void Trace::clear() {
+}
+
+int64_t Trace::begin(const char *name) {
+  atrace().beginSection(name);
+  return 0;
+}
+
+void Trace::end(const char *, int64_t) {
+  atrace().endSection();
+}
+
+#else
+
+bool Trace::enabled() {
+  return recording.load(std::memory_order_relaxed);
+}
+
+void Trace::setRecording(bool value) {
+  recording.store(value, std::memory_order_relaxed);
+}
+
+std::string Trace::chromeTraceJson() {
+  std::vector<Section> sections;
+  {
+    auto &ring = sectionRing();
+    std::lock_guard<std::mutex> lock(ring.mutex);
+    sections = ring.sections;
+  }
+  std::sort(sections.begin(), sections.end(), [](const Section &lhs, const Section &rhs) {
+    return lhs.beginNanos < rhs.beginNanos;
+  });
+  const auto pid = static_cast<long>(getpid());
+  std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  char fields[128];
+  for (size_t i = 0; i < sections.size(); ++i) {
+    const auto &section = sections[i];
+    json += i == 0 ? "{\"name\":" : ",\n{\"name\":";
+    appendJsonString(json, section.name);
+    // microseconds with fractions, viewers keep sub-microsecond sections visible that way
+    snprintf(fields, sizeof(fields),
+             ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%u}",
+             static_cast<double>(section.beginNanos) / 1000.0,
+             static_cast<double>(section.endNanos - section.beginNanos) / 1000.0,
+             pid, section.threadId);
+    json += fields;
+  }
+  json += "]}\n";
+  return json;
+}
+
+bool Trace::exportChromeTrace(const std::string &path) {
+  const auto json = chromeTraceJson();
+  return writeFileAtomically(path, std::vector<uint8_t>(json.begin(), json.end()));
+}
+
+void Trace::clear() {
+  auto &ring = sectionRing();
+  std::lock_guard<std::mutex> lock(ring.mutex);
+  ring.sections.clear();
+  ring.next = 0;
+}
+
+int64_t Trace::begin(const char *) {
+  return latencyClockNanos();
+}
+
+void Trace::end(const char *name, int64_t beginNanos) {
+  const Section section{
+          .name = name,
+          .threadId = currentThreadId(),
+          .beginNanos = beginNanos,
+          .endNanos = latencyClockNanos(),
+  };
+  auto &ring = sectionRing();
+  std::lock_guard<std::mutex> lock(ring.mutex);
+  if (ring.sections.size() < kRingSize) {
+    ring.sections.push_back(section);
+  } else {
+    ring.sections[ring.next] = section;
+  }
+  ring.next = (ring.next + 1) % kRingSize;
+}
+
+#endif
+
+} // namespace android
+} // namespace engine
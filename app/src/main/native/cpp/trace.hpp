@@ -0,0 +1,88 @@
+#pragma once
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace engine {
+namespace android {
+
+/**
+ * Pipeline stage markers. On device sections go to ATrace and show up in Perfetto / systrace
+ * once the app is traced, on host builds they are recorded into an in-memory ring which
+ * could be exported as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * Section names must be string literals, host ring keeps only the pointers.
+ */
+class Trace {
+public:
+  static constexpr size_t kRingSize = 1 << 16;
+
+  /**
+   * Cheap enough to be checked per section: device asks ATrace, host checks recording flag.
+   */
+  static bool enabled();
+
+  /**
+   * Host only, sections are not recorded until enabled. No-op on device where tracing is
+   * controlled by the system.
+   */
+  static void setRecording(bool recording);
+
+  /**
+   * Host recorded sections as Chrome trace event JSON, oldest first.
+   */
+  static std::string chromeTraceJson();
+
+  static bool exportChromeTrace(const std::string &path);
+
+  /**
+   * Drops host recorded sections.
+   */
+  static void clear();
+
+private:
+  friend class ScopedTrace;
+
+  /**
+   * Returns begin timestamp the host needs to record the complete section on end.
+   */
+  static int64_t begin(const char *name);
+
+  static void end(const char *name, int64_t beginNanos);
+};
+
+/**
+ * Traces the enclosing scope, see TRACE_SCOPE.
+ */
+class ScopedTrace {
+public:
+  explicit ScopedTrace(const char *name) : name(Trace::enabled() ? name : nullptr) {
+    if (this->name) {
+      beginNanos = Trace::begin(this->name);
+    }
+  }
+
+  ScopedTrace(const ScopedTrace &) = delete;
+
+  ScopedTrace &operator=(const ScopedTrace &) = delete;
+
+  ~ScopedTrace() {
+    // tracing could have been switched on or off meanwhile, sections stay balanced anyway
+    if (name) {
+      Trace::end(name, beginNanos);
+    }
+  }
+
+private:
+  const char *name;
+  int64_t beginNanos = 0;
+};
+
+} // namespace android
+} // namespace engine
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) ::engine::android::ScopedTrace TRACE_CONCAT(traceScope, __LINE__)(name)
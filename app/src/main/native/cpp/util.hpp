@@ -3,9 +3,41 @@
 #include <android/log.h>
 
 #define METHOD(MethodPtr, name) jni::MakeNativePeerMethod<decltype(MethodPtr), (MethodPtr)>(name)
+
+// Compile-time log level filter, matches android_LogPriority values.
+// Calls below ENGINE_LOG_LEVEL are compiled out together with their arguments.
+#define ENGINE_LOG_LEVEL_VERBOSE 2
+#define ENGINE_LOG_LEVEL_DEBUG 3
+#define ENGINE_LOG_LEVEL_INFO 4
+#define ENGINE_LOG_LEVEL_WARN 5
+#define ENGINE_LOG_LEVEL_ERROR 6
+#ifndef ENGINE_LOG_LEVEL
+#define ENGINE_LOG_LEVEL ENGINE_LOG_LEVEL_INFO
+#endif
+// Arguments of a filtered call still count as used and are type checked, no code is generated.
+#define ENGINE_LOG_DISABLED(priority, ...) \
+  do { if (0) __android_log_print(priority, "DzCoreNative", __VA_ARGS__); } while (0)
+
+#if ENGINE_LOG_LEVEL <= ENGINE_LOG_LEVEL_ERROR
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR,"DzCoreNative",__VA_ARGS__)
+#else
+#define LOGE(...) ENGINE_LOG_DISABLED(ANDROID_LOG_ERROR, __VA_ARGS__)
+#endif
+#if ENGINE_LOG_LEVEL <= ENGINE_LOG_LEVEL_WARN
 #define LOGW(...) __android_log_print(ANDROID_LOG_WARN,"DzCoreNative",__VA_ARGS__)
+#else
+#define LOGW(...) ENGINE_LOG_DISABLED(ANDROID_LOG_WARN, __VA_ARGS__)
+#endif
+#if ENGINE_LOG_LEVEL <= ENGINE_LOG_LEVEL_INFO
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO,"DzCoreNative",__VA_ARGS__)
+#else
+#define LOGI(...) ENGINE_LOG_DISABLED(ANDROID_LOG_INFO, __VA_ARGS__)
+#endif
+#if ENGINE_LOG_LEVEL <= ENGINE_LOG_LEVEL_DEBUG
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG,"DzCoreNative",__VA_ARGS__)
+#else
+#define LOGD(...) ENGINE_LOG_DISABLED(ANDROID_LOG_DEBUG, __VA_ARGS__)
+#endif
 
 
 // Vulkan call wrapper
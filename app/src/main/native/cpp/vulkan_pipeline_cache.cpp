@@ -0,0 +1,93 @@
+#include "vulkan_pipeline_cache.hpp"
+
+#include "file_util.hpp"
+#include "util.hpp"
+
+// STL
+#include <cassert>
+#include <cstring>
+
+namespace engine {
+namespace android {
+
+VulkanPipelineCache::~VulkanPipelineCache() {
+  waitForSave();
+  assert(cache == VK_NULL_HANDLE);
+}
+
+void VulkanPipelineCache::create(VkDevice vkDevice, const VkPhysicalDeviceProperties &properties,
+                                 const std::string &directory) {
+  assert(cache == VK_NULL_HANDLE);
+  device = vkDevice;
+  path = directory.empty() ? std::string() : directory + "/" + kFileName;
+  loaded = false;
+  saved = false;
+  std::vector<uint8_t> data;
+  if (!path.empty() && readFile(path, data)) {
+    loaded = isCompatible(data, properties);
+    if (!loaded) {
+      LOGW("Pipeline cache %s was written by another driver or device, ignored", path.c_str());
+      data.clear();
+    }
+  }
+  VkPipelineCacheCreateInfo pipelineCacheInfo{
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,  // reserved, must be 0
+          .initialDataSize = data.size(),
+          .pInitialData = data.empty() ? nullptr : data.data(),
+  };
+  CALL_VK(vkCreatePipelineCache(device, &pipelineCacheInfo, nullptr, &cache))
+  LOGI("Pipeline cache created, %zu bytes loaded", data.size());
+}
+
+void VulkanPipelineCache::destroy() {
+  // data was copied out already, only file IO may still be running
+  waitForSave();
+  if (cache != VK_NULL_HANDLE) {
+    vkDestroyPipelineCache(device, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+  }
+}
+
+void VulkanPipelineCache::saveAsync() {
+  if (saved || path.empty() || cache == VK_NULL_HANDLE) {
+    return;
+  }
+  saved = true;
+  size_t size = 0;
+  CALL_VK(vkGetPipelineCacheData(device, cache, &size, nullptr))
+  std::vector<uint8_t> data(size);
+  CALL_VK(vkGetPipelineCacheData(device, cache, &size, data.data()))
+  data.resize(size);
+  waitForSave();
+  pendingSave = std::async(std::launch::async, [path = path, data = std::move(data)] {
+    if (writeFileAtomically(path, data)) {
+      LOGI("Pipeline cache saved to %s, %zu bytes", path.c_str(), data.size());
+    }
+  });
+}
+
+void VulkanPipelineCache::waitForSave() {
+  if (pendingSave.valid()) {
+    pendingSave.get();
+  }
+}
+
+bool VulkanPipelineCache::isCompatible(const std::vector<uint8_t> &data,
+                                       const VkPhysicalDeviceProperties &properties) {
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(header)
+         && header.headerSize <= data.size()
+         && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+         && header.vendorID == properties.vendorID
+         && header.deviceID == properties.deviceID
+         && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "vulkan_wrapper.h"
+
+// STL
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+/**
+ * VkPipelineCache persisted in an app provided directory, so pipelines are not compiled from
+ * scratch on every start. Data left by another driver or device is ignored.
+ *
+ * Must be used from render thread only, file is written on a background thread.
+ */
+class VulkanPipelineCache {
+public:
+  static constexpr const char *kFileName = "vk_pipeline_cache.bin";
+
+  VulkanPipelineCache() = default;
+
+  VulkanPipelineCache(VulkanPipelineCache const &) = delete;
+
+  ~VulkanPipelineCache();
+
+  /**
+   * Creates the cache, seeded from the directory if it holds compatible data.
+   * Empty directory keeps the cache in memory only.
+   */
+  void create(VkDevice device, const VkPhysicalDeviceProperties &properties,
+              const std::string &directory);
+
+  void destroy();
+
+  VkPipelineCache get() const { return cache; }
+
+  /**
+   * True if the cache was seeded from disk.
+   */
+  bool warm() const { return loaded; }
+
+  /**
+   * Snapshots cache data and writes it in the background, only the first call after create() does anything.
+   */
+  void saveAsync();
+
+  static bool isCompatible(const std::vector<uint8_t> &data,
+                           const VkPhysicalDeviceProperties &properties);
+
+private:
+  void waitForSave();
+
+  VkDevice device = VK_NULL_HANDLE;
+  VkPipelineCache cache = VK_NULL_HANDLE;
+  std::string path;
+  bool loaded = false;
+  bool saved = false;
+  std::future<void> pendingSave;
+};
+
+} // namespace android
+} // namespace engine
@@ -1,14 +1,19 @@
 #include "vulkan_renderer.hpp"
 
+#include <shaders/camera_frag.h>
+#include <shaders/camera_vert.h>
+
+// STL
+#include <algorithm>
+#include <cstring>
+
 namespace engine {
 namespace android {
 
 
 void VulkanRenderer::doFrame(long timeStampNanos, void *data) {
   auto *renderer = reinterpret_cast<engine::android::VulkanRenderer *>(data);
-  if (renderer->couldRender()) {
-    renderer->render();
-  }
+  renderer->onVsync(timeStampNanos);
 }
 
 void VulkanRenderer::createRenderPass() {
@@ -20,7 +25,8 @@ void VulkanRenderer::createRenderPass() {
           .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
           .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
           .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-          .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+          // offscreen image is left ready to be copied out
+          .finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
   };
 
   VkAttachmentReference colorReference = {
@@ -57,10 +63,12 @@ void VulkanRenderer::createVulkanDevice(VkApplicationInfo *appInfo) {
   std::vector<const char *> device_extensions;
   std::vector<const char *> validation_layers;
 
-  instance_extensions.push_back("VK_KHR_surface");
-  instance_extensions.push_back("VK_KHR_android_surface");
+  if (!headless) {
+    instance_extensions.push_back("VK_KHR_surface");
+    instance_extensions.push_back("VK_KHR_android_surface");
 
-  device_extensions.push_back("VK_KHR_swapchain");
+    device_extensions.push_back("VK_KHR_swapchain");
+  }
   device_extensions.push_back("VK_ANDROID_external_memory_android_hardware_buffer");
   device_extensions.push_back("VK_EXT_queue_family_foreign");
 
@@ -80,14 +88,17 @@ void VulkanRenderer::createVulkanDevice(VkApplicationInfo *appInfo) {
           .ppEnabledExtensionNames = instance_extensions.data(),
   };
   CALL_VK(vkCreateInstance(&instanceCreateInfo, nullptr, &deviceInfo.instance))
-  VkAndroidSurfaceCreateInfoKHR createInfo{
-          .sType = VK_STRUCTURE_TYPE_ANDROID_SURFACE_CREATE_INFO_KHR,
-          .pNext = nullptr,
-          .flags = 0,
-          .window = aNativeWindow
-  };
+  deviceInfo.surface = VK_NULL_HANDLE;
+  if (!headless) {
+    VkAndroidSurfaceCreateInfoKHR createInfo{
+            .sType = VK_STRUCTURE_TYPE_ANDROID_SURFACE_CREATE_INFO_KHR,
+            .pNext = nullptr,
+            .flags = 0,
+            .window = aNativeWindow
+    };
 
-  CALL_VK(vkCreateAndroidSurfaceKHR(deviceInfo.instance, &createInfo, nullptr, &deviceInfo.surface))
+    CALL_VK(vkCreateAndroidSurfaceKHR(deviceInfo.instance, &createInfo, nullptr, &deviceInfo.surface))
+  }
   // Find one GPU to use:
   // On Android, every GPU device is equal -- supporting
   // graphics/compute/present
@@ -129,9 +140,28 @@ void VulkanRenderer::createVulkanDevice(VkApplicationInfo *appInfo) {
           .pQueuePriorities = priorities,
   };
 
+  // Camera2 PRIVATE buffers are YUV with vendor specific layout and could only be sampled
+  // through an immutable sampler with VkSamplerYcbcrConversion (core since 1.1, optional feature)
+  VkPhysicalDeviceSamplerYcbcrConversionFeatures ycbcrFeatures{
+          .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SAMPLER_YCBCR_CONVERSION_FEATURES,
+          .pNext = nullptr,
+          .samplerYcbcrConversion = VK_FALSE,
+  };
+  VkPhysicalDeviceFeatures2 features{
+          .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+          .pNext = &ycbcrFeatures,
+  };
+  auto vkGetPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2) vkGetInstanceProcAddr(
+          deviceInfo.instance, "vkGetPhysicalDeviceFeatures2");
+  if (vkGetPhysicalDeviceFeatures2) {
+    vkGetPhysicalDeviceFeatures2(deviceInfo.gpuDevice, &features);
+  }
+  deviceInfo.ycbcrConversionSupported = ycbcrFeatures.samplerYcbcrConversion == VK_TRUE;
+  LOGI("Sampler YCbCr conversion supported: %d", deviceInfo.ycbcrConversionSupported);
+
   VkDeviceCreateInfo deviceCreateInfo{
           .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-          .pNext = nullptr,
+          .pNext = deviceInfo.ycbcrConversionSupported ? &ycbcrFeatures : nullptr,
           .queueCreateInfoCount = 1,
           .pQueueCreateInfos = &queueCreateInfo,
           .enabledLayerCount = 0,
@@ -144,10 +174,35 @@ void VulkanRenderer::createVulkanDevice(VkApplicationInfo *appInfo) {
   CALL_VK(vkCreateDevice(deviceInfo.gpuDevice, &deviceCreateInfo, nullptr,
                          &deviceInfo.device))
   vkGetDeviceQueue(deviceInfo.device, 0, 0, &deviceInfo.queue);
+  // device level entry points belong to this device, resolved again for every new one
+  deviceInfo.createSamplerYcbcrConversion = nullptr;
+  deviceInfo.destroySamplerYcbcrConversion = nullptr;
+  if (deviceInfo.ycbcrConversionSupported) {
+    deviceInfo.createSamplerYcbcrConversion =
+            (PFN_vkCreateSamplerYcbcrConversion) vkGetDeviceProcAddr(
+                    deviceInfo.device, "vkCreateSamplerYcbcrConversion");
+    deviceInfo.destroySamplerYcbcrConversion =
+            (PFN_vkDestroySamplerYcbcrConversion) vkGetDeviceProcAddr(
+                    deviceInfo.device, "vkDestroySamplerYcbcrConversion");
+    deviceInfo.ycbcrConversionSupported = deviceInfo.createSamplerYcbcrConversion
+            && deviceInfo.destroySamplerYcbcrConversion;
+  }
 }
 
 void VulkanRenderer::createSwapChain(uint32_t width, uint32_t height) {
   LOGI("->createSwapChain");
+  if (headless) {
+    // nothing to present to, images are created together with framebuffers
+    swapchainInfo.swapchain = VK_NULL_HANDLE;
+    swapchainInfo.displaySize = VkExtent2D{
+            .width = width ? width : static_cast<uint32_t>(viewportWidth),
+            .height = height ? height : static_cast<uint32_t>(viewportHeight),
+    };
+    swapchainInfo.displayFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    LOGI("<-createSwapChain, headless w=%u, h=%u", swapchainInfo.displaySize.width,
+         swapchainInfo.displaySize.height);
+    return;
+  }
   // **********************************************************
   // Get the surface capabilities because:
   //   - It contains the minimal and max length of the chain, we will need it
@@ -181,6 +236,8 @@ void VulkanRenderer::createSwapChain(uint32_t width, uint32_t height) {
   LOGI("Display size w=%i, h=%i", swapchainInfo.displaySize.width,
        swapchainInfo.displaySize.height);
   swapchainInfo.displayFormat = formats[chosenFormat].format;
+  swapchainReadable =
+          (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
 
   // **********************************************************
   // Create a swap chain (here we choose the minimum available number of surface
@@ -194,7 +251,8 @@ void VulkanRenderer::createSwapChain(uint32_t width, uint32_t height) {
           .imageColorSpace = formats[chosenFormat].colorSpace,
           .imageExtent = swapchainInfo.displaySize,
           .imageArrayLayers = 1,
-          .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+          .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                        (swapchainReadable ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0u),
           .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
           .queueFamilyIndexCount = 1,
           .pQueueFamilyIndices = &deviceInfo.queueFamilyIndex,
@@ -213,14 +271,24 @@ void VulkanRenderer::createSwapChain(uint32_t width, uint32_t height) {
 
 void VulkanRenderer::createFrameBuffersAndImages() {
   LOGI("->createFrameBuffers");
-  // Get the length of the created swap chain
-  CALL_VK(vkGetSwapchainImagesKHR(deviceInfo.device, swapchainInfo.swapchain,
-                                  &swapchainInfo.swapchainLength, nullptr))
+  if (headless) {
+    // one image per frame in flight, so the frame fence also guards its image
+    swapchainInfo.swapchainLength = framesInFlight;
+    swapchainInfo.displayImages = new VkImage[swapchainInfo.swapchainLength];
+    swapchainInfo.displayMemory = new VkDeviceMemory[swapchainInfo.swapchainLength];
+    for (uint32_t i = 0; i < swapchainInfo.swapchainLength; i++) {
+      createOffscreenImage(swapchainInfo.displayImages[i], swapchainInfo.displayMemory[i]);
+    }
+  } else {
+    // Get the length of the created swap chain
+    CALL_VK(vkGetSwapchainImagesKHR(deviceInfo.device, swapchainInfo.swapchain,
+                                    &swapchainInfo.swapchainLength, nullptr))
+    swapchainInfo.displayImages = new VkImage[swapchainInfo.swapchainLength];
+    CALL_VK(vkGetSwapchainImagesKHR(deviceInfo.device, swapchainInfo.swapchain,
+                                    &swapchainInfo.swapchainLength,
+                                    swapchainInfo.displayImages))
+  }
   assert(swapchainInfo.swapchainLength > 1);
-  swapchainInfo.displayImages = new VkImage[swapchainInfo.swapchainLength];
-  CALL_VK(vkGetSwapchainImagesKHR(deviceInfo.device, swapchainInfo.swapchain,
-                                  &swapchainInfo.swapchainLength,
-                                  swapchainInfo.displayImages))
   // create image view for each swapchain image
   swapchainInfo.displayViews = new VkImageView[swapchainInfo.swapchainLength];
   for (uint32_t i = 0; i < swapchainInfo.swapchainLength; i++) {
@@ -273,62 +341,80 @@ void VulkanRenderer::createFrameBuffersAndImages() {
     CALL_VK(vkCreateFramebuffer(deviceInfo.device, &fbCreateInfo, nullptr,
                                 &swapchainInfo.framebuffers[i]))
   }
+  // command buffers reference framebuffers, record them again on next render
+  invalidateCommandBuffers();
+  renderInfo.imagesInFlight.assign(swapchainInfo.swapchainLength, VK_NULL_HANDLE);
   LOGI("<-createFrameBuffers");
 }
 
-void VulkanRenderer::createUniformBuffer() {
-  createBuffer(
-          sizeof(UniformBufferObject),
-          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-          buffersInfo.uniformBuf,
-          buffersInfo.uniformBufferMemory
-  );
-  CALL_VK(vkMapMemory(
-          deviceInfo.device,
-          buffersInfo.uniformBufferMemory,
-          0,
-          sizeof(UniformBufferObject),
-          0,
-          &buffersInfo.uniformBufferMapped)
-  )
+void VulkanRenderer::createOffscreenImage(VkImage &image, VkDeviceMemory &memory) {
+  const VkImageCreateInfo imageCreateInfo{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .imageType = VK_IMAGE_TYPE_2D,
+          .format = swapchainInfo.displayFormat,
+          .extent = {
+                  .width = swapchainInfo.displaySize.width,
+                  .height = swapchainInfo.displaySize.height,
+                  .depth = 1,
+          },
+          .mipLevels = 1,
+          .arrayLayers = 1,
+          .samples = VK_SAMPLE_COUNT_1_BIT,
+          .tiling = VK_IMAGE_TILING_OPTIMAL,
+          .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+          .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+          .queueFamilyIndexCount = 1,
+          .pQueueFamilyIndices = &deviceInfo.queueFamilyIndex,
+          .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+  CALL_VK(vkCreateImage(deviceInfo.device, &imageCreateInfo, nullptr, &image))
+  VkMemoryRequirements memoryRequirements;
+  vkGetImageMemoryRequirements(deviceInfo.device, image, &memoryRequirements);
+  VkMemoryAllocateInfo allocateInfo{
+          .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+          .pNext = nullptr,
+          .allocationSize = memoryRequirements.size,
+          .memoryTypeIndex = 0,
+  };
+  mapMemoryTypeToIndex(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                       &allocateInfo.memoryTypeIndex);
+  CALL_VK(vkAllocateMemory(deviceInfo.device, &allocateInfo, nullptr, &memory))
+  CALL_VK(vkBindImageMemory(deviceInfo.device, image, memory, 0))
 }
 
 void VulkanRenderer::createGraphicsPipeline() {
   LOGI("->createGraphicsPipeline");
-  const VkDescriptorSetLayoutBinding uboLayoutBinding = {
-          .binding = 0,
-          .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-          .descriptorCount = 1,
-          .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-          .pImmutableSamplers = nullptr,
-  };
   const VkDescriptorSetLayoutBinding imageLayoutBinding{
           .binding = 1,
           .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
           .descriptorCount = 1,
           .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-          .pImmutableSamplers = nullptr,
+          // sampler with YCbCr conversion must be immutable, so layout and pipeline depend on it
+          .pImmutableSamplers = ycbcrInfo.sampler != VK_NULL_HANDLE ? &ycbcrInfo.sampler : nullptr,
   };
-  const auto bindings = new VkDescriptorSetLayoutBinding[2];
-  bindings[0] = uboLayoutBinding;
-  bindings[1] = imageLayoutBinding;
   const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {
           .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-          .bindingCount = 2,
-          .pBindings = bindings,
+          .bindingCount = 1,
+          .pBindings = &imageLayoutBinding,
   };
   CALL_VK(vkCreateDescriptorSetLayout(deviceInfo.device,
                                       &descriptorSetLayoutCreateInfo, nullptr,
                                       &gfxPipelineInfo.dscLayout))
-  delete[] bindings;
+  // MVP travels as a push constant, no uniform buffer shared between frames in flight
+  const VkPushConstantRange pushConstantRange = {
+          .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+          .offset = 0,
+          .size = sizeof(PushConstants),
+  };
   VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
           .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
           .pNext = nullptr,
           .setLayoutCount = 1,
           .pSetLayouts = &gfxPipelineInfo.dscLayout,
-          .pushConstantRangeCount = 0,
-          .pPushConstantRanges = nullptr,
+          .pushConstantRangeCount = 1,
+          .pPushConstantRanges = &pushConstantRange,
   };
   CALL_VK(vkCreatePipelineLayout(deviceInfo.device, &pipelineLayoutCreateInfo, nullptr,
                                  &gfxPipelineInfo.layout))
@@ -344,14 +430,7 @@ void VulkanRenderer::createGraphicsPipeline() {
   };
 
   VkShaderModule vertexShader, fragmentShader;
-  buildShaderFromFile(vertexShaderSource,
-                      VK_SHADER_STAGE_VERTEX_BIT,
-                      deviceInfo.device,
-                      &vertexShader);
-  buildShaderFromFile(fragmentShaderSource,
-                      VK_SHADER_STAGE_FRAGMENT_BIT,
-                      deviceInfo.device,
-                      &fragmentShader);
+  createShaderModules(&vertexShader, &fragmentShader);
   // Specify vertex and fragment shader stages
   VkPipelineShaderStageCreateInfo shaderStages[2]{
           {
@@ -474,18 +553,6 @@ void VulkanRenderer::createGraphicsPipeline() {
           .pVertexAttributeDescriptions = vertex_input_attributes,
   };
 
-  // Create the pipeline cache
-  VkPipelineCacheCreateInfo pipelineCacheInfo{
-          .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
-          .pNext = nullptr,
-          .flags = 0,  // reserved, must be 0
-          .initialDataSize = 0,
-          .pInitialData = nullptr,
-  };
-
-  CALL_VK(vkCreatePipelineCache(deviceInfo.device, &pipelineCacheInfo, nullptr,
-                                &gfxPipelineInfo.cache))
-
   // Create the pipeline
   VkGraphicsPipelineCreateInfo pipelineCreateInfo{
           .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -509,9 +576,14 @@ void VulkanRenderer::createGraphicsPipeline() {
           .basePipelineIndex = 0,
   };
 
+  const auto start = std::chrono::steady_clock::now();
   CALL_VK(vkCreateGraphicsPipelines(
-          deviceInfo.device, gfxPipelineInfo.cache, 1, &pipelineCreateInfo, nullptr,
+          deviceInfo.device, pipelineCache.get(), 1, &pipelineCreateInfo, nullptr,
           &gfxPipelineInfo.pipeline))
+  LOGI("Graphics pipeline created in %lld us, %s pipeline cache",
+       static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start).count()),
+       pipelineCache.warm() ? "warm" : "cold");
 
   // We don't need the shaders anymore, we can release their memory
   vkDestroyShaderModule(deviceInfo.device, vertexShader, nullptr);
@@ -519,6 +591,42 @@ void VulkanRenderer::createGraphicsPipeline() {
   LOGI("<-createGraphicsPipeline");
 }
 
+void VulkanRenderer::createShaderModules(VkShaderModule *vertexShader,
+                                         VkShaderModule *fragmentShader) const {
+#ifdef ENGINE_RUNTIME_SHADERC
+  CALL_VK(buildShaderFromFile(shaders::kCameraVertGlsl,
+                              VK_SHADER_STAGE_VERTEX_BIT,
+                              deviceInfo.device,
+                              vertexShader))
+  CALL_VK(buildShaderFromFile(shaders::kCameraFragGlsl,
+                              VK_SHADER_STAGE_FRAGMENT_BIT,
+                              deviceInfo.device,
+                              fragmentShader))
+#else
+  CALL_VK(createShaderModule(shaders::kCameraVertSpv,
+                             sizeof(shaders::kCameraVertSpv),
+                             deviceInfo.device,
+                             vertexShader))
+  CALL_VK(createShaderModule(shaders::kCameraFragSpv,
+                             sizeof(shaders::kCameraFragSpv),
+                             deviceInfo.device,
+                             fragmentShader))
+#endif
+}
+
+VkResult VulkanRenderer::createShaderModule(const uint32_t *code, size_t codeSize,
+                                            VkDevice vkDevice, VkShaderModule *shaderOut) {
+  VkShaderModuleCreateInfo shaderModuleCreateInfo{
+          .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .codeSize = codeSize,
+          .pCode = code,
+  };
+  return vkCreateShaderModule(vkDevice, &shaderModuleCreateInfo, nullptr, shaderOut);
+}
+
+#ifdef ENGINE_RUNTIME_SHADERC
 shaderc_shader_kind VulkanRenderer::getShadercShaderType(VkShaderStageFlagBits type) {
   switch (type) {
     case VK_SHADER_STAGE_VERTEX_BIT:
@@ -568,6 +676,7 @@ VkResult VulkanRenderer::buildShaderFromFile(const char *shaderSource,
 
   return result;
 }
+#endif
 
 void VulkanRenderer::createBuffer(
         VkDeviceSize size,
@@ -727,11 +836,10 @@ void VulkanRenderer::createOtherStaff() {
   CALL_VK(vkCreateCommandPool(deviceInfo.device, &cmdPoolCreateInfo, nullptr,
                               &renderInfo.cmdPool))
 
-  // Record a command buffer that just clear the screen
-  // 1 command buffer draw in 1 framebuffer
-  // In our case we need 2 command as we have 2 framebuffer
-  renderInfo.cmdBufferLen = swapchainInfo.swapchainLength;
-  renderInfo.cmdBuffer = new VkCommandBuffer[swapchainInfo.swapchainLength];
+  // Every framebuffer gets a command buffer per imported image slot, so switching between
+  // recycled camera buffers only switches which pre-recorded command buffer is submitted
+  renderInfo.cmdBufferLen = swapchainInfo.swapchainLength * kImageSlots;
+  renderInfo.cmdBuffer = new VkCommandBuffer[renderInfo.cmdBufferLen];
   VkCommandBufferAllocateInfo cmdBufferCreateInfo{
           .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
           .pNext = nullptr,
@@ -741,102 +849,443 @@ void VulkanRenderer::createOtherStaff() {
   };
   CALL_VK(vkAllocateCommandBuffers(deviceInfo.device, &cmdBufferCreateInfo,
                                    renderInfo.cmdBuffer))
-  // We need to create a fence to be able, in the main loop, to wait for our
-  // draw command(s) to finish before swapping the framebuffers
+  // recorded lazily once there is a camera image to draw
+  renderInfo.recordedGenerations.assign(renderInfo.cmdBufferLen, 0);
+  renderInfo.freeImageSlots.clear();
+  for (uint32_t slot = kImageSlots; slot > 0; --slot) {
+    renderInfo.freeImageSlots.push_back(slot - 1);
+  }
+  renderInfo.submitSerial = 0;
+  renderInfo.completedSerial = 0;
+  // Fences start signaled so that the first use of every frame slot does not wait.
+  // Semaphores order acquire -> render -> present on the GPU without the CPU in between.
   VkFenceCreateInfo fenceCreateInfo{
           .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
           .pNext = nullptr,
-          .flags = 0,
+          .flags = VK_FENCE_CREATE_SIGNALED_BIT,
   };
-  CALL_VK(vkCreateFence(deviceInfo.device, &fenceCreateInfo, nullptr, &renderInfo.fence))
-
-  // We need to create a semaphore to be able to wait, in the main loop, for our
-  // framebuffer to be available for us before drawing.
   VkSemaphoreCreateInfo semaphoreCreateInfo{
           .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
           .pNext = nullptr,
           .flags = 0,
   };
-  CALL_VK(vkCreateSemaphore(deviceInfo.device, &semaphoreCreateInfo, nullptr,
-                            &renderInfo.semaphore))
+  renderInfo.frames.resize(framesInFlight);
+  for (auto &frame : renderInfo.frames) {
+    CALL_VK(vkCreateFence(deviceInfo.device, &fenceCreateInfo, nullptr, &frame.fence))
+    CALL_VK(vkCreateSemaphore(deviceInfo.device, &semaphoreCreateInfo, nullptr,
+                              &frame.imageAvailable))
+    CALL_VK(vkCreateSemaphore(deviceInfo.device, &semaphoreCreateInfo, nullptr,
+                              &frame.renderFinished))
+    frame.serial = 0;
+  }
+  renderInfo.frameIndex = 0;
   LOGI("<-createOtherStaff");
 }
 
 void VulkanRenderer::renderImpl() {
+  TRACE_SCOPE("draw");
+  auto &frame = renderInfo.frames[renderInfo.frameIndex];
+  // only blocks when the GPU is still busy with the frame rendered framesInFlight frames ago
+  CALL_VK(vkWaitForFences(deviceInfo.device, 1, &frame.fence, VK_TRUE, UINT64_MAX))
+  renderInfo.completedSerial = std::max(renderInfo.completedSerial, frame.serial);
+  importedImages.collect(renderInfo.completedSerial, [this](VulkanImportedImage &importedImage) {
+    destroyImportedImage(importedImage);
+  });
+  releaseRetiredFrames();
+
   uint32_t nextIndex;
-  // Get the framebuffer index we should draw in
-  auto result = vkAcquireNextImageKHR(deviceInfo.device, swapchainInfo.swapchain,
-                                      UINT64_MAX, renderInfo.semaphore, VK_NULL_HANDLE,
-                                      &nextIndex);
-  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-    LOGW("vkAcquireNextImageKHR returned %i; swapchain will be recreated", result);
-    cleanupSwapChain();
-    createSwapChain();
-    createFrameBuffersAndImages();
-    return;
+  VkResult result = VK_SUCCESS;
+  if (headless) {
+    // offscreen image of this frame slot, its previous draw completed together with the fence above
+    nextIndex = renderInfo.frameIndex;
+  } else {
+    // Get the framebuffer index we should draw in, without waiting for the presentation engine
+    result = vkAcquireNextImageKHR(deviceInfo.device, swapchainInfo.swapchain,
+                                   0, frame.imageAvailable, VK_NULL_HANDLE,
+                                   &nextIndex);
+    if (result == VK_NOT_READY || result == VK_TIMEOUT) {
+      // every image is still queued for presentation, try again on next vsync
+      renderOnNextVsync();
+      return;
+    }
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      LOGW("vkAcquireNextImageKHR returned %i; swapchain will be recreated", result);
+      recreateSwapChain();
+      renderOnNextVsync();
+      return;
+    }
+  }
+  // image acquired with VK_SUBOPTIMAL_KHR is still rendered, swapchain is recreated after presenting it
+  auto &imageInFlight = renderInfo.imagesInFlight[nextIndex];
+  if (imageInFlight != VK_NULL_HANDLE && imageInFlight != frame.fence) {
+    CALL_VK(vkWaitForFences(deviceInfo.device, 1, &imageInFlight, VK_TRUE, UINT64_MAX))
   }
-  CALL_VK(vkResetFences(deviceInfo.device, 1, &renderInfo.fence))
+  imageInFlight = frame.fence;
+  const auto cmdIndex = commandBufferIndex(nextIndex, currentImage->value.slot);
+  if (renderInfo.recordedGenerations[cmdIndex] != currentImage->generation) {
+    recordCommandBuffer(nextIndex);
+  }
+  CALL_VK(vkResetFences(deviceInfo.device, 1, &frame.fence))
   VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
   VkSubmitInfo submit_info = {
           .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
           .pNext = nullptr,
-          .waitSemaphoreCount = 1,
-          .pWaitSemaphores = &renderInfo.semaphore,
+          // offscreen image is not shared with a presentation engine, there is nothing to wait for / signal
+          .waitSemaphoreCount = headless ? 0u : 1u,
+          .pWaitSemaphores = &frame.imageAvailable,
           .pWaitDstStageMask = &waitStageMask,
           .commandBufferCount = 1,
-          .pCommandBuffers = &renderInfo.cmdBuffer[nextIndex],
-          .signalSemaphoreCount = 0,
-          .pSignalSemaphores = nullptr};
-  CALL_VK(vkQueueSubmit(deviceInfo.queue, 1, &submit_info, renderInfo.fence))
-  LOGI("Queue submitted, waiting for a fence...");
-  CALL_VK(vkWaitForFences(deviceInfo.device, 1, &renderInfo.fence, VK_TRUE, 100000000))
-  LOGI("Fence signaled, presenting a frame!");
+          .pCommandBuffers = &renderInfo.cmdBuffer[cmdIndex],
+          .signalSemaphoreCount = headless ? 0u : 1u,
+          .pSignalSemaphores = &frame.renderFinished};
+  CALL_VK(vkQueueSubmit(deviceInfo.queue, 1, &submit_info, frame.fence))
+  onFrameSubmitted();
+  drawnImageIndex = nextIndex;
+  presentWait = frame.renderFinished;
+  // readback copies get chained in between, moving presentWait along
+  onFrameDrawn();
+  frame.serial = ++renderInfo.submitSerial;
+  currentImage->lastUsedSerial = frame.serial;
+  renderInfo.frameIndex = (renderInfo.frameIndex + 1) % framesInFlight;
+  if (headless) {
+    // no presentation engine, the frame is as far as it gets once submitted
+    onFramePresented();
+    pipelineCache.saveAsync();
+    return;
+  }
   VkPresentInfoKHR presentInfo{
           .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
           .pNext = nullptr,
-          .waitSemaphoreCount = 0,
-          .pWaitSemaphores = nullptr,
+          .waitSemaphoreCount = 1,
+          .pWaitSemaphores = &presentWait,
           .swapchainCount = 1,
           .pSwapchains = &swapchainInfo.swapchain,
           .pImageIndices = &nextIndex,
           .pResults = nullptr,
   };
-  vkQueuePresentKHR(deviceInfo.queue, &presentInfo);
+  {
+    TRACE_SCOPE("present");
+    result = vkQueuePresentKHR(deviceInfo.queue, &presentInfo);
+  }
+  if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+    onFramePresented();
+  }
+  if (result == VK_SUCCESS) {
+    // every pipeline needed for the camera format exists by now
+    pipelineCache.saveAsync();
+  }
+  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+    LOGW("vkQueuePresentKHR returned %i; swapchain will be recreated", result);
+    recreateSwapChain();
+  }
+}
+
+uint64_t VulkanRenderer::completedDrawSerial() {
+  if (!deviceInfo.initialized) {
+    return 0;
+  }
+  // frames submitted since the last wait could have finished as well, only queried
+  for (const auto &frame : renderInfo.frames) {
+    if (frame.serial > renderInfo.completedSerial &&
+        vkGetFenceStatus(deviceInfo.device, frame.fence) == VK_SUCCESS) {
+      renderInfo.completedSerial = frame.serial;
+    }
+  }
+  return renderInfo.completedSerial;
+}
+
+bool VulkanRenderer::startReadback(CaptureRequest &request) {
+  auto readback = std::find_if(readbacks.begin(), readbacks.end(), [](const VulkanReadback &slot) {
+    return !slot.inFlight;
+  });
+  if (readback == readbacks.end()) {
+    return false;
+  }
+  TRACE_SCOPE("copyImageToBuffer");
+  const auto start = latencyClockNanos();
+  if (readback->cmdBuffer == VK_NULL_HANDLE) {
+    VkCommandBufferAllocateInfo cmdBufferCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = nullptr,
+            .commandPool = renderInfo.cmdPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+    };
+    CALL_VK(vkAllocateCommandBuffers(deviceInfo.device, &cmdBufferCreateInfo,
+                                     &readback->cmdBuffer))
+    VkFenceCreateInfo fenceCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+    };
+    CALL_VK(vkCreateFence(deviceInfo.device, &fenceCreateInfo, nullptr, &readback->fence))
+    VkSemaphoreCreateInfo semaphoreCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = nullptr,
+            .flags = 0,
+    };
+    CALL_VK(vkCreateSemaphore(deviceInfo.device, &semaphoreCreateInfo, nullptr,
+                              &readback->copyFinished))
+  }
+  const auto width = swapchainInfo.displaySize.width;
+  const auto height = swapchainInfo.displaySize.height;
+  const VkDeviceSize size = VkDeviceSize(width) * height * 4;
+  if (readback->size != size) {
+    createReadbackBuffer(*readback, size);
+  }
+  readback->width = width;
+  readback->height = height;
+
+  const auto image = swapchainInfo.displayImages[drawnImageIndex];
+  // offscreen image is left in TRANSFER_SRC by the render pass but its writes are not visible yet,
+  // swapchain image writes are made visible by waiting for presentWait
+  const auto drawnLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                    : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  const VkImageSubresourceRange subresourceRange{
+          .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+          .baseMipLevel = 0,
+          .levelCount = 1,
+          .baseArrayLayer = 0,
+          .layerCount = 1,
+  };
+  VkCommandBufferBeginInfo cmdBufferBeginInfo{
+          .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+          .pNext = nullptr,
+          .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+          .pInheritanceInfo = nullptr,
+  };
+  CALL_VK(vkBeginCommandBuffer(readback->cmdBuffer, &cmdBufferBeginInfo))
+  VkImageMemoryBarrier toTransfer{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .pNext = nullptr,
+          .srcAccessMask = headless ? VkAccessFlags(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) : 0u,
+          .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+          .oldLayout = drawnLayout,
+          .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = image,
+          .subresourceRange = subresourceRange,
+  };
+  vkCmdPipelineBarrier(readback->cmdBuffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+  // buffer rows are tightly packed, swapchain format is always R8G8B8A8
+  VkBufferImageCopy region{
+          .bufferOffset = 0,
+          .bufferRowLength = 0,
+          .bufferImageHeight = 0,
+          .imageSubresource = {
+                  .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                  .mipLevel = 0,
+                  .baseArrayLayer = 0,
+                  .layerCount = 1,
+          },
+          .imageOffset = {0, 0, 0},
+          .imageExtent = {width, height, 1},
+  };
+  vkCmdCopyImageToBuffer(readback->cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         readback->buffer, 1, &region);
+  if (!headless) {
+    VkImageMemoryBarrier toPresent{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext = nullptr,
+            .srcAccessMask = 0,
+            .dstAccessMask = 0,
+            .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = image,
+            .subresourceRange = subresourceRange,
+    };
+    vkCmdPipelineBarrier(readback->cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1,
+                         &toPresent);
+  }
+  VkBufferMemoryBarrier toHost{
+          .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+          .pNext = nullptr,
+          .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+          .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .buffer = readback->buffer,
+          .offset = 0,
+          .size = VK_WHOLE_SIZE,
+  };
+  vkCmdPipelineBarrier(readback->cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &toHost, 0, nullptr);
+  CALL_VK(vkEndCommandBuffer(readback->cmdBuffer))
+
+  VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkSubmitInfo submitInfo{
+          .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+          .pNext = nullptr,
+          // offscreen copy is ordered after the draw by the barrier alone
+          .waitSemaphoreCount = headless ? 0u : 1u,
+          .pWaitSemaphores = &presentWait,
+          .pWaitDstStageMask = &waitStageMask,
+          .commandBufferCount = 1,
+          .pCommandBuffers = &readback->cmdBuffer,
+          .signalSemaphoreCount = headless ? 0u : 1u,
+          .pSignalSemaphores = &readback->copyFinished,
+  };
+  // reset only now, renderImpl could still wait for it through imagesInFlight until then
+  CALL_VK(vkResetFences(deviceInfo.device, 1, &readback->fence))
+  CALL_VK(vkQueueSubmit(deviceInfo.queue, 1, &submitInfo, readback->fence))
+  if (!headless) {
+    presentWait = readback->copyFinished;
+  }
+  // image must not be drawn into again before the copy is done, its fence covers the draw as well
+  renderInfo.imagesInFlight[drawnImageIndex] = readback->fence;
+  readback->inFlight = true;
+  readback->request = std::move(request);
+  readback->request.renderThreadNanos += latencyClockNanos() - start;
+  return true;
+}
+
+bool VulkanRenderer::completeReadbacks(bool wait) {
+  bool inFlight = false;
+  for (auto &readback: readbacks) {
+    if (!readback.inFlight) {
+      continue;
+    }
+    const auto start = latencyClockNanos();
+    const auto status = wait
+            ? vkWaitForFences(deviceInfo.device, 1, &readback.fence, VK_TRUE, UINT64_MAX)
+            : vkGetFenceStatus(deviceInfo.device, readback.fence);
+    if (status == VK_NOT_READY) {
+      readback.request.renderThreadNanos += latencyClockNanos() - start;
+      inFlight = true;
+      continue;
+    }
+    CapturedImage image;
+    const bool ok = status == VK_SUCCESS;
+    if (ok) {
+      TRACE_SCOPE("mapReadback");
+      // no-op on coherent memory, needed for the cached one
+      VkMappedMemoryRange range{
+              .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+              .pNext = nullptr,
+              .memory = readback.memory,
+              .offset = 0,
+              .size = VK_WHOLE_SIZE,
+      };
+      CALL_VK(vkInvalidateMappedMemoryRanges(deviceInfo.device, 1, &range))
+      image.width = readback.width;
+      image.height = readback.height;
+      image.pixels.resize(size_t(readback.width) * readback.height * 4);
+      memcpy(image.pixels.data(), readback.mapped, image.pixels.size());
+    } else {
+      LOGE("Readback fence returned %i", status);
+    }
+    readback.inFlight = false;
+    readback.request.renderThreadNanos += latencyClockNanos() - start;
+    finishReadback(std::move(readback.request), ok, std::move(image));
+  }
+  return inFlight;
+}
+
+void VulkanRenderer::createReadbackBuffer(VulkanReadback &readback, VkDeviceSize size) {
+  if (readback.buffer != VK_NULL_HANDLE) {
+    vkDestroyBuffer(deviceInfo.device, readback.buffer, nullptr);
+    // unmapped implicitly
+    vkFreeMemory(deviceInfo.device, readback.memory, nullptr);
+  }
+  VkBufferCreateInfo createBufferInfo{
+          .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .size = size,
+          .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+          .queueFamilyIndexCount = 1,
+          .pQueueFamilyIndices = &deviceInfo.queueFamilyIndex,
+  };
+  CALL_VK(vkCreateBuffer(deviceInfo.device, &createBufferInfo, nullptr, &readback.buffer))
+  VkMemoryRequirements memReq;
+  vkGetBufferMemoryRequirements(deviceInfo.device, readback.buffer, &memReq);
+  VkMemoryAllocateInfo allocInfo{
+          .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+          .pNext = nullptr,
+          .allocationSize = memReq.size,
+          .memoryTypeIndex = UINT32_MAX,
+  };
+  // uncached reads are several times slower on mobile GPUs, coherent memory is the fallback
+  mapMemoryTypeToIndex(memReq.memoryTypeBits,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                       &allocInfo.memoryTypeIndex);
+  if (allocInfo.memoryTypeIndex == UINT32_MAX) {
+    mapMemoryTypeToIndex(memReq.memoryTypeBits,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         &allocInfo.memoryTypeIndex);
+  }
+  CALL_VK(vkAllocateMemory(deviceInfo.device, &allocInfo, nullptr, &readback.memory))
+  CALL_VK(vkBindBufferMemory(deviceInfo.device, readback.buffer, readback.memory, 0))
+  CALL_VK(vkMapMemory(deviceInfo.device, readback.memory, 0, VK_WHOLE_SIZE, 0, &readback.mapped))
+  readback.size = size;
+}
+
+void VulkanRenderer::destroyReadbacks() {
+  completeReadbacks(true);
+  for (auto &readback: readbacks) {
+    if (readback.buffer != VK_NULL_HANDLE) {
+      vkDestroyBuffer(deviceInfo.device, readback.buffer, nullptr);
+      vkFreeMemory(deviceInfo.device, readback.memory, nullptr);
+    }
+    if (readback.cmdBuffer != VK_NULL_HANDLE) {
+      // command buffer goes away together with its pool
+      vkDestroyFence(deviceInfo.device, readback.fence, nullptr);
+      vkDestroySemaphore(deviceInfo.device, readback.copyFinished, nullptr);
+    }
+    readback = {};
+  }
+}
+
+void VulkanRenderer::updateFrameCpuTime(int64_t micros) {
+  ++frameCpuTime.frames;
+  frameCpuTime.totalMicros += micros;
+  frameCpuTime.maxMicros = std::max(frameCpuTime.maxMicros, micros);
+  if (frameCpuTime.frames == kFrameCpuTimeLogInterval) {
+    LOGI("Render thread CPU time per frame: avg=%lld us, max=%lld us over %llu frames",
+         static_cast<long long>(frameCpuTime.totalMicros / static_cast<int64_t>(frameCpuTime.frames)),
+         static_cast<long long>(frameCpuTime.maxMicros),
+         static_cast<unsigned long long>(frameCpuTime.frames));
+    frameCpuTime = {};
+  }
+}
+
+void VulkanRenderer::recreateSwapChain() {
+  // frames in flight still reference swapchain images and framebuffers
+  CALL_VK(vkDeviceWaitIdle(deviceInfo.device))
+  renderInfo.completedSerial = renderInfo.submitSerial;
+  cleanupSwapChain();
+  createSwapChain();
+  createFrameBuffersAndImages();
 }
 
 void VulkanRenderer::createDescriptorSet() {
   LOGI("->createDescriptorSet");
-  const VkDescriptorPoolSize poolSizeUbo = {
-          .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-          .descriptorCount = 1
-  };
+  // one set per imported image, evicted ones stay alive until the frame using them completes
+  const uint32_t maxSets = 2 * ImportedImageCache::kDefaultCapacity;
   const VkDescriptorPoolSize poolSizeSampler = {
           .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-          .descriptorCount = 1,
+          // multi-planar image with YCbCr conversion may consume more than one descriptor
+          .descriptorCount = maxSets
+                  * (ycbcrInfo.sampler != VK_NULL_HANDLE ? ycbcrInfo.descriptorCount : 1u),
   };
-  const auto poolSizes = new VkDescriptorPoolSize[2];
-  poolSizes[0] = poolSizeUbo;
-  poolSizes[1] = poolSizeSampler;
   const VkDescriptorPoolCreateInfo poolCreateInfo = {
           .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
           .pNext = nullptr,
-          .maxSets = 1,
-          .poolSizeCount = 2,
-          .pPoolSizes = poolSizes,
+          .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+          .maxSets = maxSets,
+          .poolSizeCount = 1,
+          .pPoolSizes = &poolSizeSampler,
   };
   CALL_VK(vkCreateDescriptorPool(deviceInfo.device, &poolCreateInfo, nullptr,
                                  &gfxPipelineInfo.descPool))
-  delete[] poolSizes;
-
-  VkDescriptorSetAllocateInfo alloc_info{
-          .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-          .pNext = nullptr,
-          .descriptorPool = gfxPipelineInfo.descPool,
-          .descriptorSetCount = 1,
-          .pSetLayouts = &gfxPipelineInfo.dscLayout};
-  CALL_VK(vkAllocateDescriptorSets(deviceInfo.device, &alloc_info,
-                                   &gfxPipelineInfo.descSet))
-  gfxPipelineInfo.descWrites = new VkWriteDescriptorSet[2];
+  gfxPipelineInfo.descWrites = new VkWriteDescriptorSet[1];
   LOGI("<-createDescriptorSet");
 }
 
@@ -844,6 +1293,32 @@ void VulkanRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
   if (!deviceInfo.initialized) {
     return;
   }
+  // format of a cached buffer matches current YCbCr conversion, otherwise the cache would be cleared
+  auto entry = importedImages.find(buffer);
+  if (!entry) {
+    // descriptor pool is sized for a bounded number of retired images
+    importedImages.collect(renderInfo.completedSerial, [this](VulkanImportedImage &importedImage) {
+      destroyImportedImage(importedImage);
+    });
+    if (renderInfo.freeImageSlots.empty()) {
+      LOGE("All %u image slots are in use by frames in flight, frame skipped", kImageSlots);
+      return;
+    }
+    VulkanImportedImage importedImage{};
+    if (!importHwBuffer(buffer, importedImage)) {
+      return;
+    }
+    // taken after importing, YCbCr conversion change may have freed every slot
+    importedImage.slot = renderInfo.freeImageSlots.back();
+    renderInfo.freeImageSlots.pop_back();
+    entry = &importedImages.insert(buffer, importedImage);
+    BLOG("Buffer %p imported, %zu images cached", buffer, importedImages.size());
+  }
+  currentImage = entry;
+  cameraInitialized = true;
+}
+
+bool VulkanRenderer::importHwBuffer(AHardwareBuffer *buffer, VulkanImportedImage &importedImage) {
   VkAndroidHardwareBufferFormatPropertiesANDROID ahb_format_props = {
           .sType = VK_STRUCTURE_TYPE_ANDROID_HARDWARE_BUFFER_FORMAT_PROPERTIES_ANDROID,
           .pNext = nullptr,
@@ -856,6 +1331,13 @@ void VulkanRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
           (PFN_vkGetAndroidHardwareBufferPropertiesANDROID) vkGetInstanceProcAddr(
                   deviceInfo.instance, "vkGetAndroidHardwareBufferPropertiesANDROID");
   CALL_VK(vkGetAndroidHardwareBufferPropertiesANDROID(deviceInfo.device, buffer, &ahb_props))
+  const bool ycbcr = needsYcbcrConversion(ahb_format_props);
+  if (ycbcr && !deviceInfo.ycbcrConversionSupported) {
+    LOGE("Camera buffer has YUV format but sampler YCbCr conversion is not supported, frame skipped");
+    return false;
+  }
+  updateYcbcrConversion(ycbcr ? &ahb_format_props : nullptr);
+  const VkFormat imageFormat = ycbcr ? ahb_format_props.format : VK_FORMAT_R8G8B8A8_UNORM;
 
   VkMemoryDedicatedAllocateInfo dedicatedAllocateInfo = {
           .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
@@ -878,8 +1360,15 @@ void VulkanRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
   mapMemoryTypeToIndex(ahb_props.memoryTypeBits,
                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                        &allocInfo.memoryTypeIndex);
+  // only set when Vulkan has no matching format, image format must be VK_FORMAT_UNDEFINED then
+  VkExternalFormatANDROID externalFormat = {
+          .sType = VK_STRUCTURE_TYPE_EXTERNAL_FORMAT_ANDROID,
+          .pNext = nullptr,
+          .externalFormat = ycbcr && imageFormat == VK_FORMAT_UNDEFINED ? ahb_format_props.externalFormat : 0,
+  };
   VkExternalMemoryImageCreateInfo externalMemoryImageCreateInfo = {
           .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO,
+          .pNext = &externalFormat,
           .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_ANDROID_HARDWARE_BUFFER_BIT_ANDROID,
   };
   AHardwareBuffer_Desc hardwareBufferDesc;
@@ -889,7 +1378,7 @@ void VulkanRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
           .pNext = &externalMemoryImageCreateInfo,
           .flags = 0,
           .imageType = VK_IMAGE_TYPE_2D,
-          .format = VK_FORMAT_R8G8B8A8_UNORM,
+          .format = imageFormat,
           .extent = {
                   static_cast<uint32_t>(hardwareBufferDesc.width),
                   static_cast<uint32_t>(hardwareBufferDesc.height),
@@ -899,31 +1388,34 @@ void VulkanRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
           .arrayLayers = 1,
           .samples = VK_SAMPLE_COUNT_1_BIT,
           .tiling = VK_IMAGE_TILING_OPTIMAL,
-          .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+          // images with external format could only be sampled
+          .usage = static_cast<VkImageUsageFlags>(
+                  ycbcr ? VK_IMAGE_USAGE_SAMPLED_BIT
+                        : VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT),
           .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
           .queueFamilyIndexCount = 1,
           .pQueueFamilyIndices = &deviceInfo.queueFamilyIndex,
           // VK_IMAGE_LAYOUT_UNDEFINED is mandatory when using external memory
           .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
   };
-  if (cameraInitialized) {
-    vkDestroyImage(deviceInfo.device, externalTextureInfo.image, nullptr);
-    vkDestroyImageView(deviceInfo.device, externalTextureInfo.view, nullptr);
-    vkFreeMemory(deviceInfo.device, externalTextureInfo.memory, nullptr);
-  }
   CALL_VK(vkCreateImage(deviceInfo.device, &image_create_info, nullptr,
-                        &externalTextureInfo.image))
-  dedicatedAllocateInfo.image = externalTextureInfo.image;
-  CALL_VK(vkAllocateMemory(deviceInfo.device, &allocInfo, nullptr, &externalTextureInfo.memory))
-  CALL_VK(vkBindImageMemory(deviceInfo.device, externalTextureInfo.image,
-                            externalTextureInfo.memory, 0))
+                        &importedImage.image))
+  dedicatedAllocateInfo.image = importedImage.image;
+  CALL_VK(vkAllocateMemory(deviceInfo.device, &allocInfo, nullptr, &importedImage.memory))
+  CALL_VK(vkBindImageMemory(deviceInfo.device, importedImage.image,
+                            importedImage.memory, 0))
+  VkSamplerYcbcrConversionInfo conversionInfo = {
+          .sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO,
+          .pNext = nullptr,
+          .conversion = ycbcrInfo.conversion,
+  };
   VkImageViewCreateInfo view = {
           .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-          .pNext = nullptr,
+          .pNext = ycbcr ? &conversionInfo : nullptr,
           .flags = 0,
-          .image = externalTextureInfo.image,
+          .image = importedImage.image,
           .viewType = VK_IMAGE_VIEW_TYPE_2D,
-          .format = VK_FORMAT_R8G8B8A8_UNORM,
+          .format = imageFormat,
           .components =
                   {
                           VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G,
@@ -937,31 +1429,22 @@ void VulkanRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
                   1
           },
   };
-  CALL_VK(vkCreateImageView(deviceInfo.device, &view, nullptr, &externalTextureInfo.view))
+  CALL_VK(vkCreateImageView(deviceInfo.device, &view, nullptr, &importedImage.view))
+  VkDescriptorSetAllocateInfo alloc_info{
+          .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+          .pNext = nullptr,
+          .descriptorPool = gfxPipelineInfo.descPool,
+          .descriptorSetCount = 1,
+          .pSetLayouts = &gfxPipelineInfo.dscLayout};
+  CALL_VK(vkAllocateDescriptorSets(deviceInfo.device, &alloc_info, &importedImage.descSet))
   VkDescriptorImageInfo imageInfo = {
-          .sampler = externalTextureInfo.sampler,
-          .imageView = externalTextureInfo.view,
+          .sampler = ycbcr ? ycbcrInfo.sampler : externalTextureInfo.sampler,
+          .imageView = importedImage.view,
           .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
   };
-  VkDescriptorBufferInfo bufferInfo = {
-          .buffer = buffersInfo.uniformBuf,
-          .offset = 0,
-          .range = sizeof(UniformBufferObject)
-  };
-  VkWriteDescriptorSet bufferWrite = {
-          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-          .dstSet = gfxPipelineInfo.descSet,
-          .dstBinding = 0,
-          .dstArrayElement = 0,
-          .descriptorCount = 1,
-          .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-          .pImageInfo = nullptr,
-          .pBufferInfo = &bufferInfo,
-          .pTexelBufferView = nullptr
-  };
   VkWriteDescriptorSet imageWrite = {
           .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-          .dstSet = gfxPipelineInfo.descSet,
+          .dstSet = importedImage.descSet,
           .dstBinding = 1,
           .dstArrayElement = 0,
           .descriptorCount = 1,
@@ -969,90 +1452,279 @@ void VulkanRenderer::hwBufferToTexture(AHardwareBuffer *buffer) {
           .pImageInfo = &imageInfo,
           .pBufferInfo = nullptr,
           .pTexelBufferView = nullptr};
-  gfxPipelineInfo.descWrites[0] = bufferWrite;
-  gfxPipelineInfo.descWrites[1] = imageWrite;
-  vkUpdateDescriptorSets(deviceInfo.device, 2, gfxPipelineInfo.descWrites, 0, nullptr);
-  recordCommandBuffer();
-  cameraInitialized = true;
+  gfxPipelineInfo.descWrites[0] = imageWrite;
+  vkUpdateDescriptorSets(deviceInfo.device, 1, gfxPipelineInfo.descWrites, 0, nullptr);
+  return true;
 }
 
-void VulkanRenderer::recordCommandBuffer() {
-  for (int bufferIndex = 0; bufferIndex < swapchainInfo.swapchainLength; bufferIndex++) {
-    // We start by creating and declare the "beginning" our command buffer
-    VkCommandBufferBeginInfo cmdBufferBeginInfo{
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+bool VulkanRenderer::needsYcbcrConversion(
+        const VkAndroidHardwareBufferFormatPropertiesANDROID &formatProperties) {
+  switch (formatProperties.format) {
+    case VK_FORMAT_UNDEFINED:
+    case VK_FORMAT_G8_B8R8_2PLANE_420_UNORM:
+    case VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM:
+    case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void VulkanRenderer::updateYcbcrConversion(
+        const VkAndroidHardwareBufferFormatPropertiesANDROID *formatProperties) {
+  const VkFilter chromaFilter = formatProperties &&
+          (formatProperties->formatFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_YCBCR_CONVERSION_LINEAR_FILTER_BIT)
+          ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+  if (!formatProperties) {
+    if (ycbcrInfo.conversion == VK_NULL_HANDLE) {
+      return;
+    }
+  } else if (ycbcrInfo.conversion != VK_NULL_HANDLE
+             && ycbcrInfo.format == formatProperties->format
+             && ycbcrInfo.externalFormat == formatProperties->externalFormat
+             && ycbcrInfo.model == formatProperties->suggestedYcbcrModel
+             && ycbcrInfo.range == formatProperties->suggestedYcbcrRange
+             && ycbcrInfo.xChromaOffset == formatProperties->suggestedXChromaOffset
+             && ycbcrInfo.yChromaOffset == formatProperties->suggestedYChromaOffset
+             && ycbcrInfo.chromaFilter == chromaFilter) {
+    return;
+  }
+  LOGI("->updateYcbcrConversion");
+  // pipeline and descriptor set bake in the immutable sampler, everything using them must be finished
+  CALL_VK(vkQueueWaitIdle(deviceInfo.queue))
+  // image views are created with the conversion and descriptor sets come from the pool below
+  clearImportedImages();
+  destroyGraphicsPipeline();
+  destroyYcbcrConversion();
+  if (formatProperties) {
+    VkExternalFormatANDROID externalFormat = {
+            .sType = VK_STRUCTURE_TYPE_EXTERNAL_FORMAT_ANDROID,
             .pNext = nullptr,
-            .flags = 0,
-            .pInheritanceInfo = nullptr,
+            .externalFormat = formatProperties->format == VK_FORMAT_UNDEFINED
+                              ? formatProperties->externalFormat : 0,
     };
-    CALL_VK(vkBeginCommandBuffer(renderInfo.cmdBuffer[bufferIndex],
-                                 &cmdBufferBeginInfo))
-
-    setImageLayout(renderInfo.cmdBuffer[bufferIndex],
-                   externalTextureInfo.image,
-                   VK_IMAGE_LAYOUT_UNDEFINED,
-                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                   VK_PIPELINE_STAGE_HOST_BIT,
-                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-    // Now we start a renderpass. Any draw command has to be recorded in a
-    // renderpass
-    VkClearValue clearVals{
-            .color {.float32 {0.9f, 0.3f, 0.0f, 1.0f,}},
+    const VkSamplerYcbcrConversionCreateInfo conversionCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_CREATE_INFO,
+            .pNext = &externalFormat,
+            .format = formatProperties->format,
+            .ycbcrModel = formatProperties->suggestedYcbcrModel,
+            .ycbcrRange = formatProperties->suggestedYcbcrRange,
+            // identity when external format is used, otherwise suggested swizzle for the format
+            .components = formatProperties->format == VK_FORMAT_UNDEFINED
+                          ? VkComponentMapping{
+                                  VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                                  VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                          }
+                          : formatProperties->samplerYcbcrConversionComponents,
+            .xChromaOffset = formatProperties->suggestedXChromaOffset,
+            .yChromaOffset = formatProperties->suggestedYChromaOffset,
+            .chromaFilter = chromaFilter,
+            .forceExplicitReconstruction = VK_FALSE,
     };
-
-    VkRenderPassBeginInfo renderPassBeginInfo{
-            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+    CALL_VK(deviceInfo.createSamplerYcbcrConversion(deviceInfo.device, &conversionCreateInfo,
+                                                    nullptr, &ycbcrInfo.conversion))
+    const VkSamplerYcbcrConversionInfo conversionInfo = {
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO,
             .pNext = nullptr,
-            .renderPass = renderInfo.renderPass,
-            .framebuffer = swapchainInfo.framebuffers[bufferIndex],
-            .renderArea = {.offset =
-                    {
-                            .x = 0, .y = 0,
-                    },
-                    .extent = swapchainInfo.displaySize},
-            .clearValueCount = 1,
-            .pClearValues = &clearVals};
-    vkCmdBeginRenderPass(renderInfo.cmdBuffer[bufferIndex], &renderPassBeginInfo,
-                         VK_SUBPASS_CONTENTS_INLINE);
-    // Bind what is necessary to the command buffer
-    vkCmdBindPipeline(renderInfo.cmdBuffer[bufferIndex],
-                      VK_PIPELINE_BIND_POINT_GRAPHICS, gfxPipelineInfo.pipeline);
-    // As we support dynamic state for viewport and scissor - we must set them here
-    auto viewport = VkViewport{
-            .x = .0f,
-            .y = .1f,
-            .width = (float) swapchainInfo.displaySize.width,
-            .height = (float) swapchainInfo.displaySize.height,
-            .minDepth = .0f,
-            .maxDepth = .1f,
+            .conversion = ycbcrInfo.conversion,
     };
-    vkCmdSetViewport(renderInfo.cmdBuffer[bufferIndex], 0, 1, &viewport);
-    auto scissor = VkRect2D{
-            .offset = {0, 0},
-            .extent = swapchainInfo.displaySize,
+    // filters must match chroma filter and address mode must be clamp to edge for YCbCr samplers
+    const VkSamplerCreateInfo samplerCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .pNext = &conversionInfo,
+            .magFilter = chromaFilter,
+            .minFilter = chromaFilter,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .mipLodBias = 0.0f,
+            .anisotropyEnable = VK_FALSE,
+            .maxAnisotropy = 1,
+            .compareEnable = VK_FALSE,
+            .compareOp = VK_COMPARE_OP_NEVER,
+            .minLod = 0.0f,
+            .maxLod = 0.0f,
+            .borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+            .unnormalizedCoordinates = VK_FALSE,
     };
-    vkCmdSetScissor(renderInfo.cmdBuffer[bufferIndex], 0, 1, &scissor);
-    vkCmdBindDescriptorSets(
-            renderInfo.cmdBuffer[bufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS,
-            gfxPipelineInfo.layout, 0, 1, &gfxPipelineInfo.descSet, 0, nullptr);
-    VkDeviceSize offset = 0;
-    vkCmdBindVertexBuffers(renderInfo.cmdBuffer[bufferIndex], 0, 1,
-                           &buffersInfo.vertexBuf, &offset);
-
-    vkCmdDraw(renderInfo.cmdBuffer[bufferIndex], 4, 1, 0, 0);
-    vkCmdEndRenderPass(renderInfo.cmdBuffer[bufferIndex]);
-    CALL_VK(vkEndCommandBuffer(renderInfo.cmdBuffer[bufferIndex]))
+    CALL_VK(vkCreateSampler(deviceInfo.device, &samplerCreateInfo, nullptr, &ycbcrInfo.sampler))
+    ycbcrInfo.format = formatProperties->format;
+    ycbcrInfo.externalFormat = formatProperties->externalFormat;
+    ycbcrInfo.model = formatProperties->suggestedYcbcrModel;
+    ycbcrInfo.range = formatProperties->suggestedYcbcrRange;
+    ycbcrInfo.xChromaOffset = formatProperties->suggestedXChromaOffset;
+    ycbcrInfo.yChromaOffset = formatProperties->suggestedYChromaOffset;
+    ycbcrInfo.chromaFilter = chromaFilter;
+    ycbcrInfo.descriptorCount = combinedImageSamplerDescriptorCount(formatProperties->format);
+    LOGI("YCbCr conversion created for format %d, external format %llu, model %d, range %d, "
+         "%u descriptors per image", ycbcrInfo.format,
+         static_cast<unsigned long long>(ycbcrInfo.externalFormat), ycbcrInfo.model,
+         ycbcrInfo.range, ycbcrInfo.descriptorCount);
+  }
+  createGraphicsPipeline();
+  createDescriptorSet();
+  LOGI("<-updateYcbcrConversion");
+}
+
+uint32_t VulkanRenderer::combinedImageSamplerDescriptorCount(VkFormat format) const {
+  // external formats could not be queried, one descriptor per plane is the most any driver uses
+  constexpr uint32_t kMaxPlanes = 3;
+  if (format == VK_FORMAT_UNDEFINED) {
+    return kMaxPlanes;
+  }
+  auto vkGetPhysicalDeviceImageFormatProperties2 =
+          (PFN_vkGetPhysicalDeviceImageFormatProperties2) vkGetInstanceProcAddr(
+                  deviceInfo.instance, "vkGetPhysicalDeviceImageFormatProperties2");
+  if (!vkGetPhysicalDeviceImageFormatProperties2) {
+    return kMaxPlanes;
+  }
+  const VkPhysicalDeviceImageFormatInfo2 formatInfo{
+          .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2,
+          .pNext = nullptr,
+          .format = format,
+          .type = VK_IMAGE_TYPE_2D,
+          .tiling = VK_IMAGE_TILING_OPTIMAL,
+          .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+          .flags = 0,
+  };
+  VkSamplerYcbcrConversionImageFormatProperties ycbcrProperties{
+          .sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_IMAGE_FORMAT_PROPERTIES,
+          .pNext = nullptr,
+          .combinedImageSamplerDescriptorCount = 0,
+  };
+  VkImageFormatProperties2 properties{
+          .sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2,
+          .pNext = &ycbcrProperties,
+          .imageFormatProperties = {},
+  };
+  if (vkGetPhysicalDeviceImageFormatProperties2(deviceInfo.gpuDevice, &formatInfo, &properties)
+      != VK_SUCCESS || ycbcrProperties.combinedImageSamplerDescriptorCount == 0) {
+    return kMaxPlanes;
+  }
+  return ycbcrProperties.combinedImageSamplerDescriptorCount;
+}
+
+void VulkanRenderer::destroyGraphicsPipeline() {
+  vkDestroyPipeline(deviceInfo.device, gfxPipelineInfo.pipeline, nullptr);
+  vkDestroyPipelineLayout(deviceInfo.device, gfxPipelineInfo.layout, nullptr);
+  vkDestroyDescriptorSetLayout(deviceInfo.device, gfxPipelineInfo.dscLayout, nullptr);
+  vkDestroyDescriptorPool(deviceInfo.device, gfxPipelineInfo.descPool, nullptr);
+  delete[] gfxPipelineInfo.descWrites;
+  gfxPipelineInfo.descWrites = nullptr;
+}
+
+void VulkanRenderer::destroyYcbcrConversion() {
+  if (ycbcrInfo.conversion == VK_NULL_HANDLE) {
+    return;
   }
+  vkDestroySampler(deviceInfo.device, ycbcrInfo.sampler, nullptr);
+  deviceInfo.destroySamplerYcbcrConversion(deviceInfo.device, ycbcrInfo.conversion, nullptr);
+  ycbcrInfo = {};
+}
+
+void VulkanRenderer::destroyImportedImage(VulkanImportedImage &importedImage) {
+  // no command buffer using the slot is pending anymore, new image gets a new generation
+  renderInfo.freeImageSlots.push_back(importedImage.slot);
+  vkFreeDescriptorSets(deviceInfo.device, gfxPipelineInfo.descPool, 1, &importedImage.descSet);
+  vkDestroyImageView(deviceInfo.device, importedImage.view, nullptr);
+  vkDestroyImage(deviceInfo.device, importedImage.image, nullptr);
+  vkFreeMemory(deviceInfo.device, importedImage.memory, nullptr);
+}
+
+void VulkanRenderer::clearImportedImages() {
+  importedImages.clear([this](VulkanImportedImage &importedImage) {
+    destroyImportedImage(importedImage);
+  });
+  currentImage = nullptr;
+  cameraInitialized = false;
+  invalidateCommandBuffers();
+}
+
+void VulkanRenderer::invalidateCommandBuffers() {
+  std::fill(renderInfo.recordedGenerations.begin(), renderInfo.recordedGenerations.end(), 0);
+}
+
+void VulkanRenderer::recordCommandBuffer(uint32_t imageIndex) {
+  const auto bufferIndex = commandBufferIndex(imageIndex, currentImage->value.slot);
+  // We start by creating and declare the "beginning" our command buffer
+  VkCommandBufferBeginInfo cmdBufferBeginInfo{
+          .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+          .pNext = nullptr,
+          .flags = 0,
+          .pInheritanceInfo = nullptr,
+  };
+  CALL_VK(vkBeginCommandBuffer(renderInfo.cmdBuffer[bufferIndex],
+                               &cmdBufferBeginInfo))
+
+  setImageLayout(renderInfo.cmdBuffer[bufferIndex],
+                 currentImage->value.image,
+                 VK_IMAGE_LAYOUT_UNDEFINED,
+                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                 VK_PIPELINE_STAGE_HOST_BIT,
+                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+  // Now we start a renderpass. Any draw command has to be recorded in a
+  // renderpass
+  VkClearValue clearVals{
+          .color {.float32 {0.9f, 0.3f, 0.0f, 1.0f,}},
+  };
+
+  VkRenderPassBeginInfo renderPassBeginInfo{
+          .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+          .pNext = nullptr,
+          .renderPass = renderInfo.renderPass,
+          .framebuffer = swapchainInfo.framebuffers[imageIndex],
+          .renderArea = {.offset =
+                  {
+                          .x = 0, .y = 0,
+                  },
+                  .extent = swapchainInfo.displaySize},
+          .clearValueCount = 1,
+          .pClearValues = &clearVals};
+  vkCmdBeginRenderPass(renderInfo.cmdBuffer[bufferIndex], &renderPassBeginInfo,
+                       VK_SUBPASS_CONTENTS_INLINE);
+  // Bind what is necessary to the command buffer
+  vkCmdBindPipeline(renderInfo.cmdBuffer[bufferIndex],
+                    VK_PIPELINE_BIND_POINT_GRAPHICS, gfxPipelineInfo.pipeline);
+  // As we support dynamic state for viewport and scissor - we must set them here
+  auto viewport = VkViewport{
+          .x = .0f,
+          .y = .1f,
+          .width = (float) swapchainInfo.displaySize.width,
+          .height = (float) swapchainInfo.displaySize.height,
+          .minDepth = .0f,
+          .maxDepth = .1f,
+  };
+  vkCmdSetViewport(renderInfo.cmdBuffer[bufferIndex], 0, 1, &viewport);
+  auto scissor = VkRect2D{
+          .offset = {0, 0},
+          .extent = swapchainInfo.displaySize,
+  };
+  vkCmdSetScissor(renderInfo.cmdBuffer[bufferIndex], 0, 1, &scissor);
+  const PushConstants pushConstants{.mvp = mvp};
+  vkCmdPushConstants(renderInfo.cmdBuffer[bufferIndex], gfxPipelineInfo.layout,
+                     VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+  vkCmdBindDescriptorSets(
+          renderInfo.cmdBuffer[bufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS,
+          gfxPipelineInfo.layout, 0, 1, &currentImage->value.descSet, 0, nullptr);
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(renderInfo.cmdBuffer[bufferIndex], 0, 1,
+                         &buffersInfo.vertexBuf, &offset);
+
+  vkCmdDraw(renderInfo.cmdBuffer[bufferIndex], 4, 1, 0, 0);
+  vkCmdEndRenderPass(renderInfo.cmdBuffer[bufferIndex]);
+  CALL_VK(vkEndCommandBuffer(renderInfo.cmdBuffer[bufferIndex]))
+  renderInfo.recordedGenerations[bufferIndex] = currentImage->generation;
 }
 
 void VulkanRenderer::onMvpUpdated() {
   if (!deviceInfo.initialized) {
     return;
   }
-  UniformBufferObject ubo{};
-  ubo.mvp = mvp;
-  memcpy(buffersInfo.uniformBufferMapped, &ubo, sizeof(ubo));
-  LOGI("MVP updated");
+  // MVP is baked into command buffers as a push constant, each one is recorded again
+  // right before its next submit, after its previous submit completed
+  invalidateCommandBuffers();
+  BLOG("MVP updated");
 }
 
 void VulkanRenderer::createVertexBuffer() {
@@ -1083,7 +1755,16 @@ void VulkanRenderer::cleanupSwapChain() const {
     vkDestroyFramebuffer(deviceInfo.device, swapchainInfo.framebuffers[i], nullptr);
     vkDestroyImageView(deviceInfo.device, swapchainInfo.displayViews[i], nullptr);
   }
-  vkDestroySwapchainKHR(deviceInfo.device, swapchainInfo.swapchain, nullptr);
+  if (swapchainInfo.swapchain == VK_NULL_HANDLE) {
+    for (uint32_t i = 0; i < swapchainInfo.swapchainLength; ++i) {
+      vkDestroyImage(deviceInfo.device, swapchainInfo.displayImages[i], nullptr);
+      vkFreeMemory(deviceInfo.device, swapchainInfo.displayMemory[i], nullptr);
+    }
+    delete[] swapchainInfo.displayMemory;
+    swapchainInfo.displayMemory = nullptr;
+  } else {
+    vkDestroySwapchainKHR(deviceInfo.device, swapchainInfo.swapchain, nullptr);
+  }
   LOGI("<-cleanupSwapChain");
 }
 
@@ -1093,28 +1774,32 @@ void VulkanRenderer::cleanup() {
     return;
   }
   LOGI("->cleanup");
+  const auto cacheStats = importedImages.stats();
+  LOGI("Imported images: hits=%llu, misses=%llu, evictions=%llu",
+       static_cast<unsigned long long>(cacheStats.hits),
+       static_cast<unsigned long long>(cacheStats.misses),
+       static_cast<unsigned long long>(cacheStats.evictions));
+  clearImportedImages();
+  destroyReadbacks();
   cleanupSwapChain();
-  vkDestroyPipeline(deviceInfo.device, gfxPipelineInfo.pipeline, nullptr);
-  vkDestroyPipelineLayout(deviceInfo.device, gfxPipelineInfo.layout, nullptr);
-  vkDestroyPipelineCache(deviceInfo.device, gfxPipelineInfo.cache, nullptr);
+  destroyGraphicsPipeline();
   vkDestroyRenderPass(deviceInfo.device, renderInfo.renderPass, nullptr);
-  vkDestroySemaphore(deviceInfo.device, renderInfo.semaphore, nullptr);
-  vkDestroyFence(deviceInfo.device, renderInfo.fence, nullptr);
+  for (auto &frame : renderInfo.frames) {
+    vkDestroySemaphore(deviceInfo.device, frame.imageAvailable, nullptr);
+    vkDestroySemaphore(deviceInfo.device, frame.renderFinished, nullptr);
+    vkDestroyFence(deviceInfo.device, frame.fence, nullptr);
+  }
+  renderInfo.frames.clear();
   vkDestroyCommandPool(deviceInfo.device, renderInfo.cmdPool, nullptr);
   vkDestroySampler(deviceInfo.device, externalTextureInfo.sampler, nullptr);
-  if (cameraInitialized) {
-    vkDestroyImage(deviceInfo.device, externalTextureInfo.image, nullptr);
-    vkDestroyImageView(deviceInfo.device, externalTextureInfo.view, nullptr);
-    vkFreeMemory(deviceInfo.device, externalTextureInfo.memory, nullptr);
-  }
-  vkDestroyDescriptorSetLayout(deviceInfo.device, gfxPipelineInfo.dscLayout, nullptr);
-  vkDestroyDescriptorPool(deviceInfo.device, gfxPipelineInfo.descPool, nullptr);
-  vkDestroyBuffer(deviceInfo.device, buffersInfo.uniformBuf, nullptr);
+  destroyYcbcrConversion();
   vkDestroyBuffer(deviceInfo.device, buffersInfo.vertexBuf, nullptr);
-  vkFreeMemory(deviceInfo.device, buffersInfo.uniformBufferMemory, nullptr);
   vkFreeMemory(deviceInfo.device, buffersInfo.vertexBufferMemory, nullptr);
+  pipelineCache.destroy();
   vkDestroyDevice(deviceInfo.device, nullptr);
-  vkDestroySurfaceKHR(deviceInfo.instance, deviceInfo.surface, nullptr);
+  if (deviceInfo.surface != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(deviceInfo.instance, deviceInfo.surface, nullptr);
+  }
   vkDestroyInstance(deviceInfo.instance, nullptr);
   LOGI("<-cleanup");
 }
@@ -1,15 +1,28 @@
 #pragma once
 
 #include <cassert>
+#ifdef ENGINE_RUNTIME_SHADERC
 #include <shaderc/shaderc.hpp>
+#endif
 
 #include "base_renderer.hpp"
+#include "buffer_import_cache.hpp"
+#include "vulkan_pipeline_cache.hpp"
 #include "vulkan_wrapper.h"
 
+// STL
+#include <array>
+#include <chrono>
+
 namespace engine {
 namespace android {
 
 class VulkanRenderer : public BaseRenderer {
+public:
+  ~VulkanRenderer() override {
+    stopRendering();
+  }
+
 protected:
 
   const char *renderingModeName() override {
@@ -22,6 +35,7 @@ protected:
       return false;
     }
     LOGI("->onWindowCreated");
+    const auto start = std::chrono::steady_clock::now();
     VkApplicationInfo appInfo = {
             .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
             .pNext = nullptr,
@@ -33,16 +47,20 @@ protected:
     };
 
     createVulkanDevice(&appInfo);
+    VkPhysicalDeviceProperties gpuProperties;
+    vkGetPhysicalDeviceProperties(deviceInfo.gpuDevice, &gpuProperties);
+    pipelineCache.create(deviceInfo.device, gpuProperties, cacheDirectory);
     createSwapChain();
     createRenderPass();
     createFrameBuffersAndImages();
     createVertexBuffer();
-    createUniformBuffer();
     createGraphicsPipeline();
     createDescriptorSet();
     createOtherStaff();
     deviceInfo.initialized = true;
-    LOGI("<-onWindowCreated");
+    LOGI("<-onWindowCreated in %lld us", static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count()));
     return true;
   }
 
@@ -73,7 +91,10 @@ protected:
   }
 
   void render() override {
+    const auto start = std::chrono::steady_clock::now();
     renderImpl();
+    updateFrameCpuTime(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
   }
 
   void postChoreographerCallback() override {
@@ -82,37 +103,32 @@ protected:
     AChoreographer_postFrameCallback(aChoreographer, doFrame, this);
   }
 
-private:
-  ///////// Shaders
-  const char *vertexShaderSource = "#version 450\n"
-                                   "#extension GL_ARB_separate_shader_objects : enable\n"
-                                   "#extension GL_ARB_shading_language_420pack : enable\n"
-                                   "layout (binding = 0) uniform UniformBufferObject {\n"
-                                   "    mat4 mvp;\n"
-                                   "} ubo;\n"
-                                   "layout (location = 0) in vec2 pos;\n"
-                                   "layout (location = 1) in vec2 attr;\n"
-                                   "layout (location = 0) out vec2 texcoord;\n"
-                                   "void main() {\n"
-                                   "   texcoord = attr;\n"
-                                   "   gl_Position = ubo.mvp * vec4(pos, 0.0, 1.0);\n"
-                                   "}";
-
-  const char  *fragmentShaderSource = "#version 450\n"
-                                      "#extension GL_ARB_separate_shader_objects : enable\n"
-                                      "#extension GL_ARB_shading_language_420pack : enable\n"
-                                      "layout (binding = 1) uniform sampler2D tex;\n"
-                                      "layout (location = 0) in vec2 texcoord;\n"
-                                      "layout (location = 0) out vec4 uFragColor;\n"
-                                      "void main() {\n"
-                                      "   uFragColor = texture(tex, texcoord);\n"
-                                      "}";
+  bool supportsReadback(CaptureMethod method) const override {
+    // swapchain images are copied from in between draw and present
+    return method == CaptureMethod::VulkanStagingCopy && (headless || swapchainReadable);
+  }
+
+  bool startReadback(CaptureRequest &request) override;
 
+  bool pollReadbacks() override {
+    return completeReadbacks(false);
+  }
+
+  uint64_t submittedDrawSerial() const override {
+    return deviceInfo.initialized ? renderInfo.submitSerial : 0;
+  }
+
+  uint64_t completedDrawSerial() override;
+
+private:
   ///////// Structs and variables
 
   bool cameraInitialized;
 
-  struct UniformBufferObject {
+  /**
+   * Vertex shader push constants, recorded into command buffers together with the draw.
+   */
+  struct PushConstants {
     glm::mat4 mvp;
   };
 
@@ -127,6 +143,11 @@ private:
 
     VkSurfaceKHR surface;
     VkQueue queue;
+
+    bool ycbcrConversionSupported;
+    // resolved for the device once it is created, null unless the conversion is supported
+    PFN_vkCreateSamplerYcbcrConversion createSamplerYcbcrConversion;
+    PFN_vkDestroySamplerYcbcrConversion destroySamplerYcbcrConversion;
   };
   VulkanDeviceInfo deviceInfo;
 
@@ -141,46 +162,146 @@ private:
     VkFramebuffer* framebuffers;
     VkImage* displayImages;
     VkImageView* displayViews;
+    // headless only, display images are owned by the renderer and not by a swapchain
+    VkDeviceMemory* displayMemory;
   };
   VulkanSwapchainInfo swapchainInfo;
+  // swapchain images could be a transfer source, required for staging copy captures
+  bool swapchainReadable = false;
 
   struct VulkanExternalTextureInfo {
     VkSampler sampler;
+  };
+  VulkanExternalTextureInfo externalTextureInfo;
+
+  /**
+   * Camera buffer imported as Vulkan image together with the descriptor set sampling it.
+   */
+  struct VulkanImportedImage {
     VkImage image;
     VkDeviceMemory memory;
     VkImageView view;
+    VkDescriptorSet descSet;
+    // column of command buffers drawing this image, one per swapchain image
+    uint32_t slot;
   };
-  VulkanExternalTextureInfo externalTextureInfo;
+  using ImportedImageCache = BufferImportCache<VulkanImportedImage>;
+  /**
+   * Camera producers cycle through a few buffers, each one is imported once and reused afterwards.
+   */
+  ImportedImageCache importedImages;
+  // entry bound for rendering, always the most recently used one
+  ImportedImageCache::Entry *currentImage = nullptr;
+
+  /**
+   * Immutable sampler with YCbCr conversion used for YUV camera buffers (Camera2 PRIVATE format),
+   * handles are VK_NULL_HANDLE while camera buffers are RGBA.
+   */
+  struct VulkanYcbcrInfo {
+    VkFormat format;
+    uint64_t externalFormat;
+    VkSamplerYcbcrModelConversion model;
+    VkSamplerYcbcrRange range;
+    VkChromaLocation xChromaOffset;
+    VkChromaLocation yChromaOffset;
+    VkFilter chromaFilter;
+    VkSamplerYcbcrConversion conversion;
+    VkSampler sampler;
+    // combined image sampler descriptors an image sampled through it consumes
+    uint32_t descriptorCount;
+  };
+  VulkanYcbcrInfo ycbcrInfo{};
 
   struct VulkanBuffersInfo {
     VkBuffer vertexBuf;
-    VkBuffer uniformBuf;
-    VkDeviceMemory uniformBufferMemory;
     VkDeviceMemory vertexBufferMemory;
-    void* uniformBufferMapped;
   };
   VulkanBuffersInfo buffersInfo;
 
   struct VulkanGfxPipelineInfo {
     VkDescriptorSetLayout dscLayout;
+    // descriptor sets are owned by imported images
     VkDescriptorPool descPool;
-    VkDescriptorSet descSet;
     VkPipelineLayout layout;
-    VkPipelineCache cache;
     VkPipeline pipeline;
     VkWriteDescriptorSet* descWrites;
   };
   VulkanGfxPipelineInfo gfxPipelineInfo;
 
+  /**
+   * Outlives pipelines re-created for YCbCr conversion changes, saved after the first presented frame.
+   */
+  VulkanPipelineCache pipelineCache;
+
+  /**
+   * Synchronization of one frame in flight, CPU only waits for its fence when the slot comes around again.
+   */
+  struct VulkanFrameInfo {
+    VkFence fence;
+    VkSemaphore imageAvailable;
+    VkSemaphore renderFinished;
+    // submit serial of the last frame rendered in this slot
+    uint64_t serial;
+  };
+
+  static constexpr uint32_t kDefaultFramesInFlight = 2;
+
+  // imported images alive at once, retired ones included, same bound as the descriptor pool
+  static constexpr uint32_t kImageSlots = 2 * ImportedImageCache::kDefaultCapacity;
+
   struct VulkanRenderInfo {
     VkRenderPass renderPass;
     VkCommandPool cmdPool;
+    // one per swapchain image and imported image slot, see commandBufferIndex
     VkCommandBuffer* cmdBuffer;
     uint32_t cmdBufferLen;
-    VkSemaphore semaphore;
-    VkFence fence;
+    // imported image generation each command buffer was recorded with, 0 if it has to be recorded
+    std::vector<uint64_t> recordedGenerations;
+    std::vector<uint32_t> freeImageSlots;
+    // fence of the frame last rendered into each swapchain image, its command buffer is pending until then
+    std::vector<VkFence> imagesInFlight;
+    std::vector<VulkanFrameInfo> frames;
+    uint32_t frameIndex;
+    // incremented per queue submit, imported images are destroyed and camera frames handed back
+    // once their last one completed
+    uint64_t submitSerial;
+    uint64_t completedSerial;
   };
   VulkanRenderInfo renderInfo;
+  uint32_t framesInFlight = kDefaultFramesInFlight;
+
+  /**
+   * Copy of a drawn image into a persistently mapped staging buffer, created on first capture.
+   * Copy is chained in between draw and present with copyFinished, CPU only looks at the fence.
+   */
+  struct VulkanReadback {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    void *mapped;
+    VkDeviceSize size;
+    uint32_t width;
+    uint32_t height;
+    VkCommandBuffer cmdBuffer;
+    VkFence fence;
+    VkSemaphore copyFinished;
+    bool inFlight;
+    CaptureRequest request;
+  };
+  std::array<VulkanReadback, 2> readbacks{};
+  // image the last submitted draw went into and what its present has to wait for
+  uint32_t drawnImageIndex = 0;
+  VkSemaphore presentWait = VK_NULL_HANDLE;
+
+  /**
+   * Render thread CPU time spent per frame, logged every kFrameCpuTimeLogInterval frames.
+   */
+  struct FrameCpuTime {
+    uint64_t frames;
+    int64_t totalMicros;
+    int64_t maxMicros;
+  };
+  static constexpr uint64_t kFrameCpuTimeLogInterval = 300;
+  FrameCpuTime frameCpuTime{};
 
   ///////// Create functions
 
@@ -192,26 +313,71 @@ private:
 
   void createFrameBuffersAndImages();
 
+  /**
+   * Color attachment of display size used in headless mode instead of a swapchain image.
+   */
+  void createOffscreenImage(VkImage &image, VkDeviceMemory &memory);
+
   void createVertexBuffer();
 
   void createGraphicsPipeline();
 
   void createDescriptorSet();
 
-  void createUniformBuffer();
-
   void createOtherStaff();
 
-  void recordCommandBuffer();
+  /**
+   * Records drawing of the current image into the given swapchain image, command buffer is
+   * reused as long as swapchain, MVP and the image in its slot stay the same.
+   */
+  void recordCommandBuffer(uint32_t imageIndex);
+
+  uint32_t commandBufferIndex(uint32_t imageIndex, uint32_t slot) const {
+    return imageIndex * kImageSlots + slot;
+  }
+
+  /**
+   * Every command buffer gets recorded again on next use.
+   */
+  void invalidateCommandBuffers();
 
   ////// Destroy functions
 
   void cleanupSwapChain() const;
 
+  void recreateSwapChain();
+
   void cleanup();
 
+  void destroyGraphicsPipeline();
+
+  void destroyYcbcrConversion();
+
+  void destroyImportedImage(VulkanImportedImage &importedImage);
+
+  /**
+   * Destroys every imported image right away, GPU must be idle.
+   */
+  void clearImportedImages();
+
+  /**
+   * Finishes readbacks whose fence signalled, waits for all of them if wait is set.
+   * Returns true while any is still in flight.
+   */
+  bool completeReadbacks(bool wait);
+
+  /**
+   * Readbacks still in flight are waited for.
+   */
+  void destroyReadbacks();
+
   ////// Helper functions
 
+  /**
+   * Host visible staging buffer of the given size, cached memory preferred as the CPU reads it.
+   */
+  void createReadbackBuffer(VulkanReadback &readback, VkDeviceSize size);
+
   void mapMemoryTypeToIndex(uint32_t typeBits, VkFlags requirements_mask, uint32_t* typeIndex) const;
 
   void createBuffer(VkDeviceSize size,
@@ -225,17 +391,51 @@ private:
                       VkPipelineStageFlags srcStages,
                       VkPipelineStageFlags destStages);
 
+  static bool needsYcbcrConversion(const VkAndroidHardwareBufferFormatPropertiesANDROID &formatProperties);
+
+  /**
+   * (Re)creates YCbCr conversion and immutable sampler matching camera buffer format together with
+   * pipeline and descriptor set using it. Passing nullptr switches back to the regular sampler.
+   */
+  void updateYcbcrConversion(const VkAndroidHardwareBufferFormatPropertiesANDROID *formatProperties);
+
+  /**
+   * Descriptors the driver reports for sampling a YCbCr format, the most it could use for
+   * external formats which could not be queried.
+   */
+  uint32_t combinedImageSamplerDescriptorCount(VkFormat format) const;
+
+  /**
+   * Imports camera buffer as a new image with its own descriptor set.
+   * Returns false if the buffer could not be sampled.
+   */
+  bool importHwBuffer(AHardwareBuffer *buffer, VulkanImportedImage &importedImage);
+
+  /**
+   * Shader module from SPIR-V compiled at build time, see shaders.cmake.
+   */
+  static VkResult createShaderModule(const uint32_t *code,
+                                     size_t codeSize,
+                                     VkDevice vkDevice,
+                                     VkShaderModule *shaderOut);
+
+  void createShaderModules(VkShaderModule *vertexShader, VkShaderModule *fragmentShader) const;
+
+#ifdef ENGINE_RUNTIME_SHADERC
   static VkResult buildShaderFromFile(const char* shaderSource,
                                VkShaderStageFlagBits type,
                                VkDevice vkDevice,
                                VkShaderModule* shaderOut);
 
   static shaderc_shader_kind getShadercShaderType(VkShaderStageFlagBits type);
+#endif
 
   ///////// Callbacks for AChoreographer and ALooper stored as private static functions
 
   void renderImpl();
 
+  void updateFrameCpuTime(int64_t micros);
+
   static void doFrame(long timeStampNanos, void *data);
 };
 } // namespace android
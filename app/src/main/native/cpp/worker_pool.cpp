@@ -0,0 +1,113 @@
+#include "worker_pool.hpp"
+
+#include <pthread.h>
+
+// STL
+#include <algorithm>
+
+namespace engine {
+namespace android {
+
+size_t WorkerPool::defaultThreadCount() {
+  const size_t cores = std::thread::hardware_concurrency();
+  return std::max<size_t>(1, std::min(cores, kMaxDefaultThreads));
+}
+
+WorkerPool::WorkerPool(size_t threadCount) {
+  for (size_t i = 1; i < threadCount; ++i) {
+    workers.emplace_back([this] {
+      pthread_setname_np(pthread_self(), "EngineWorker");
+      workerLoop();
+    });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobCondition.notify_all();
+  for (auto &worker: workers) {
+    worker.join();
+  }
+}
+
+void WorkerPool::parallelFor(size_t count, const StripeTask &stripeTask) {
+  if (count == 0) {
+    return;
+  }
+  if (workers.empty() || count == 1) {
+    for (size_t stripe = 0; stripe < count; ++stripe) {
+      stripeTask(stripe, count);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    task = &stripeTask;
+    stripeCount = count;
+    stripesDone = 0;
+    nextStripe.store(0, std::memory_order_relaxed);
+    ++jobGeneration;
+  }
+  jobCondition.notify_all();
+  runStripes();
+  std::unique_lock<std::mutex> lock(mutex);
+  // workers still inside runStripes could otherwise pick up stripes of the next job with this task
+  doneCondition.wait(lock, [this] { return stripesDone == stripeCount && activeWorkers == 0; });
+  task = nullptr;
+}
+
+std::pair<size_t, size_t> WorkerPool::stripeRows(size_t rows, size_t stripe, size_t count) {
+  const size_t rowsPerStripe = (rows + count - 1) / count;
+  const size_t first = std::min(rows, stripe * rowsPerStripe);
+  const size_t last = std::min(rows, first + rowsPerStripe);
+  return {first, last};
+}
+
+void WorkerPool::workerLoop() {
+  uint64_t seenGeneration = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobCondition.wait(lock, [&] { return stopping || jobGeneration != seenGeneration; });
+      if (stopping) {
+        return;
+      }
+      seenGeneration = jobGeneration;
+    }
+    runStripes();
+  }
+}
+
+void WorkerPool::runStripes() {
+  const StripeTask *currentTask;
+  size_t count;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    currentTask = task;
+    count = stripeCount;
+    if (!currentTask) {
+      // woke up too late, job is already finished
+      return;
+    }
+    ++activeWorkers;
+  }
+  size_t done = 0;
+  for (size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed);
+       stripe < count;
+       stripe = nextStripe.fetch_add(1, std::memory_order_relaxed)) {
+    (*currentTask)(stripe, count);
+    ++done;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  stripesDone += done;
+  --activeWorkers;
+  if (stripesDone == stripeCount && activeWorkers == 0) {
+    doneCondition.notify_one();
+  }
+}
+
+} // namespace android
+} // namespace engine
@@ -0,0 +1,75 @@
+#pragma once
+
+// STL
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+/**
+ * Small persistent pool of native threads splitting a job into stripes.
+ * Calling thread takes part in the job as well so pool of N threads spawns N - 1 workers.
+ */
+class WorkerPool {
+public:
+  using StripeTask = std::function<void(size_t stripe, size_t stripeCount)>;
+
+  static constexpr size_t kMaxDefaultThreads = 4;
+
+  /**
+   * Hardware concurrency capped by kMaxDefaultThreads - copying is memory bound anyway
+   * and we do not want to wake up every little core for that.
+   */
+  static size_t defaultThreadCount();
+
+  explicit WorkerPool(size_t threadCount = defaultThreadCount());
+
+  WorkerPool(WorkerPool const &) = delete;
+
+  ~WorkerPool();
+
+  size_t threadCount() const { return workers.size() + 1; }
+
+  /**
+   * Runs task for every stripe in [0, stripeCount) and returns once all of them are done,
+   * acts as a join barrier. Not re-entrant, expected to be called from one thread at a time.
+   */
+  void parallelFor(size_t stripeCount, const StripeTask &task);
+
+  /**
+   * Rows [first, last) stripe `stripe` out of `stripeCount` should process.
+   */
+  static std::pair<size_t, size_t> stripeRows(size_t rows, size_t stripe, size_t stripeCount);
+
+private:
+  void workerLoop();
+
+  void runStripes();
+
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable jobCondition;
+  std::condition_variable doneCondition;
+
+  // job description, guarded by mutex
+  const StripeTask *task = nullptr;
+  size_t stripeCount = 0;
+  uint64_t jobGeneration = 0;
+  size_t stripesDone = 0;
+  // threads (calling one included) currently executing stripes of the job
+  size_t activeWorkers = 0;
+  bool stopping = false;
+
+  std::atomic<size_t> nextStripe{0};
+};
+
+} // namespace android
+} // namespace engine
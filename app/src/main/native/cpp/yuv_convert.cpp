@@ -0,0 +1,282 @@
+#include "yuv_convert.hpp"
+
+#include "worker_pool.hpp"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// STL
+#include <cmath>
+#include <cstring>
+
+namespace engine {
+namespace android {
+
+namespace {
+
+// 13 bit fixed point keeps every coefficient inside int16 which SSE2 madd requires
+constexpr int kShift = 13;
+constexpr int32_t kRound = 1 << (kShift - 1);
+
+struct Coefficients {
+  int16_t yOffset;
+  int16_t ky;
+  int16_t kvr;
+  int16_t kug;
+  int16_t kvg;
+  int16_t kub;
+};
+
+int16_t toFixed(double value) {
+  return static_cast<int16_t>(std::lround(value * (1 << kShift)));
+}
+
+Coefficients coefficients(YuvMatrix matrix, YuvRange range) {
+  const double kr = matrix == YuvMatrix::Bt601 ? 0.299 : 0.2126;
+  const double kb = matrix == YuvMatrix::Bt601 ? 0.114 : 0.0722;
+  const double kg = 1.0 - kr - kb;
+  const bool limited = range == YuvRange::Limited;
+  const double yScale = limited ? 255.0 / 219.0 : 1.0;
+  const double cScale = limited ? 255.0 / 224.0 : 1.0;
+  return Coefficients{
+          .yOffset = static_cast<int16_t>(limited ? 16 : 0),
+          .ky = toFixed(yScale),
+          .kvr = toFixed(2.0 * (1.0 - kr) * cScale),
+          .kug = toFixed(2.0 * kb * (1.0 - kb) / kg * cScale),
+          .kvg = toFixed(2.0 * kr * (1.0 - kr) / kg * cScale),
+          .kub = toFixed(2.0 * (1.0 - kb) * cScale),
+  };
+}
+
+uint8_t clampToByte(int32_t value) {
+  return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+void convertRowScalar(const Coefficients &c,
+                      const uint8_t *yRow, const uint8_t *uRow, const uint8_t *vRow,
+                      size_t pixelStride, uint8_t *dst, size_t x, size_t width) {
+  for (; x < width; ++x) {
+    const size_t chroma = (x / 2) * pixelStride;
+    const int32_t yy = (yRow[x] - c.yOffset) * c.ky + kRound;
+    const int32_t u = uRow[chroma] - 128;
+    const int32_t v = vRow[chroma] - 128;
+    uint8_t *pixel = dst + x * 4;
+    pixel[0] = clampToByte((yy + v * c.kvr) >> kShift);
+    pixel[1] = clampToByte((yy - u * c.kug - v * c.kvg) >> kShift);
+    pixel[2] = clampToByte((yy + u * c.kub) >> kShift);
+    pixel[3] = 255;
+  }
+}
+
+#if defined(__ARM_NEON)
+
+constexpr const char *kKernelName = "NEON";
+
+/**
+ * 16 pixels per iteration, returns number of pixels converted - the rest is done by scalar code.
+ */
+size_t convertRowSimd(const Coefficients &c,
+                      const uint8_t *yRow, const uint8_t *uRow, const uint8_t *vRow,
+                      size_t pixelStride, uint8_t *dst, size_t width) {
+  if (pixelStride != 1 && pixelStride != 2) {
+    return 0;
+  }
+  const int16x8_t yOffset = vdupq_n_s16(c.yOffset);
+  const int16x8_t chromaOffset = vdupq_n_s16(128);
+  const int32x4_t round = vdupq_n_s32(kRound);
+  // semi-planar chroma is read 16 bytes at a time and v is one byte after u, keep a byte of margin
+  const size_t limit = pixelStride == 1 ? width : (width > 0 ? width - 1 : 0);
+
+  // converts 4 pixels, result is narrowed with saturation exactly like the scalar clamp
+  const auto channels = [&](int16x4_t y, int16x4_t u, int16x4_t v,
+                            uint16x4_t &r, uint16x4_t &g, uint16x4_t &b) {
+    const int32x4_t yy = vaddq_s32(vmull_n_s16(y, c.ky), round);
+    r = vqshrun_n_s32(vmlal_n_s16(yy, v, c.kvr), kShift);
+    g = vqshrun_n_s32(vmlsl_n_s16(vmlsl_n_s16(yy, u, c.kug), v, c.kvg), kShift);
+    b = vqshrun_n_s32(vmlal_n_s16(yy, u, c.kub), kShift);
+  };
+  // converts 8 pixels
+  const auto half = [&](uint8x8_t y8, uint8x8_t u8, uint8x8_t v8,
+                        uint8x8_t &r, uint8x8_t &g, uint8x8_t &b) {
+    const int16x8_t y = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y8)), yOffset);
+    const int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), chromaOffset);
+    const int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), chromaOffset);
+    uint16x4_t rLow, gLow, bLow, rHigh, gHigh, bHigh;
+    channels(vget_low_s16(y), vget_low_s16(u), vget_low_s16(v), rLow, gLow, bLow);
+    channels(vget_high_s16(y), vget_high_s16(u), vget_high_s16(v), rHigh, gHigh, bHigh);
+    r = vqmovn_u16(vcombine_u16(rLow, rHigh));
+    g = vqmovn_u16(vcombine_u16(gLow, gHigh));
+    b = vqmovn_u16(vcombine_u16(bLow, bHigh));
+  };
+
+  size_t x = 0;
+  for (; x + 16 <= limit; x += 16) {
+    const uint8x16_t y = vld1q_u8(yRow + x);
+    uint8x8_t u, v;
+    if (pixelStride == 1) {
+      u = vld1_u8(uRow + x / 2);
+      v = vld1_u8(vRow + x / 2);
+    } else {
+      u = vld2_u8(uRow + x).val[0];
+      v = vld2_u8(vRow + x).val[0];
+    }
+    // every chroma sample covers two pixels
+    const uint8x8x2_t uu = vzip_u8(u, u);
+    const uint8x8x2_t vv = vzip_u8(v, v);
+    uint8x8_t rLow, gLow, bLow, rHigh, gHigh, bHigh;
+    half(vget_low_u8(y), uu.val[0], vv.val[0], rLow, gLow, bLow);
+    half(vget_high_u8(y), uu.val[1], vv.val[1], rHigh, gHigh, bHigh);
+    uint8x16x4_t rgba;
+    rgba.val[0] = vcombine_u8(rLow, rHigh);
+    rgba.val[1] = vcombine_u8(gLow, gHigh);
+    rgba.val[2] = vcombine_u8(bLow, bHigh);
+    rgba.val[3] = vdupq_n_u8(255);
+    vst4q_u8(dst + x * 4, rgba);
+  }
+  return x;
+}
+
+#elif defined(__SSE2__)
+
+constexpr const char *kKernelName = "SSE2";
+
+__m128i coefficientPair(int16_t low, int16_t high) {
+  return _mm_set1_epi32(static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint16_t>(low)) |
+                                             (static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16)));
+}
+
+__m128i loadChroma(const uint8_t *row, size_t x, size_t pixelStride) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i chroma;
+  if (pixelStride == 1) {
+    int32_t packed;
+    memcpy(&packed, row + x / 2, sizeof(packed));
+    chroma = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+  } else {
+    // low byte of every 16 bit lane is the sample we need
+    chroma = _mm_and_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(row + x)),
+                           _mm_set1_epi16(0x00ff));
+  }
+  // every chroma sample covers two pixels
+  return _mm_sub_epi16(_mm_unpacklo_epi16(chroma, chroma), _mm_set1_epi16(128));
+}
+
+__m128i narrow(__m128i low, __m128i high) {
+  return _mm_packs_epi32(_mm_srai_epi32(low, kShift), _mm_srai_epi32(high, kShift));
+}
+
+/**
+ * 8 pixels per iteration, returns number of pixels converted - the rest is done by scalar code.
+ */
+size_t convertRowSimd(const Coefficients &c,
+                      const uint8_t *yRow, const uint8_t *uRow, const uint8_t *vRow,
+                      size_t pixelStride, uint8_t *dst, size_t width) {
+  if (pixelStride != 1 && pixelStride != 2) {
+    return 0;
+  }
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i yOffset = _mm_set1_epi16(c.yOffset);
+  const __m128i round = _mm_set1_epi32(kRound);
+  const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xff));
+  const __m128i kR = coefficientPair(c.ky, c.kvr);
+  const __m128i kB = coefficientPair(c.ky, c.kub);
+  const __m128i kG = coefficientPair(static_cast<int16_t>(-c.kug), static_cast<int16_t>(-c.kvg));
+  const __m128i kY = coefficientPair(c.ky, 0);
+  // semi-planar chroma is read 8 bytes at a time and v is one byte after u, keep a byte of margin
+  const size_t limit = pixelStride == 1 ? width : (width > 0 ? width - 1 : 0);
+
+  size_t x = 0;
+  for (; x + 8 <= limit; x += 8) {
+    const __m128i y = _mm_sub_epi16(
+            _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(yRow + x)), zero),
+            yOffset);
+    const __m128i u = loadChroma(uRow, x, pixelStride);
+    const __m128i v = loadChroma(vRow, x, pixelStride);
+
+    const __m128i yvLow = _mm_unpacklo_epi16(y, v);
+    const __m128i yvHigh = _mm_unpackhi_epi16(y, v);
+    const __m128i yuLow = _mm_unpacklo_epi16(y, u);
+    const __m128i yuHigh = _mm_unpackhi_epi16(y, u);
+    const __m128i uvLow = _mm_unpacklo_epi16(u, v);
+    const __m128i uvHigh = _mm_unpackhi_epi16(u, v);
+    const __m128i yyLow = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y, zero), kY), round);
+    const __m128i yyHigh = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y, zero), kY), round);
+
+    const __m128i r = narrow(_mm_add_epi32(_mm_madd_epi16(yvLow, kR), round),
+                             _mm_add_epi32(_mm_madd_epi16(yvHigh, kR), round));
+    const __m128i g = narrow(_mm_add_epi32(_mm_madd_epi16(uvLow, kG), yyLow),
+                             _mm_add_epi32(_mm_madd_epi16(uvHigh, kG), yyHigh));
+    const __m128i b = narrow(_mm_add_epi32(_mm_madd_epi16(yuLow, kB), round),
+                             _mm_add_epi32(_mm_madd_epi16(yuHigh, kB), round));
+
+    // saturate to [0, 255] and interleave into RGBA
+    const __m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(r, zero), _mm_packus_epi16(g, zero));
+    const __m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(b, zero), alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+  }
+  return x;
+}
+
+#else
+
+constexpr const char *kKernelName = "scalar";
+
+size_t convertRowSimd(const Coefficients &, const uint8_t *, const uint8_t *, const uint8_t *,
+                      size_t, uint8_t *, size_t) {
+  return 0;
+}
+
+#endif
+
+} // namespace
+
+void yuvToRgba(const YuvPlanes &planes,
+               uint8_t *dst, size_t dstStride,
+               size_t width, size_t firstRow, size_t lastRow,
+               YuvMatrix matrix, YuvRange range) {
+  const auto c = coefficients(matrix, range);
+  for (size_t row = firstRow; row < lastRow; ++row) {
+    const uint8_t *yRow = planes.y + row * planes.yRowStride;
+    const uint8_t *uRow = planes.u + (row / 2) * planes.uvRowStride;
+    const uint8_t *vRow = planes.v + (row / 2) * planes.uvRowStride;
+    uint8_t *dstRow = dst + row * dstStride;
+    const size_t done = convertRowSimd(c, yRow, uRow, vRow, planes.uvPixelStride, dstRow, width);
+    convertRowScalar(c, yRow, uRow, vRow, planes.uvPixelStride, dstRow, done, width);
+  }
+}
+
+void yuvToRgbaStriped(WorkerPool &pool, size_t stripes,
+                      const YuvPlanes &planes,
+                      uint8_t *dst, size_t dstStride,
+                      size_t width, size_t height,
+                      YuvMatrix matrix, YuvRange range) {
+  pool.parallelFor(stripes, [&](size_t stripe, size_t stripeCount) {
+    const auto rows = WorkerPool::stripeRows(height, stripe, stripeCount);
+    yuvToRgba(planes, dst, dstStride, width, rows.first, rows.second, matrix, range);
+  });
+}
+
+void yuvToRgbaScalar(const YuvPlanes &planes,
+                     uint8_t *dst, size_t dstStride,
+                     size_t width, size_t firstRow, size_t lastRow,
+                     YuvMatrix matrix, YuvRange range) {
+  const auto c = coefficients(matrix, range);
+  for (size_t row = firstRow; row < lastRow; ++row) {
+    convertRowScalar(c,
+                     planes.y + row * planes.yRowStride,
+                     planes.u + (row / 2) * planes.uvRowStride,
+                     planes.v + (row / 2) * planes.uvRowStride,
+                     planes.uvPixelStride, dst + row * dstStride, 0, width);
+  }
+}
+
+const char *yuvKernelName() {
+  return kKernelName;
+}
+
+} // namespace android
+} // namespace engine
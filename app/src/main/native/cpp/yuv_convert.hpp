@@ -0,0 +1,69 @@
+#pragma once
+
+// STL
+#include <cstddef>
+#include <cstdint>
+
+namespace engine {
+namespace android {
+
+class WorkerPool;
+
+enum class YuvMatrix {
+  Bt601,
+  Bt709,
+};
+
+enum class YuvRange {
+  // JFIF, what Android camera uses for YUV_420_888
+  Full,
+  // Y in [16, 235], chroma in [16, 240]
+  Limited,
+};
+
+/**
+ * 4:2:0 frame as returned by AHardwareBuffer_lockPlanes. Covers planar (I420 / YV12, pixel stride 1)
+ * and semi-planar (NV12 / NV21, pixel stride 2) layouts, any other pixel stride is handled as well
+ * but without SIMD.
+ */
+struct YuvPlanes {
+  const uint8_t *y = nullptr;
+  const uint8_t *u = nullptr;
+  const uint8_t *v = nullptr;
+  size_t yRowStride = 0;
+  size_t uvRowStride = 0;
+  size_t uvPixelStride = 1;
+};
+
+/**
+ * Converts rows [firstRow, lastRow) of the frame into RGBA 8888, alpha is always 255.
+ */
+void yuvToRgba(const YuvPlanes &planes,
+               uint8_t *dst, size_t dstStride,
+               size_t width, size_t firstRow, size_t lastRow,
+               YuvMatrix matrix, YuvRange range);
+
+/**
+ * Splits the conversion into `stripes` horizontal stripes processed in parallel on the pool.
+ */
+void yuvToRgbaStriped(WorkerPool &pool, size_t stripes,
+                      const YuvPlanes &planes,
+                      uint8_t *dst, size_t dstStride,
+                      size_t width, size_t height,
+                      YuvMatrix matrix, YuvRange range);
+
+/**
+ * Scalar reference using the same fixed point math, SIMD kernels must match it bit exactly.
+ */
+void yuvToRgbaScalar(const YuvPlanes &planes,
+                     uint8_t *dst, size_t dstStride,
+                     size_t width, size_t firstRow, size_t lastRow,
+                     YuvMatrix matrix, YuvRange range);
+
+/**
+ * Name of the SIMD kernel compiled in, for logs and benchmarks.
+ */
+const char *yuvKernelName();
+
+} // namespace android
+} // namespace engine
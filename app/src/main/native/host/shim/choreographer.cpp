@@ -0,0 +1,187 @@
+#include <android/choreographer.h>
+#include <android/looper.h>
+
+#include "android_shim.h"
+
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+// STL
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+std::atomic<int64_t> vsyncPeriodNanos{16666667};
+
+int64_t monotonicNanos() {
+  timespec now{};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+} // namespace
+
+/**
+ * Fires vsync ticks on a fixed grid with a timerfd registered on the owning thread's looper,
+ * the timer is only armed while there are callbacks waiting - like the real one it does not tick idle.
+ */
+struct AChoreographer {
+  explicit AChoreographer(ALooper *looper);
+
+  ~AChoreographer();
+
+  void post(AChoreographer_frameCallback callback, AChoreographer_frameCallback64 callback64,
+            void *data, int64_t delayNanos);
+
+private:
+  struct Callback {
+    AChoreographer_frameCallback callback;
+    AChoreographer_frameCallback64 callback64;
+    void *data;
+    int64_t dueNanos;
+  };
+
+  int onTimer();
+
+  /**
+   * Arms the timer for the first vsync after dueNanos unless it already fires earlier, mutex must be held.
+   */
+  void armLocked(int64_t dueNanos);
+
+  ALooper *looper;
+  int timerFd;
+  const int64_t periodNanos;
+  const int64_t originNanos;
+
+  std::mutex mutex;
+  std::vector<Callback> callbacks;
+  // 0 when timer is disarmed
+  int64_t armedVsyncNanos = 0;
+};
+
+namespace {
+
+/**
+ * Choreographer is per thread and lives until the thread exits, like in the platform.
+ */
+struct ThreadChoreographer {
+  ~ThreadChoreographer() {
+    delete choreographer;
+  }
+
+  AChoreographer *choreographer = nullptr;
+};
+
+thread_local ThreadChoreographer threadChoreographer;
+
+} // namespace
+
+AChoreographer::AChoreographer(ALooper *looper)
+        : looper(looper),
+          timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+          periodNanos(vsyncPeriodNanos.load()),
+          originNanos(monotonicNanos()) {
+  ALooper_acquire(looper);
+  ALooper_addFd(looper, timerFd, ALOOPER_POLL_CALLBACK, ALOOPER_EVENT_INPUT,
+                [](int, int, void *data) -> int {
+                  return static_cast<AChoreographer *>(data)->onTimer();
+                },
+                this);
+}
+
+AChoreographer::~AChoreographer() {
+  ALooper_removeFd(looper, timerFd);
+  close(timerFd);
+  ALooper_release(looper);
+}
+
+void AChoreographer::post(AChoreographer_frameCallback callback,
+                          AChoreographer_frameCallback64 callback64,
+                          void *data, int64_t delayNanos) {
+  const int64_t dueNanos = monotonicNanos() + delayNanos;
+  std::lock_guard<std::mutex> lock(mutex);
+  callbacks.push_back(Callback{callback, callback64, data, dueNanos});
+  armLocked(dueNanos);
+}
+
+void AChoreographer::armLocked(int64_t dueNanos) {
+  const int64_t vsyncNanos = originNanos + ((dueNanos - originNanos) / periodNanos + 1) * periodNanos;
+  if (armedVsyncNanos != 0 && armedVsyncNanos <= vsyncNanos) {
+    return;
+  }
+  armedVsyncNanos = vsyncNanos;
+  itimerspec spec{};
+  spec.it_value.tv_sec = vsyncNanos / 1000000000;
+  spec.it_value.tv_nsec = vsyncNanos % 1000000000;
+  timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+int AChoreographer::onTimer() {
+  uint64_t expirations;
+  while (read(timerFd, &expirations, sizeof(expirations)) > 0) {
+  }
+  const int64_t now = monotonicNanos();
+  // timestamp of the vsync that just happened even if we were woken up late
+  const int64_t frameTimeNanos = originNanos + (now - originNanos) / periodNanos * periodNanos;
+  std::vector<Callback> due;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    armedVsyncNanos = 0;
+    auto pending = callbacks.begin();
+    while (pending != callbacks.end()) {
+      if (pending->dueNanos < frameTimeNanos) {
+        due.push_back(*pending);
+        pending = callbacks.erase(pending);
+      } else {
+        ++pending;
+      }
+    }
+    for (const auto &callback: callbacks) {
+      armLocked(callback.dueNanos);
+    }
+  }
+  // callbacks posted from these ones are due after this frame and go to the next vsync
+  for (const auto &callback: due) {
+    if (callback.callback64) {
+      callback.callback64(frameTimeNanos, callback.data);
+    } else {
+      callback.callback(static_cast<long>(frameTimeNanos), callback.data);
+    }
+  }
+  return 1;
+}
+
+AChoreographer *AChoreographer_getInstance() {
+  if (!threadChoreographer.choreographer) {
+    ALooper *looper = ALooper_forThread();
+    if (!looper) {
+      return nullptr;
+    }
+    threadChoreographer.choreographer = new AChoreographer(looper);
+  }
+  return threadChoreographer.choreographer;
+}
+
+void AChoreographer_postFrameCallback(AChoreographer *choreographer,
+                                      AChoreographer_frameCallback callback, void *data) {
+  choreographer->post(callback, nullptr, data, 0);
+}
+
+void AChoreographer_postFrameCallbackDelayed(AChoreographer *choreographer,
+                                             AChoreographer_frameCallback callback, void *data,
+                                             long delayMillis) {
+  choreographer->post(callback, nullptr, data, int64_t(delayMillis) * 1000000);
+}
+
+void AChoreographer_postFrameCallback64(AChoreographer *choreographer,
+                                        AChoreographer_frameCallback64 callback, void *data) {
+  choreographer->post(nullptr, callback, data, 0);
+}
+
+void AShim_setVsyncPeriodNanos(int64_t periodNanos) {
+  vsyncPeriodNanos = periodNanos > 0 ? periodNanos : 16666667;
+}
@@ -0,0 +1,204 @@
+#include <android/hardware_buffer.h>
+#include <android/log.h>
+
+#include "android_shim.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+// STL
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+namespace {
+
+// gralloc implementations commonly pad rows to 64 pixels (RGBA) or 64 bytes (YUV)
+constexpr uint32_t kStrideAlignment = 64;
+constexpr size_t kDataAlignment = 64;
+
+std::atomic<int64_t> liveBuffers{0};
+
+uint32_t alignUp(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+uint32_t bytesPerPixel(uint32_t format) {
+  switch (format) {
+    case AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM:
+    case AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM:
+      return 4;
+    case AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM:
+      return 3;
+    case AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM:
+      return 2;
+    case AHARDWAREBUFFER_FORMAT_BLOB:
+    case AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+bool isSupported(const AHardwareBuffer_Desc &desc) {
+  if (desc.width == 0 || desc.height == 0 || desc.layers != 1 || bytesPerPixel(desc.format) == 0) {
+    return false;
+  }
+  return desc.format != AHARDWAREBUFFER_FORMAT_BLOB || desc.height == 1;
+}
+
+} // namespace
+
+/**
+ * YUV buffers are laid out as NV12: Y plane followed by interleaved CbCr plane with the same row stride.
+ */
+struct AHardwareBuffer {
+  AHardwareBuffer_Desc desc;
+  uint8_t *data = nullptr;
+  size_t rowStride = 0;
+  size_t chromaOffset = 0;
+
+  std::atomic<int32_t> references{1};
+  std::mutex mutex;
+  int32_t locks = 0;
+};
+
+int AHardwareBuffer_allocate(const AHardwareBuffer_Desc *desc, AHardwareBuffer **outBuffer) {
+  if (!desc || !outBuffer || !isSupported(*desc)) {
+    return -EINVAL;
+  }
+  auto *buffer = new AHardwareBuffer();
+  buffer->desc = *desc;
+  size_t size;
+  if (desc->format == AHARDWAREBUFFER_FORMAT_BLOB) {
+    buffer->desc.stride = desc->width;
+    buffer->rowStride = desc->width;
+    size = desc->width;
+  } else if (desc->format == AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420) {
+    buffer->desc.stride = alignUp(desc->width, kStrideAlignment);
+    buffer->rowStride = buffer->desc.stride;
+    buffer->chromaOffset = buffer->rowStride * desc->height;
+    size = buffer->chromaOffset + buffer->rowStride * ((desc->height + 1) / 2);
+  } else {
+    buffer->desc.stride = alignUp(desc->width, kStrideAlignment);
+    buffer->rowStride = size_t(buffer->desc.stride) * bytesPerPixel(desc->format);
+    size = buffer->rowStride * desc->height;
+  }
+  buffer->data = static_cast<uint8_t *>(
+          std::aligned_alloc(kDataAlignment, (size + kDataAlignment - 1) / kDataAlignment * kDataAlignment));
+  if (!buffer->data) {
+    delete buffer;
+    return -ENOMEM;
+  }
+  ++liveBuffers;
+  *outBuffer = buffer;
+  return 0;
+}
+
+void AHardwareBuffer_acquire(AHardwareBuffer *buffer) {
+  buffer->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AHardwareBuffer_release(AHardwareBuffer *buffer) {
+  if (buffer->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  if (buffer->locks > 0) {
+    __android_log_print(ANDROID_LOG_ERROR, "AShim", "Hardware buffer %p released while locked", buffer);
+  }
+  std::free(buffer->data);
+  delete buffer;
+  --liveBuffers;
+}
+
+void AHardwareBuffer_describe(const AHardwareBuffer *buffer, AHardwareBuffer_Desc *outDesc) {
+  *outDesc = buffer->desc;
+}
+
+namespace {
+
+int beginLock(AHardwareBuffer *buffer, uint64_t usage, int32_t fence) {
+  if (!buffer) {
+    return -EINVAL;
+  }
+  // we never produce fences so there is nothing to wait for, ownership is still transferred to us
+  if (fence >= 0) {
+    close(fence);
+  }
+  const uint64_t cpuMask = AHARDWAREBUFFER_USAGE_CPU_READ_MASK | AHARDWAREBUFFER_USAGE_CPU_WRITE_MASK;
+  if ((usage & ~cpuMask) != 0 || (usage & cpuMask) == 0) {
+    return -EINVAL;
+  }
+  // same check as the platform: CPU access must have been requested at allocation time
+  if ((usage & AHARDWAREBUFFER_USAGE_CPU_READ_MASK) &&
+      !(buffer->desc.usage & AHARDWAREBUFFER_USAGE_CPU_READ_MASK)) {
+    return -EINVAL;
+  }
+  if ((usage & AHARDWAREBUFFER_USAGE_CPU_WRITE_MASK) &&
+      !(buffer->desc.usage & AHARDWAREBUFFER_USAGE_CPU_WRITE_MASK)) {
+    return -EINVAL;
+  }
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  ++buffer->locks;
+  return 0;
+}
+
+} // namespace
+
+int AHardwareBuffer_lock(AHardwareBuffer *buffer, uint64_t usage, int32_t fence,
+                         const ARect *, void **outVirtualAddress) {
+  if (!outVirtualAddress) {
+    return -EINVAL;
+  }
+  const int result = beginLock(buffer, usage, fence);
+  if (result == 0) {
+    *outVirtualAddress = buffer->data;
+  }
+  return result;
+}
+
+int AHardwareBuffer_lockPlanes(AHardwareBuffer *buffer, uint64_t usage, int32_t fence,
+                               const ARect *, AHardwareBuffer_Planes *outPlanes) {
+  if (!outPlanes) {
+    return -EINVAL;
+  }
+  const int result = beginLock(buffer, usage, fence);
+  if (result != 0) {
+    return result;
+  }
+  if (buffer->desc.format == AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420) {
+    const auto rowStride = static_cast<uint32_t>(buffer->rowStride);
+    outPlanes->planeCount = 3;
+    outPlanes->planes[0] = {buffer->data, 1, rowStride};
+    outPlanes->planes[1] = {buffer->data + buffer->chromaOffset, 2, rowStride};
+    outPlanes->planes[2] = {buffer->data + buffer->chromaOffset + 1, 2, rowStride};
+  } else {
+    outPlanes->planeCount = 1;
+    outPlanes->planes[0] = {buffer->data, bytesPerPixel(buffer->desc.format),
+                            static_cast<uint32_t>(buffer->rowStride)};
+  }
+  return 0;
+}
+
+int AHardwareBuffer_unlock(AHardwareBuffer *buffer, int32_t *fence) {
+  if (!buffer) {
+    return -EINVAL;
+  }
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  if (buffer->locks == 0) {
+    return -EINVAL;
+  }
+  --buffer->locks;
+  if (fence) {
+    *fence = -1;
+  }
+  return 0;
+}
+
+int AHardwareBuffer_isSupported(const AHardwareBuffer_Desc *desc) {
+  return desc && isSupported(*desc) ? 1 : 0;
+}
+
+int64_t AShim_liveHardwareBuffers() {
+  return liveBuffers.load();
+}
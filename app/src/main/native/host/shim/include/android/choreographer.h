@@ -0,0 +1,37 @@
+#pragma once
+
+/**
+ * Host version of the NDK AChoreographer API. Vsync is simulated with a timerfd registered on the
+ * looper of the thread the choreographer belongs to, see android_shim.h to change refresh period.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct AChoreographer AChoreographer;
+
+typedef void (*AChoreographer_frameCallback)(long frameTimeNanos, void *data);
+
+typedef void (*AChoreographer_frameCallback64)(int64_t frameTimeNanos, void *data);
+
+/**
+ * Must be called from a thread with ALooper prepared.
+ */
+AChoreographer *AChoreographer_getInstance();
+
+void AChoreographer_postFrameCallback(AChoreographer *choreographer,
+                                      AChoreographer_frameCallback callback, void *data);
+
+void AChoreographer_postFrameCallbackDelayed(AChoreographer *choreographer,
+                                             AChoreographer_frameCallback callback, void *data,
+                                             long delayMillis);
+
+void AChoreographer_postFrameCallback64(AChoreographer *choreographer,
+                                        AChoreographer_frameCallback64 callback, void *data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+/**
+ * Host subset of the NDK AHardwareBuffer API, see
+ * https://developer.android.com/ndk/reference/group/a-hardware-buffer
+ * Buffers live on the heap with gralloc-like padded strides, lock / unlock are checked against
+ * allocation usage the same way the platform does.
+ */
+
+#include <stdint.h>
+
+#include <android/rect.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct AHardwareBuffer AHardwareBuffer;
+
+enum AHardwareBuffer_Format {
+  AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM = 1,
+  AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM = 2,
+  AHARDWAREBUFFER_FORMAT_R8G8B8_UNORM = 3,
+  AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM = 4,
+  AHARDWAREBUFFER_FORMAT_BLOB = 0x21,
+  AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420 = 0x23,
+};
+
+enum AHardwareBuffer_UsageFlags {
+  AHARDWAREBUFFER_USAGE_CPU_READ_NEVER = 0UL,
+  AHARDWAREBUFFER_USAGE_CPU_READ_RARELY = 2UL,
+  AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN = 3UL,
+  AHARDWAREBUFFER_USAGE_CPU_READ_MASK = 0xFUL,
+  AHARDWAREBUFFER_USAGE_CPU_WRITE_NEVER = 0UL << 4,
+  AHARDWAREBUFFER_USAGE_CPU_WRITE_RARELY = 2UL << 4,
+  AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN = 3UL << 4,
+  AHARDWAREBUFFER_USAGE_CPU_WRITE_MASK = 0xFUL << 4,
+  AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE = 1UL << 8,
+  AHARDWAREBUFFER_USAGE_GPU_FRAMEBUFFER = 1UL << 9,
+  AHARDWAREBUFFER_USAGE_GPU_COLOR_OUTPUT = AHARDWAREBUFFER_USAGE_GPU_FRAMEBUFFER,
+  AHARDWAREBUFFER_USAGE_VIDEO_ENCODE = 1UL << 16,
+};
+
+typedef struct AHardwareBuffer_Desc {
+  uint32_t width;
+  uint32_t height;
+  uint32_t layers;
+  uint32_t format;
+  uint64_t usage;
+  // in pixels, filled by the allocator
+  uint32_t stride;
+  uint32_t rfu0;
+  uint64_t rfu1;
+} AHardwareBuffer_Desc;
+
+typedef struct AHardwareBuffer_Plane {
+  void *data;
+  uint32_t pixelStride;
+  uint32_t rowStride;
+} AHardwareBuffer_Plane;
+
+typedef struct AHardwareBuffer_Planes {
+  uint32_t planeCount;
+  AHardwareBuffer_Plane planes[4];
+} AHardwareBuffer_Planes;
+
+int AHardwareBuffer_allocate(const AHardwareBuffer_Desc *desc, AHardwareBuffer **outBuffer);
+
+void AHardwareBuffer_acquire(AHardwareBuffer *buffer);
+
+void AHardwareBuffer_release(AHardwareBuffer *buffer);
+
+void AHardwareBuffer_describe(const AHardwareBuffer *buffer, AHardwareBuffer_Desc *outDesc);
+
+int AHardwareBuffer_lock(AHardwareBuffer *buffer, uint64_t usage, int32_t fence,
+                         const ARect *rect, void **outVirtualAddress);
+
+int AHardwareBuffer_lockPlanes(AHardwareBuffer *buffer, uint64_t usage, int32_t fence,
+                               const ARect *rect, AHardwareBuffer_Planes *outPlanes);
+
+int AHardwareBuffer_unlock(AHardwareBuffer *buffer, int32_t *fence);
+
+int AHardwareBuffer_isSupported(const AHardwareBuffer_Desc *desc);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+/**
+ * Host version of the NDK logging API, messages go to stderr.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum android_LogPriority {
+  ANDROID_LOG_UNKNOWN = 0,
+  ANDROID_LOG_DEFAULT,
+  ANDROID_LOG_VERBOSE,
+  ANDROID_LOG_DEBUG,
+  ANDROID_LOG_INFO,
+  ANDROID_LOG_WARN,
+  ANDROID_LOG_ERROR,
+  ANDROID_LOG_FATAL,
+  ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...)
+        __attribute__((__format__(printf, 3, 4)));
+
+int __android_log_write(int prio, const char *tag, const char *text);
+
+/**
+ * Messages below the priority are dropped, ANDROID_LOG_INFO by default. Returns previous value.
+ */
+int32_t __android_log_set_minimum_priority(int32_t priority);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+ * Host version of ANativeWindow, only reference counting and geometry - there is nothing to present to.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ANativeWindow ANativeWindow;
+
+void ANativeWindow_acquire(ANativeWindow *window);
+
+void ANativeWindow_release(ANativeWindow *window);
+
+int32_t ANativeWindow_getWidth(ANativeWindow *window);
+
+int32_t ANativeWindow_getHeight(ANativeWindow *window);
+
+int32_t ANativeWindow_getFormat(ANativeWindow *window);
+
+int32_t ANativeWindow_setBuffersGeometry(ANativeWindow *window, int32_t width, int32_t height,
+                                         int32_t format);
+
+#ifdef __cplusplus
+}
+#endif
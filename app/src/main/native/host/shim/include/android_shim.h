@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+ * Host only knobs of the Android shim, not part of the NDK.
+ */
+
+#include <stdint.h>
+
+#include <android/native_window.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Period of simulated vsync for choreographers created afterwards, 16.6 ms (60 Hz) by default.
+ */
+void AShim_setVsyncPeriodNanos(int64_t periodNanos);
+
+/**
+ * Window that is never presented anywhere, returned with one reference held by the caller.
+ */
+ANativeWindow *AShim_createNativeWindow(int32_t width, int32_t height);
+
+/**
+ * Number of hardware buffers currently alive, handy to catch leaks in soak runs.
+ */
+int64_t AShim_liveHardwareBuffers();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,55 @@
+#include <android/log.h>
+
+// STL
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+
+std::atomic<int32_t> minimumPriority{ANDROID_LOG_INFO};
+
+char priorityLetter(int prio) {
+  switch (prio) {
+    case ANDROID_LOG_VERBOSE:
+      return 'V';
+    case ANDROID_LOG_DEBUG:
+      return 'D';
+    case ANDROID_LOG_INFO:
+      return 'I';
+    case ANDROID_LOG_WARN:
+      return 'W';
+    case ANDROID_LOG_ERROR:
+      return 'E';
+    case ANDROID_LOG_FATAL:
+      return 'F';
+    default:
+      return '?';
+  }
+}
+
+} // namespace
+
+int __android_log_write(int prio, const char *tag, const char *text) {
+  if (prio < minimumPriority.load(std::memory_order_relaxed)) {
+    return 0;
+  }
+  // single call so lines from different threads do not interleave
+  return fprintf(stderr, "%c/%s: %s\n", priorityLetter(prio), tag ? tag : "", text);
+}
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+  if (prio < minimumPriority.load(std::memory_order_relaxed)) {
+    return 0;
+  }
+  char message[1024];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(message, sizeof(message), fmt, args);
+  va_end(args);
+  return __android_log_write(prio, tag, message);
+}
+
+int32_t __android_log_set_minimum_priority(int32_t priority) {
+  return minimumPriority.exchange(priority);
+}
@@ -0,0 +1,296 @@
+#include <android/looper.h>
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Mirrors the platform Looper: epoll over registered fds plus an eventfd used by ALooper_wake.
+ * Callbacks run on the thread calling poll, registration is allowed from any thread.
+ */
+struct ALooper {
+  explicit ALooper(bool allowNonCallbacks);
+
+  ~ALooper();
+
+  int pollOnce(int timeoutMillis, int *outFd, int *outEvents, void **outData);
+
+  int addFd(int fd, int ident, int events, ALooper_callbackFunc callback, void *data);
+
+  int removeFd(int fd, uint64_t seq = 0);
+
+  void wake() const;
+
+  std::atomic<int32_t> references{1};
+
+private:
+  struct Request {
+    int fd;
+    int ident;
+    ALooper_callbackFunc callback;
+    void *data;
+    // tells a re-registered fd apart from the one a pending response belongs to
+    uint64_t seq;
+  };
+
+  struct Response {
+    int events;
+    Request request;
+  };
+
+  int pollInner(int timeoutMillis);
+
+  const bool allowNonCallbacks;
+  int epollFd;
+  int wakeFd;
+
+  std::mutex mutex;
+  std::unordered_map<int, Request> requests;
+  uint64_t nextSeq = 1;
+
+  // touched by the polling thread only
+  std::vector<Response> responses;
+  size_t responseIndex = 0;
+};
+
+namespace {
+
+uint32_t toEpollEvents(int events) {
+  uint32_t epollEvents = 0;
+  if (events & ALOOPER_EVENT_INPUT) {
+    epollEvents |= EPOLLIN;
+  }
+  if (events & ALOOPER_EVENT_OUTPUT) {
+    epollEvents |= EPOLLOUT;
+  }
+  return epollEvents;
+}
+
+int fromEpollEvents(uint32_t epollEvents) {
+  int events = 0;
+  if (epollEvents & EPOLLIN) {
+    events |= ALOOPER_EVENT_INPUT;
+  }
+  if (epollEvents & EPOLLOUT) {
+    events |= ALOOPER_EVENT_OUTPUT;
+  }
+  if (epollEvents & EPOLLERR) {
+    events |= ALOOPER_EVENT_ERROR;
+  }
+  if (epollEvents & EPOLLHUP) {
+    events |= ALOOPER_EVENT_HANGUP;
+  }
+  return events;
+}
+
+/**
+ * Holds the reference of the looper prepared for the thread until the thread exits.
+ */
+struct ThreadLooper {
+  ~ThreadLooper() {
+    if (looper) {
+      ALooper_release(looper);
+    }
+  }
+
+  ALooper *looper = nullptr;
+};
+
+thread_local ThreadLooper threadLooper;
+
+} // namespace
+
+ALooper::ALooper(bool allowNonCallbacks)
+        : allowNonCallbacks(allowNonCallbacks),
+          epollFd(epoll_create1(EPOLL_CLOEXEC)),
+          wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = wakeFd;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+}
+
+ALooper::~ALooper() {
+  close(wakeFd);
+  close(epollFd);
+}
+
+int ALooper::pollOnce(int timeoutMillis, int *outFd, int *outEvents, void **outData) {
+  int result = 0;
+  for (;;) {
+    // fds registered without callback are reported one by one
+    while (responseIndex < responses.size()) {
+      const Response &response = responses[responseIndex++];
+      if (response.request.ident >= 0) {
+        if (outFd) *outFd = response.request.fd;
+        if (outEvents) *outEvents = response.events;
+        if (outData) *outData = response.request.data;
+        return response.request.ident;
+      }
+    }
+    if (result != 0) {
+      if (outFd) *outFd = 0;
+      if (outEvents) *outEvents = 0;
+      if (outData) *outData = nullptr;
+      return result;
+    }
+    result = pollInner(timeoutMillis);
+  }
+}
+
+int ALooper::pollInner(int timeoutMillis) {
+  responses.clear();
+  responseIndex = 0;
+
+  constexpr int kMaxEvents = 16;
+  epoll_event events[kMaxEvents];
+  const int count = epoll_wait(epollFd, events, kMaxEvents, timeoutMillis);
+  if (count < 0) {
+    return errno == EINTR ? ALOOPER_POLL_WAKE : ALOOPER_POLL_ERROR;
+  }
+  if (count == 0) {
+    return ALOOPER_POLL_TIMEOUT;
+  }
+
+  int result = ALOOPER_POLL_WAKE;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int i = 0; i < count; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == wakeFd) {
+        uint64_t value;
+        while (read(wakeFd, &value, sizeof(value)) > 0) {
+        }
+        continue;
+      }
+      const auto request = requests.find(fd);
+      if (request != requests.end()) {
+        responses.push_back(Response{fromEpollEvents(events[i].events), request->second});
+      }
+    }
+  }
+
+  for (const auto &response: responses) {
+    if (response.request.ident == ALOOPER_POLL_CALLBACK) {
+      const int keep = response.request.callback(response.request.fd, response.events,
+                                                 response.request.data);
+      if (keep == 0) {
+        removeFd(response.request.fd, response.request.seq);
+      }
+      result = ALOOPER_POLL_CALLBACK;
+    }
+  }
+  return result;
+}
+
+int ALooper::addFd(int fd, int ident, int events, ALooper_callbackFunc callback, void *data) {
+  if (!callback) {
+    if (!allowNonCallbacks || ident < 0) {
+      return -1;
+    }
+  } else {
+    ident = ALOOPER_POLL_CALLBACK;
+  }
+  epoll_event event{};
+  event.events = toEpollEvents(events);
+  event.data.fd = fd;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  const bool registered = requests.count(fd) != 0;
+  if (epoll_ctl(epollFd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) != 0) {
+    return -1;
+  }
+  requests[fd] = Request{fd, ident, callback, data, nextSeq++};
+  return 1;
+}
+
+int ALooper::removeFd(int fd, uint64_t seq) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto request = requests.find(fd);
+  if (request == requests.end() || (seq != 0 && request->second.seq != seq)) {
+    return 0;
+  }
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  requests.erase(request);
+  return 1;
+}
+
+void ALooper::wake() const {
+  const uint64_t value = 1;
+  // counter may only overflow after 2^64 wakes, nothing to handle
+  const ssize_t written = write(wakeFd, &value, sizeof(value));
+  (void) written;
+}
+
+ALooper *ALooper_forThread() {
+  return threadLooper.looper;
+}
+
+ALooper *ALooper_prepare(int opts) {
+  if (!threadLooper.looper) {
+    threadLooper.looper = new ALooper((opts & ALOOPER_PREPARE_ALLOW_NON_CALLBACKS) != 0);
+  }
+  return threadLooper.looper;
+}
+
+void ALooper_acquire(ALooper *looper) {
+  looper->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ALooper_release(ALooper *looper) {
+  if (looper->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete looper;
+  }
+}
+
+int ALooper_pollOnce(int timeoutMillis, int *outFd, int *outEvents, void **outData) {
+  ALooper *looper = ALooper_forThread();
+  if (!looper) {
+    return ALOOPER_POLL_ERROR;
+  }
+  return looper->pollOnce(timeoutMillis, outFd, outEvents, outData);
+}
+
+int ALooper_pollAll(int timeoutMillis, int *outFd, int *outEvents, void **outData) {
+  if (timeoutMillis <= 0) {
+    int result;
+    do {
+      result = ALooper_pollOnce(timeoutMillis, outFd, outEvents, outData);
+    } while (result == ALOOPER_POLL_CALLBACK);
+    return result;
+  }
+  const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+  for (;;) {
+    const int result = ALooper_pollOnce(timeoutMillis, outFd, outEvents, outData);
+    if (result != ALOOPER_POLL_CALLBACK) {
+      return result;
+    }
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            end - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0) {
+      return ALOOPER_POLL_TIMEOUT;
+    }
+    timeoutMillis = static_cast<int>(remaining);
+  }
+}
+
+void ALooper_wake(ALooper *looper) {
+  looper->wake();
+}
+
+int ALooper_addFd(ALooper *looper, int fd, int ident, int events,
+                  ALooper_callbackFunc callback, void *data) {
+  return looper->addFd(fd, ident, events, callback, data);
+}
+
+int ALooper_removeFd(ALooper *looper, int fd) {
+  return looper->removeFd(fd);
+}
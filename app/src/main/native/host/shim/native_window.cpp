@@ -0,0 +1,60 @@
+#include <android/native_window.h>
+
+#include "android_shim.h"
+
+#include <errno.h>
+
+// STL
+#include <atomic>
+
+struct ANativeWindow {
+  std::atomic<int32_t> references{1};
+  std::atomic<int32_t> width{0};
+  std::atomic<int32_t> height{0};
+  // WINDOW_FORMAT_RGBA_8888
+  std::atomic<int32_t> format{1};
+};
+
+ANativeWindow *AShim_createNativeWindow(int32_t width, int32_t height) {
+  auto *window = new ANativeWindow();
+  window->width = width;
+  window->height = height;
+  return window;
+}
+
+void ANativeWindow_acquire(ANativeWindow *window) {
+  window->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ANativeWindow_release(ANativeWindow *window) {
+  if (window && window->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete window;
+  }
+}
+
+int32_t ANativeWindow_getWidth(ANativeWindow *window) {
+  return window->width;
+}
+
+int32_t ANativeWindow_getHeight(ANativeWindow *window) {
+  return window->height;
+}
+
+int32_t ANativeWindow_getFormat(ANativeWindow *window) {
+  return window->format;
+}
+
+int32_t ANativeWindow_setBuffersGeometry(ANativeWindow *window, int32_t width, int32_t height,
+                                         int32_t format) {
+  if ((width == 0) != (height == 0)) {
+    return -EINVAL;
+  }
+  if (width > 0) {
+    window->width = width;
+    window->height = height;
+  }
+  if (format != 0) {
+    window->format = format;
+  }
+  return 0;
+}
@@ -0,0 +1,13 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+layout (push_constant) uniform PushConstants {
+    mat4 mvp;
+} pc;
+layout (location = 0) in vec2 pos;
+layout (location = 1) in vec2 attr;
+layout (location = 0) out vec2 texcoord;
+void main() {
+   texcoord = attr;
+   gl_Position = pc.mvp * vec4(pos, 0.0, 1.0);
+}
@@ -0,0 +1,102 @@
+#include "pixel_copy.hpp"
+#include "test_util.hpp"
+#include "worker_pool.hpp"
+
+// STL
+#include <vector>
+
+using namespace engine::android;
+
+namespace {
+
+// below one vector, around the 16 / 32 byte vectors and the 64 byte block, odd pixel widths
+constexpr size_t kRowBytes[] = {1, 3, 4, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 129, 255, 1001, 4100};
+// misaligns the row start against every vector width
+constexpr size_t kOffsets[] = {0, 1, 3, 8, 17, 31};
+// stride equal to the row collapses the plane into one long row, the others keep the rows apart
+constexpr size_t kPaddings[] = {0, 5, 64};
+constexpr size_t kRows = 5;
+constexpr uint8_t kUntouched = 0xcd;
+
+/**
+ * Plane of `rows` rows starting `offset` bytes into its allocation, with some slack behind it
+ * so writes past the last row are caught. Whole allocation is compared.
+ */
+struct Plane {
+  Plane(size_t offset, size_t stride, size_t rows, uint8_t fill)
+          : offset(offset), stride(stride), data(offset + stride * rows + 64, fill) {}
+
+  uint8_t *begin() { return data.data() + offset; }
+
+  size_t offset;
+  size_t stride;
+  std::vector<uint8_t> data;
+};
+
+Plane sourcePlane(size_t offset, size_t stride, size_t rows) {
+  Plane plane(offset, stride, rows, 0);
+  for (size_t i = 0; i < plane.data.size(); ++i) {
+    plane.data[i] = static_cast<uint8_t>(i * 31u + 7u);
+  }
+  return plane;
+}
+
+/**
+ * Kernels not compiled in or not supported by the CPU fall back to memcpy and are still checked.
+ */
+void testKernelMatchesScalar(CopyKernel kernel, bool nonTemporal) {
+  for (const size_t rowBytes: kRowBytes) {
+    for (const size_t srcOffset: kOffsets) {
+      for (const size_t dstOffset: kOffsets) {
+        for (const size_t padding: kPaddings) {
+          auto src = sourcePlane(srcOffset, rowBytes + padding, kRows);
+          // destination padding differs from the source one unless both are packed
+          const size_t dstStride = rowBytes + (padding ? padding + 3 : 0);
+          Plane dst(dstOffset, dstStride, kRows, kUntouched);
+          Plane expected(dstOffset, dstStride, kRows, kUntouched);
+          copyPlane(kernel, nonTemporal, src.begin(), src.stride, dst.begin(), dst.stride,
+                    rowBytes, kRows);
+          copyPlaneScalar(src.begin(), src.stride, expected.begin(), expected.stride,
+                          rowBytes, kRows);
+          CHECK_BYTES_EQUAL(dst.data, expected.data,
+                            "%s%s, rowBytes=%zu, srcOffset=%zu, dstOffset=%zu, padding=%zu",
+                            copyKernelName(kernel), nonTemporal ? " non-temporal" : "",
+                            rowBytes, srcOffset, dstOffset, padding);
+        }
+      }
+    }
+  }
+}
+
+void testStripedMatchesScalar() {
+  WorkerPool pool(3);
+  constexpr size_t kWidth = 37;
+  constexpr size_t kHeight = 11;
+  // fewer, as many and more stripes than rows
+  for (size_t stripes = 1; stripes <= kHeight + 2; ++stripes) {
+    auto src = sourcePlane(1, kWidth * 4 + 12, kHeight);
+    Plane dst(3, kWidth * 4 + 4, kHeight, kUntouched);
+    Plane expected(3, kWidth * 4 + 4, kHeight, kUntouched);
+    copyPlaneStriped(pool, stripes, src.begin(), src.stride, dst.begin(), dst.stride,
+                     kWidth * 4, kHeight);
+    copyPlaneScalar(src.begin(), src.stride, expected.begin(), expected.stride,
+                    kWidth * 4, kHeight);
+    CHECK_BYTES_EQUAL(dst.data, expected.data, "striped, stripes=%zu", stripes);
+  }
+}
+
+} // namespace
+
+int main() {
+  for (const auto kernel: {CopyKernel::Memcpy, CopyKernel::Neon, CopyKernel::Sse2, CopyKernel::Avx2}) {
+    testKernelMatchesScalar(kernel, false);
+    testKernelMatchesScalar(kernel, true);
+  }
+  testStripedMatchesScalar();
+  if (testFailures() != 0) {
+    fprintf(stderr, "%d checks failed\n", testFailures());
+    return 1;
+  }
+  printf("all checks passed, best copy kernel is %s\n", copyKernelName(bestCopyKernel()));
+  return 0;
+}
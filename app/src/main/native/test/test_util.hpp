@@ -0,0 +1,52 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace engine {
+namespace android {
+
+/**
+ * Failed checks of the test executable, its main returns non zero if any.
+ */
+inline int &testFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+/**
+ * Reports the first differing byte and counts the failure, true if both are equal.
+ */
+inline bool bytesEqual(const std::vector<uint8_t> &actual, const std::vector<uint8_t> &expected,
+                       const char *file, int line) {
+  if (actual == expected) {
+    return true;
+  }
+  size_t index = 0;
+  while (index < actual.size() && index < expected.size() && actual[index] == expected[index]) {
+    ++index;
+  }
+  fprintf(stderr, "%s:%d: bytes differ at %zu of %zu / %zu: ", file, line, index, actual.size(),
+          expected.size());
+  ++testFailures();
+  return false;
+}
+
+} // namespace android
+} // namespace engine
+
+/**
+ * Returns from the calling test on mismatch so one broken case does not flood the output,
+ * printf style arguments describe the case.
+ */
+#define CHECK_BYTES_EQUAL(actual, expected, ...)                                  \
+  do {                                                                            \
+    if (!engine::android::bytesEqual(actual, expected, __FILE__, __LINE__)) {     \
+      fprintf(stderr, __VA_ARGS__);                                               \
+      fputc('\n', stderr);                                                        \
+      return;                                                                     \
+    }                                                                             \
+  } while (0)
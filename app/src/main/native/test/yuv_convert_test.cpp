@@ -0,0 +1,151 @@
+#include "test_util.hpp"
+#include "worker_pool.hpp"
+#include "yuv_convert.hpp"
+
+// STL
+#include <vector>
+
+using namespace engine::android;
+
+namespace {
+
+// below, around and past the 8 px SSE2 and 16 px NEON loops, odd ones round chroma up
+constexpr size_t kWidths[] = {1, 2, 3, 7, 8, 9, 15, 16, 17, 18, 31, 32, 33, 47, 65};
+constexpr size_t kHeights[] = {1, 2, 3, 5};
+constexpr uint8_t kUntouched = 0xcd;
+
+enum class ChromaLayout {
+  // I420, pixel stride 1
+  Planar,
+  // NV12 and NV21, pixel stride 2 with U / V interleaved in one plane
+  Nv12,
+  Nv21,
+  // anything else the SIMD kernels leave to the scalar path
+  PixelStride3,
+};
+
+const char *layoutName(ChromaLayout layout) {
+  switch (layout) {
+    case ChromaLayout::Planar:
+      return "planar";
+    case ChromaLayout::Nv12:
+      return "NV12";
+    case ChromaLayout::Nv21:
+      return "NV21";
+    case ChromaLayout::PixelStride3:
+      return "pixel stride 3";
+  }
+  return "unknown";
+}
+
+uint8_t pattern(size_t i, uint32_t seed) {
+  return static_cast<uint8_t>((i * 2654435761u + seed) >> 7);
+}
+
+/**
+ * Planes sized exactly as a camera would hand them out, chroma rows are padded.
+ */
+struct YuvFrame {
+  YuvFrame(size_t width, size_t height, ChromaLayout layout) {
+    const size_t chromaWidth = (width + 1) / 2;
+    const size_t chromaHeight = (height + 1) / 2;
+    const size_t pixelStride = layout == ChromaLayout::Planar ? 1
+            : layout == ChromaLayout::PixelStride3 ? 3 : 2;
+    const size_t yRowStride = width + 3;
+    const size_t uvRowStride = chromaWidth * pixelStride + 5;
+    y.resize(yRowStride * (height - 1) + width);
+    for (size_t i = 0; i < y.size(); ++i) {
+      y[i] = pattern(i, 1);
+    }
+    const size_t chromaBytes = uvRowStride * (chromaHeight - 1) + (chromaWidth - 1) * pixelStride + 1;
+    if (layout == ChromaLayout::Planar || layout == ChromaLayout::PixelStride3) {
+      u.resize(chromaBytes);
+      v.resize(chromaBytes);
+    } else {
+      // one plane, the second component starts a byte later
+      u.resize(chromaBytes + 1);
+    }
+    for (size_t i = 0; i < u.size(); ++i) {
+      u[i] = pattern(i, 2);
+    }
+    for (size_t i = 0; i < v.size(); ++i) {
+      v[i] = pattern(i, 3);
+    }
+    planes.y = y.data();
+    planes.u = layout == ChromaLayout::Nv21 ? u.data() + 1 : u.data();
+    planes.v = layout == ChromaLayout::Nv12 ? u.data() + 1
+            : layout == ChromaLayout::Nv21 ? u.data() : v.data();
+    planes.yRowStride = yRowStride;
+    planes.uvRowStride = uvRowStride;
+    planes.uvPixelStride = pixelStride;
+  }
+
+  std::vector<uint8_t> y;
+  std::vector<uint8_t> u;
+  std::vector<uint8_t> v;
+  YuvPlanes planes;
+};
+
+/**
+ * Rows [firstRow, lastRow) of every layout, matrix and range, whole RGBA allocation compared so
+ * writes into the row padding or past the last row are caught.
+ */
+void testConversionMatchesScalar(size_t width, size_t height, size_t firstRow, size_t lastRow) {
+  for (const auto layout: {ChromaLayout::Planar, ChromaLayout::Nv12, ChromaLayout::Nv21,
+                           ChromaLayout::PixelStride3}) {
+    const YuvFrame frame(width, height, layout);
+    const size_t dstStride = width * 4 + 8;
+    for (const auto matrix: {YuvMatrix::Bt601, YuvMatrix::Bt709}) {
+      for (const auto range: {YuvRange::Full, YuvRange::Limited}) {
+        std::vector<uint8_t> rgba(dstStride * height, kUntouched);
+        std::vector<uint8_t> expected(dstStride * height, kUntouched);
+        yuvToRgba(frame.planes, rgba.data(), dstStride, width, firstRow, lastRow, matrix, range);
+        yuvToRgbaScalar(frame.planes, expected.data(), dstStride, width, firstRow, lastRow,
+                        matrix, range);
+        CHECK_BYTES_EQUAL(rgba, expected,
+                          "%s, %zux%zu rows %zu-%zu, %s %s range", yuvKernelName(), width, height,
+                          firstRow, lastRow, layoutName(layout),
+                          matrix == YuvMatrix::Bt601 ? "BT.601" : "BT.709",
+                          range == YuvRange::Full ? "full" : "limited");
+      }
+    }
+  }
+}
+
+void testStripedMatchesScalar() {
+  WorkerPool pool(3);
+  constexpr size_t kWidth = 37;
+  constexpr size_t kHeight = 9;
+  const YuvFrame frame(kWidth, kHeight, ChromaLayout::Nv21);
+  const size_t dstStride = kWidth * 4;
+  // stripes starting on odd rows share their chroma row with the previous stripe
+  for (size_t stripes = 1; stripes <= kHeight + 1; ++stripes) {
+    std::vector<uint8_t> rgba(dstStride * kHeight, kUntouched);
+    std::vector<uint8_t> expected(dstStride * kHeight, kUntouched);
+    yuvToRgbaStriped(pool, stripes, frame.planes, rgba.data(), dstStride, kWidth, kHeight,
+                     YuvMatrix::Bt601, YuvRange::Full);
+    yuvToRgbaScalar(frame.planes, expected.data(), dstStride, kWidth, 0, kHeight,
+                    YuvMatrix::Bt601, YuvRange::Full);
+    CHECK_BYTES_EQUAL(rgba, expected, "striped, stripes=%zu", stripes);
+  }
+}
+
+} // namespace
+
+int main() {
+  for (const size_t width: kWidths) {
+    for (const size_t height: kHeights) {
+      testConversionMatchesScalar(width, height, 0, height);
+      if (height > 1) {
+        testConversionMatchesScalar(width, height, 1, height);
+      }
+    }
+  }
+  testStripedMatchesScalar();
+  if (testFailures() != 0) {
+    fprintf(stderr, "%d checks failed\n", testFailures());
+    return 1;
+  }
+  printf("all checks passed, YUV kernel is %s\n", yuvKernelName());
+  return 0;
+}